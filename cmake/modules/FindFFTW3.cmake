@@ -7,6 +7,7 @@
 # FFTW3_INCLUDE_DIR 
 # FFTW3_LIBRARIES
 # FFTW3_LINK_DIRECTORIES
+# FFTW3_THREADS_FOUND, FFTW3_THREADS_LIBRARIES (optional)
 #
 # You may set one of these options before including this file:
 #  FFTW3_USE_SSE2
@@ -67,6 +68,13 @@ FIND_LIBRARY(FFTW3_FFTW_LIBRARY
   )
 MESSAGE("DBG FFTW3_FFTW_LIBRARY=${FFTW3_FFTW_LIBRARY}")
 
+FIND_LIBRARY(FFTW3_FFTW_THREADS_LIBRARY
+  NAMES fftw3_threads libfftw3_threads
+  PATHS 
+  ${FFTW3_POSSIBLE_LIBRARY_PATH}
+  )
+#MESSAGE("DBG FFTW3_FFTW_THREADS_LIBRARY=${FFTW3_FFTW_THREADS_LIBRARY}")
+
 FIND_LIBRARY(FFTW3_FFTWF_LIBRARY
   NAMES fftwf3 fftwf libfftwf libfftwf3 libfftw3f-3
   PATHS 
@@ -107,6 +115,11 @@ ENDIF (FFTW3_FFTW_LIBRARY)
 IF (FFTW3_USE_SSE2 AND FFTW3_FFTW_SSE2_LIBRARY)
   SET(FFTW3_LIBRARIES ${FFTW3_FFTW_SSE2_LIBRARY})
 ENDIF (FFTW3_USE_SSE2 AND FFTW3_FFTW_SSE2_LIBRARY)
+# optional: threaded transforms
+IF (FFTW3_FFTW_THREADS_LIBRARY)
+  SET(FFTW3_THREADS_FOUND TRUE)
+  SET(FFTW3_THREADS_LIBRARIES ${FFTW3_FFTW_THREADS_LIBRARY})
+ENDIF (FFTW3_FFTW_THREADS_LIBRARY)
 
 # --------------------------------
 
@@ -130,6 +143,7 @@ MARK_AS_ADVANCED(
   FFTW3_LIBRARIES
   FFTW3_FFTW_LIBRARY
   FFTW3_FFTW_SSE2_LIBRARY
+  FFTW3_FFTW_THREADS_LIBRARY
   FFTW3_FFTWF_LIBRARY
   FFTW3_FFTWF_SSE_LIBRARY
   FFTW3_FFTWL_LIBRARY
@@ -26,6 +26,10 @@ other things, defines physical constants and atom name mapping.
 #include <boost/serialization/string.hpp>
 #include <boost/serialization/vector.hpp>
 
+// other headers
+
+class XMLInterface;
+
 // This class follow a strong hierarchy. The root class is located at the end of
 // this file.
 
@@ -263,6 +267,33 @@ class DatabaseNamesParameters {
   DatabaseNamesPDBParameters pdb;
 };
 
+/**
+Holds the scattering factors, volumes and exclusion factors of an additional
+contrast, see scattering.contrasts. The atom IDs and names are the ones of the
+main database.
+*/
+class DatabaseContrastParameters {
+  friend class Database;
+
+ private:
+  /////////////////// MPI related
+  // make this class serializable to
+  // allow sample to be transmitted via MPI
+  friend class boost::serialization::access;
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& volumes;
+    ar& exclusionfactors;
+    ar& sfactors;
+  }
+  ///////////////////
+
+ public:
+  DatabaseVolumesParameters volumes;
+  DatabaseExlusionParameters exclusionfactors;
+  DatabaseSFactorsParameters sfactors;
+};
+
 /**
 This singleton class is the root of a strong class hierarchy which implements a
 software wide database for physical constants and atom labeling. It also
@@ -285,6 +316,7 @@ class Database {
     ar& exclusionfactors;
     ar& sfactors;
     ar& atomIDs;
+    ar& contrasts;
   }
   ///////////////////
   Database() {}
@@ -295,9 +327,18 @@ class Database {
   std::vector<char> config;
 
   void read_xml(std::string filename);
+  // reads the sections which define the scattering weights of the atoms
+  void read_factors_xml(XMLInterface& xmli, DatabaseVolumesParameters& v,
+                        DatabaseExlusionParameters& e,
+                        DatabaseSFactorsParameters& sf);
+  void read_contrast_xml(std::string filename,
+                         DatabaseContrastParameters& contrast);
 
   std::string guessformat(std::string filename);
   bool check();
+  bool check_factors(DatabaseVolumesParameters& v,
+                     DatabaseExlusionParameters& e,
+                     DatabaseSFactorsParameters& sf);
 
  public:
   DatabaseNamesParameters names;
@@ -306,6 +347,8 @@ class Database {
   DatabaseExlusionParameters exclusionfactors;
   DatabaseSFactorsParameters sfactors;
   DatabaseAtomIDsParameters atomIDs;
+  // one entry per scattering.contrasts.contrast
+  std::vector<DatabaseContrastParameters> contrasts;
 
   void init();
 
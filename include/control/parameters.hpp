@@ -25,6 +25,7 @@ used to adjust the program control flow to the user input files.
 #include <boost/serialization/access.hpp>
 #include <boost/serialization/map.hpp>
 #include <boost/serialization/string.hpp>
+#include <boost/serialization/utility.hpp>
 #include <boost/serialization/vector.hpp>
 
 // other headers
@@ -708,6 +709,8 @@ class ScatteringAverageOrientationMultipoleMomentsParameters
   friend class boost::serialization::access;
   template <class Archive>
   void serialize(Archive& ar, const unsigned int version) {
+    ar& boost::serialization::base_object<
+        std::vector<std::pair<long, long> > >(*this);
     ar& type;
     ar& resolution;
     ar& file;
@@ -773,14 +776,29 @@ class ScatteringAverageOrientationExactParameters {
   template <class Archive>
   void serialize(Archive& ar, const unsigned int version) {
     ar& type;
+    ar& method;
+    ar& binwidth;
+    ar& cutoff;
   }
   ///////////////////
 
  public:
   std::string type;
+  // pairs: Debye sum over all pairs for every q, histogram: pair distance
+  // histograms per frame which are reused for all q
+  std::string method;
+  double binwidth;
+  // pairs beyond the cutoff are ignored by the histograms, 0 = no cutoff
+  double cutoff;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
     ss << std::string(pad, ' ') << "<type>" << type << "</type>" << std::endl;
+    ss << std::string(pad, ' ') << "<method>" << method << "</method>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<binwidth>" << binwidth << "</binwidth>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<cutoff>" << cutoff << "</cutoff>"
+       << std::endl;
     return ss.str();
   }
 };
@@ -873,17 +891,25 @@ class ScatteringDspParameters {
   void serialize(Archive& ar, const unsigned int version) {
     ar& type;
     ar& method;
+    ar& accumulate;
+    ar& max_lag;
   }
   ///////////////////
 
  public:
   std::string type;
   std::string method;
+  std::string accumulate;
+  size_t max_lag;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
     ss << std::string(pad, ' ') << "<type>" << type << "</type>" << std::endl;
     ss << std::string(pad, ' ') << "<method>" << method << "</method>"
        << std::endl;
+    ss << std::string(pad, ' ') << "<accumulate>" << accumulate
+       << "</accumulate>" << std::endl;
+    ss << std::string(pad, ' ') << "<max_lag>" << max_lag << "</max_lag>"
+       << std::endl;
     return ss.str();
   }
 };
@@ -1004,6 +1030,50 @@ class ScatteringSignalParameters {
   }
 };
 
+/**
+Section which defines an additional set of scattering weights (contrast). The
+phases of the main calculation are weighted by the scattering factors of the
+contrast database and its background factor, the results are written to a
+group of the signal file named after the contrast.
+*/
+class ScatteringContrastParameters {
+ private:
+  /////////////////// MPI related
+  // make this class serializable to
+  // allow sample to be transmitted via MPI
+  friend class boost::serialization::access;
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& name;
+    ar& database;
+    ar& databasepath;
+    ar& factor;
+  }
+  ///////////////////
+
+ public:
+  std::string name;
+  // database file, empty for the database of the main calculation
+  std::string database;
+  std::string databasepath;  // runtime
+  double factor;
+  std::string write_xml(int pad = 0) {
+    std::stringstream ss;
+    ss << std::string(pad, ' ') << "<name>" << name << "</name>" << std::endl;
+    if (database.size()) {
+      ss << std::string(pad, ' ') << "<file>" << database << "</file>"
+         << std::endl;
+    }
+    ss << std::string(pad, ' ') << "<background>" << std::endl;
+    ss << std::string(pad + 1, ' ') << "<factor>" << std::endl;
+    ss << std::string(pad + 2, ' ') << "<value>" << factor << "</value>"
+       << std::endl;
+    ss << std::string(pad + 1, ' ') << "</factor>" << std::endl;
+    ss << std::string(pad, ' ') << "</background>" << std::endl;
+    return ss.str();
+  }
+};
+
 /**
 Section which stores parameters used during the scattering calculation
 */
@@ -1021,6 +1091,7 @@ class ScatteringParameters {
     ar& average;
     ar& background;
     ar& signal;
+    ar& contrasts;
   }
   ///////////////////
 
@@ -1034,6 +1105,8 @@ class ScatteringParameters {
   ScatteringBackgroundParameters background;
 
   ScatteringSignalParameters signal;
+
+  std::vector<ScatteringContrastParameters> contrasts;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
     ss << std::string(pad, ' ') << "<type>" << type << "</type>" << std::endl;
@@ -1052,6 +1125,15 @@ class ScatteringParameters {
     ss << std::string(pad, ' ') << "<signal>" << std::endl;
     ss << signal.write_xml(pad + 1);
     ss << std::string(pad, ' ') << "</signal>" << std::endl;
+    if (contrasts.size()) {
+      ss << std::string(pad, ' ') << "<contrasts>" << std::endl;
+      for (size_t i = 0; i < contrasts.size(); ++i) {
+        ss << std::string(pad + 1, ' ') << "<contrast>" << std::endl;
+        ss << contrasts[i].write_xml(pad + 2);
+        ss << std::string(pad + 1, ' ') << "</contrast>" << std::endl;
+      }
+      ss << std::string(pad, ' ') << "</contrasts>" << std::endl;
+    }
     return ss.str();
   }
 };
@@ -1263,6 +1345,7 @@ class LimitsComputationMemoryParameters {
     ar& alignpad_buffer;
     ar& exchange_buffer;
     ar& signal_buffer;
+    ar& phase_buffer;
     ar& scale;
   }
   ///////////////////
@@ -1272,6 +1355,7 @@ class LimitsComputationMemoryParameters {
   size_t alignpad_buffer;
   size_t exchange_buffer;
   size_t signal_buffer;
+  size_t phase_buffer;
   size_t scale;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
@@ -1283,12 +1367,86 @@ class LimitsComputationMemoryParameters {
        << "</exchange_buffer>" << std::endl;
     ss << std::string(pad, ' ') << "<signal_buffer>" << signal_buffer
        << "</signal_buffer>" << std::endl;
+    ss << std::string(pad, ' ') << "<phase_buffer>" << phase_buffer
+       << "</phase_buffer>" << std::endl;
     ss << std::string(pad, ' ') << "<scale>" << scale << "</scale>"
        << std::endl;
     return ss.str();
   }
 };
 
+/**
+Section which stores how phase factors are obtained for consecutive vectors
+*/
+class LimitsComputationPhasesParameters {
+ private:
+  /////////////////// MPI related
+  // make this class serializable to
+  // allow sample to be transmitted via MPI
+  friend class boost::serialization::access;
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& method;
+    ar& reseed;
+    ar& factoring;
+  }
+  ///////////////////
+
+ public:
+  std::string method;
+  size_t reseed;
+  // atoms: phases are weighted per atom, species: unweighted phase sums per
+  // species which are weighted afterwards
+  std::string factoring;
+  std::string write_xml(int pad = 0) {
+    std::stringstream ss;
+    ss << std::string(pad, ' ') << "<method>" << method << "</method>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<reseed>" << reseed << "</reseed>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<factoring>" << factoring
+       << "</factoring>" << std::endl;
+    return ss.str();
+  }
+};
+
+/**
+Section which stores how the FFTW plans for the correlation are created
+*/
+class LimitsComputationFftParameters {
+ private:
+  /////////////////// MPI related
+  // make this class serializable to
+  // allow sample to be transmitted via MPI
+  friend class boost::serialization::access;
+  template <class Archive>
+  void serialize(Archive& ar, const unsigned int version) {
+    ar& planner;
+    ar& wisdom;
+    ar& threads;
+    ar& batch;
+  }
+  ///////////////////
+
+ public:
+  std::string planner;
+  std::string wisdom;
+  size_t threads;
+  size_t batch;
+  std::string write_xml(int pad = 0) {
+    std::stringstream ss;
+    ss << std::string(pad, ' ') << "<planner>" << planner << "</planner>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<wisdom>" << wisdom << "</wisdom>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<threads>" << threads << "</threads>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<batch>" << batch << "</batch>"
+       << std::endl;
+    return ss.str();
+  }
+};
+
 /**
 Section which stores parameters used during the computation
 */
@@ -1304,6 +1462,11 @@ class LimitsComputationParameters {
     ar& memory;
     ar& processes;
     ar& cores;
+    ar& simd;
+    ar& precision;
+    ar& vectorblock;
+    ar& phases;
+    ar& fft;
   }
   ///////////////////
 
@@ -1311,6 +1474,11 @@ class LimitsComputationParameters {
   size_t threads;
   size_t processes;
   size_t cores;
+  std::string simd;
+  std::string precision;
+  size_t vectorblock;
+  LimitsComputationPhasesParameters phases;
+  LimitsComputationFftParameters fft;
   LimitsComputationMemoryParameters memory;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
@@ -1320,6 +1488,17 @@ class LimitsComputationParameters {
        << std::endl;
     ss << std::string(pad, ' ') << "<cores>" << cores << "</cores>"
        << std::endl;
+    ss << std::string(pad, ' ') << "<simd>" << simd << "</simd>" << std::endl;
+    ss << std::string(pad, ' ') << "<precision>" << precision << "</precision>"
+       << std::endl;
+    ss << std::string(pad, ' ') << "<vectorblock>" << vectorblock
+       << "</vectorblock>" << std::endl;
+    ss << std::string(pad, ' ') << "<phases>" << std::endl;
+    ss << phases.write_xml(pad + 1);
+    ss << std::string(pad, ' ') << "</phases>" << std::endl;
+    ss << std::string(pad, ' ') << "<fft>" << std::endl;
+    ss << fft.write_xml(pad + 1);
+    ss << std::string(pad, ' ') << "</fft>" << std::endl;
     ss << std::string(pad, ' ') << "<memory>" << std::endl;
     ss << memory.write_xml(pad + 1);
     ss << std::string(pad, ' ') << "</memory>" << std::endl;
@@ -1425,17 +1604,22 @@ class LimitsStageMemoryParameters {
   void serialize(Archive& ar, const unsigned int version) {
     ar& data;
     ar& buffer;
+    ar& shared;
   }
   ///////////////////
 
  public:
   size_t data;
   size_t buffer;
+  // nodes of a host which stage the same data share a single copy
+  bool shared;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
     ss << std::string(pad, ' ') << "<data>" << data << "</data>" << std::endl;
     ss << std::string(pad, ' ') << "<buffer>" << buffer << "</buffer>"
        << std::endl;
+    ss << std::string(pad, ' ') << "<shared>" << (shared ? "true" : "false")
+       << "</shared>" << std::endl;
     return ss.str();
   }
 };
@@ -1452,16 +1636,21 @@ class LimitsStageParameters {
   template <class Archive>
   void serialize(Archive& ar, const unsigned int version) {
     ar& memory;
+    ar& chunksize;
   }
   ///////////////////
 
  public:
   LimitsStageMemoryParameters memory;
+  // bytes per broadcast when the staged data is cloned to other partitions
+  size_t chunksize;
   std::string write_xml(int pad = 0) {
     std::stringstream ss;
     ss << std::string(pad, ' ') << "<memory>" << std::endl;
     ss << memory.write_xml(pad + 1);
     ss << std::string(pad, ' ') << "</memory>" << std::endl;
+    ss << std::string(pad, ' ') << "<chunksize>" << chunksize
+       << "</chunksize>" << std::endl;
     return ss.str();
   }
 };
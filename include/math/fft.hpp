@@ -0,0 +1,86 @@
+/** \file
+This file contains the plan management for the Fourier transforms used by the
+correlation of signals.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+#ifndef MATH__FFT_HPP_
+#define MATH__FFT_HPP_
+
+// common header
+#include "common.hpp"
+
+// standard header
+#include <map>
+#include <string>
+#include <utility>
+
+// special library headers
+#include <fftw3.h>
+
+// other headers
+
+namespace smath {
+
+/**
+Singleton which creates the FFTW plans for in-place transforms and keeps them
+for the lifetime of the program. Plans are created with a common planner rigor
+and number of threads. Plans of a higher rigor than FFTW_ESTIMATE are
+remembered in the FFTW wisdom, which can be exported and imported to avoid
+repeated measurements. Plans must only be requested by one thread at a time,
+the returned plans may be executed concurrently with the new-array execute
+functions on buffers allocated by fftw_malloc.
+*/
+class FFTPlanner {
+ private:
+  FFTPlanner();
+  FFTPlanner(const FFTPlanner&) {}
+  FFTPlanner& operator=(const FFTPlanner&) { return *this; }
+
+  unsigned flags_;
+  size_t threads_;
+
+  // key = ((transform size, number of transforms), sign), sign 0 denotes real
+  // to complex transforms
+  typedef std::pair<std::pair<size_t, size_t>, int> plankey_t;
+  std::map<plankey_t, fftw_plan> plans_;
+
+ public:
+  static FFTPlanner* Inst() {
+    static FFTPlanner instance;
+    return &instance;
+  }
+  ~FFTPlanner();
+
+  /**
+  Sets the planner rigor (estimate, measure, patient) and the number of threads
+  of plans which are created afterwards. Returns the number of threads which
+  are used, which is 1 if FFTW was built without thread support.
+  */
+  size_t configure(const std::string& rigor, size_t threads);
+
+  bool import_wisdom(const std::string& wisdom);
+  std::string export_wisdom();
+
+  /**
+  Returns a plan for the in-place complex transforms of howmany signals of n
+  elements, which are stored one after the other.
+  */
+  fftw_plan complex_plan(size_t n, int sign, size_t howmany = 1);
+
+  /**
+  Returns a plan for the in-place real to complex transforms of howmany
+  signals of n reals. Every signal occupies a buffer of n complex elements,
+  which holds the reals at its beginning and receives the n/2+1 complex
+  elements of the result.
+  */
+  fftw_plan real_plan(size_t n, size_t howmany = 1);
+};
+}
+
+#endif
+
+// end of file
@@ -0,0 +1,67 @@
+/** \file
+This file contains recurrences which evaluate the special functions of the
+multipole expansion for all orders at once.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+#ifndef MATH__MULTIPOLE_HPP_
+#define MATH__MULTIPOLE_HPP_
+
+// common header
+#include "common.hpp"
+
+// standard header
+#include <complex>
+#include <vector>
+
+// special library headers
+
+// other headers
+
+namespace smath {
+
+/**
+Computes the spherical Bessel functions j_0(x) ... j_L(x). Orders below x are
+computed by upward recurrence, higher orders by Miller's downward recurrence,
+which are both stable in their domain.
+*/
+void sph_bessel_all(long L, double x, double* j);
+
+/**
+Computes the Bessel functions of the first kind J_0(x) ... J_N(x) of integer
+order. Orders below x are computed by upward recurrence, higher orders by
+Miller's downward recurrence normalized by J_0 + 2 sum_k J_2k = 1.
+*/
+void cyl_bessel_j_all(long N, double x, double* J);
+
+/**
+Evaluates the spherical harmonics Y_lm(theta, phi) for 0 <= m <= l <= L by the
+recurrence of the fully normalized associated Legendre functions. The
+conventions (Condon-Shortley phase, theta being the polar angle) are the ones
+of boost::math::spherical_harmonic. Harmonics of negative m follow from
+Y_l(-m) = (-1)^m conj(Y_lm).
+*/
+class SphericalHarmonics {
+ public:
+  SphericalHarmonics(long L);
+
+  // index of Y_lm within the result of evaluate
+  static size_t index(long l, long m) { return l * (l + 1) / 2 + m; }
+  size_t size() const { return index(L_, L_) + 1; }
+
+  void evaluate(double theta, double phi, std::complex<double>* Y) const;
+
+ private:
+  long L_;
+  // recurrence coefficients of the normalized Legendre functions
+  std::vector<double> a_;
+  std::vector<double> b_;
+};
+}
+
+#endif
+
+// end of file
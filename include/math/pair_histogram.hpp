@@ -0,0 +1,53 @@
+/** \file
+This file contains functions which build histograms of the pair distances of
+a frame, sorted by the species of the atoms of a pair.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+#ifndef MATH__PAIR_HISTOGRAM_HPP_
+#define MATH__PAIR_HISTOGRAM_HPP_
+
+// common header
+#include "common.hpp"
+
+// standard header
+#include <vector>
+
+// special library headers
+
+// other headers
+
+namespace smath {
+
+/**
+Index of the histogram of the species pair (s, t), which is symmetric in s and
+t. NS species form NS (NS + 1) / 2 pairs.
+*/
+inline size_t species_pair(size_t s, size_t t) {
+  return (s <= t) ? t * (t + 1) / 2 + s : s * (s + 1) / 2 + t;
+}
+
+/**
+Adds every pair i < j of the N atoms, given as x, y and z planes, to bin
+floor(r_ij / binwidth) of the histogram of its species pair. H holds NBINS
+bins per species pair, distances beyond the last bin are counted in the last
+bin. A cutoff > 0 skips pairs at distances of at least cutoff and finds the
+remaining pairs by cell lists, which scales linearly with N at constant
+density.
+*/
+void pair_histogram(const coor_t* x, const coor_t* y, const coor_t* z,
+                    const size_t* species, size_t NS, size_t N,
+                    double binwidth, size_t NBINS, double cutoff, double* H);
+
+/**
+Computes sin(q r_k) / (q r_k) at the bin centers r_k = (k + 1/2) binwidth.
+*/
+void sinc_table(double q, double binwidth, size_t NBINS, double* S);
+}
+
+#endif
+
+// end of file
@@ -0,0 +1,127 @@
+/** \file
+This file contains vectorized kernels for the scattering calculation and the
+runtime detection of the instruction set extensions they depend on.
+
+The vectorized kernels evaluate sine and cosine with a Cody-Waite range
+reduction and minimax polynomials instead of calling libm. For phases
+|q*r| < 1e5 every term agrees with the libm result to within a few ulp, and
+a complete phase sum agrees with the scalar kernel to within 1e-12 relative to
+the sum of the absolute scattering factors. The remaining difference stems from
+the altered summation order.
+
+In mixed precision the phases, their range reduction and the polynomials are
+evaluated in single precision with twice the number of lanes, and the weighted
+terms are accumulated in double precision. Every term then carries an error of
+about 1e-7 * |q*r|, which is reported by the scatter devices for a sample.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+#ifndef MATH__SIMD_HPP_
+#define MATH__SIMD_HPP_
+
+// common header
+#include "common.hpp"
+
+// standard header
+#include <string>
+
+// special library headers
+
+// other headers
+
+namespace smath {
+
+/**
+Instruction set extensions, ordered by capability
+*/
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2 };
+
+/**
+Precision of the arithmetic of the phase sums. The coordinates are always stored
+as coor_t and the sums are always accumulated in double precision.
+*/
+enum Precision { PRECISION_DOUBLE = 0, PRECISION_MIXED = 1 };
+
+/**
+Returns the most capable instruction set extension supported by the running CPU
+*/
+SimdLevel simd_detect();
+
+/**
+Returns a human readable name of the instruction set extension
+*/
+std::string simd_name(SimdLevel level);
+
+/**
+Returns a human readable name of the precision
+*/
+std::string precision_name(Precision precision);
+
+/**
+Computes the scattering amplitude sum_j f_j * exp(i q*r_j) for coordinates
+stored as separate x, y and z planes.
+*/
+void phase_sum(SimdLevel level, Precision precision, const coor_t* x,
+               const coor_t* y, const coor_t* z, const double* factors,
+               size_t N, double qx, double qy, double qz, double& Ar,
+               double& Ai);
+
+/**
+Computes the scattering amplitudes for K q vectors in one pass over the atoms.
+The coordinates of each atom are loaded once and reused for a tile of q
+vectors, which keeps the kernel bound by arithmetic rather than memory
+bandwidth. Results are identical to K separate calls of phase_sum.
+*/
+void phase_sum_block(SimdLevel level, Precision precision, const coor_t* x,
+                     const coor_t* y, const coor_t* z, const double* factors,
+                     size_t N, const double* qx, const double* qy,
+                     const double* qz, size_t K, double* Ar, double* Ai);
+
+/**
+Stores the phase factors exp(i q*r_j) as separate real and imaginary arrays.
+*/
+void phase_factors(SimdLevel level, const coor_t* x, const coor_t* y,
+                   const coor_t* z, size_t N, double qx, double qy, double qz,
+                   double* re, double* im);
+
+/**
+Advances the phase factors by multiplying them with the step factors
+exp(i dq*r_j) and returns the weighted sum of the advanced phase factors.
+*/
+void phase_advance(SimdLevel level, double* re, double* im,
+                   const double* step_re, const double* step_im,
+                   const double* factors, size_t N, double& Ar, double& Ai);
+
+/**
+Computes the unnormalized auto-correlation sum_k a_k * conj(a_k+tau) of the
+signal a = re + i*im of N frames for the lags tau < L <= N. The result is
+stored as interleaved real and imaginary parts in c (2*L). Lags are evaluated
+in tiles over blocks of frames, which keeps the signal in cache and costs
+O(N*L).
+*/
+void correlate_direct(SimdLevel level, const double* re, const double* im,
+                      size_t N, size_t L, double* c);
+
+/**
+Computes the Debye sum sum_i sum_j f_i f_j sin(q r_ij) / (q r_ij) over the
+atoms i0 <= i < i1 and j0 <= j < j1 for coordinates stored as separate x, y and
+z planes. Pairs at zero distance contribute f_i f_j. The partner atoms are
+processed in blocks which stay in cache while the atoms i stream by.
+*/
+double debye_sum(SimdLevel level, const coor_t* x, const coor_t* y,
+                 const coor_t* z, const double* factors, double q, size_t i0,
+                 size_t i1, size_t j0, size_t j1);
+
+/**
+Returns the weighted sum of the phase factors.
+*/
+void phase_reduce(const double* re, const double* im, const double* factors,
+                  size_t N, double& Ar, double& Ai);
+}
+
+#endif
+
+// end of file
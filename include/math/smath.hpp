@@ -22,6 +22,7 @@ This file contains mathemical routines.
 // other headers
 #include "control.hpp"
 #include "log.hpp"
+#include "math/simd.hpp"
 
 namespace smath {
 
@@ -111,12 +112,54 @@ Replaces the data within the array with its auto-correlated value using FFT
 void auto_correlate_fftw(fftw_complex* data, fftw_plan p1, fftw_plan p2,
                          size_t NF);
 
+/**
+Replaces the data within the array with its auto-correlated value using FFT
+(scales with N). p1 is the forward complex transform of 2*NF elements. The
+power spectrum is real, hence its back transformation is computed by the real
+to complex transform p2 of 2*NF reals at half the cost. With howmany > 1 the
+signals are stored one after the other in buffers of 2*NF elements and the
+plans have to transform all of them at once.
+*/
+void auto_correlate_fftw_r2c(fftw_complex* data, fftw_plan p1, fftw_plan p2,
+                             size_t NF, size_t howmany = 1);
+
+/**
+First half of auto_correlate_fftw_r2c. Replaces every signal of 2*NF elements
+by its power spectrum, which is packed into the first 2*NF reals of its buffer.
+*/
+void power_spectrum_fftw(fftw_complex* data, fftw_plan p1, size_t NF,
+                         size_t howmany = 1);
+
+/**
+Second half of auto_correlate_fftw_r2c. Replaces the packed power spectra by
+the auto-correlations of NF elements. The spectra may also be sums of the
+spectra of several signals.
+*/
+void auto_correlate_power(fftw_complex* data, fftw_plan p2, size_t NF,
+                          size_t howmany = 1);
+
 /**
 Replaces the data within the array with its auto-correlated value using FFT
 (scales with N)
 */
 void auto_correlate_direct(fftw_complex* data, size_t N);
 
+/**
+Replaces the data within the array with its auto-correlated value using the
+direct method (scales with N*N). wspace holds N elements and receives a copy of
+the original data, e.g. the zero padding of a 2*N signal.
+*/
+void auto_correlate_direct(fftw_complex* data, size_t N, fftw_complex* wspace);
+
+/**
+Replaces the data within the array with its auto-correlated value using the
+blocked direct kernel of the given instruction set. Only the lags tau < L are
+computed (scales with N*L), the remaining N-L elements are set to zero. L=0
+computes all lags. wspace holds N elements.
+*/
+void auto_correlate_direct(fftw_complex* data, size_t N, fftw_complex* wspace,
+                           size_t L, SimdLevel level);
+
 /**
 Element-wise squaring of an array
 */
@@ -10,8 +10,12 @@ the network.
 #ifndef MPI__WRAPPER_HPP_
 #define MPI__WRAPPER_HPP_
 
+#include <vector>
+
 #include <boost/mpi.hpp>
 
+#include "common.hpp"
+
 namespace mpi {
 namespace wrapper {
 /**
@@ -26,6 +30,64 @@ serializable.
 */
 template <class T>
 void broadcast_class(boost::mpi::communicator& comm, T& any, size_t root);
+
+/**
+Starts a non-blocking all to all exchange of n doubles per node. Neither buffer
+may be touched until the returned request completed.
+*/
+MPI_Request iall_to_all(boost::mpi::communicator& comm, double* in, size_t n,
+                        double* out);
+
+/**
+Gathers consecutive segments of data from all nodes into data on all nodes.
+Node i contributes counts[i] doubles, which it has to hold in place at the
+offset of its segment.
+*/
+void all_gather_in_place(boost::mpi::communicator& comm, double* data,
+                         const std::vector<size_t>& counts);
+
+/**
+Arguments of a non-blocking exchange of blocks, which have to persist until the
+exchange completed.
+*/
+struct BlockExchange {
+  MPI_Request request;
+  std::vector<int> counts;
+  std::vector<int> sendoffsets;
+  std::vector<int> recvoffsets;
+};
+
+/**
+Starts a non-blocking exchange of blocks of blocksize coordinates. Node i
+receives the n consecutive blocks at in + offsets[i] * blocksize, the blocks
+from node i are placed at out + i * n * blocksize. Counts and offsets are in
+blocks, which keeps them within the int range of MPI. Complete the exchange by
+waiting for exchange.request.
+*/
+void iall_to_all_blocks(boost::mpi::communicator& comm, coor_t* in,
+                        const std::vector<size_t>& offsets, size_t n,
+                        size_t blocksize, coor_t* out,
+                        BlockExchange& exchange);
+
+/**
+Broadcasts n coordinates in chunks of chunksize coordinates. Every chunk is a
+non-blocking broadcast of its own and several chunks are in flight at once,
+which pipelines them through the broadcast tree. The counts stay within the int
+range of MPI for any n.
+*/
+void broadcast_chunked(boost::mpi::communicator& comm, coor_t* data, size_t n,
+                       size_t chunksize, int root);
+
+/**
+Blocks until a non-blocking communication request completed.
+*/
+void wait(MPI_Request& request);
+
+/**
+Drives the progress of a non-blocking communication request, returns whether
+it completed.
+*/
+bool test(MPI_Request& request);
 }
 }
 
@@ -97,6 +97,8 @@ class Timer {
 
   void start(std::string tk);
   void stop(std::string tk);
+  // adds a sample which is not a duration, e.g. a number of bytes
+  void record(std::string tk, double value);
 
   double sum(std::string tk);
   double min(std::string tk);
@@ -32,6 +32,7 @@ class IAtomselection {
  public:
   virtual size_t operator[](size_t index) = 0;
   virtual size_t size() = 0;
+  virtual ~IAtomselection() {}
 };
 
 /**
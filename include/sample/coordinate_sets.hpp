@@ -123,6 +123,14 @@ class CoordinateSets {
   Atoms* p_atoms;
   IAtomselection* p_selection;
 
+  // atoms which are read from a frame, i.e. those of the selection and of the
+  // alignments and motions, and their ranges. NULL if all atoms of the system
+  // have to be read.
+  IndexAtomselection* p_loadselection;
+  AtomRanges m_loadranges;
+  bool m_loadselection_ready;
+  void init_loadselection();
+
   CoordinateRepresentation m_representation;
 
  public:
@@ -130,6 +138,11 @@ class CoordinateSets {
   ~CoordinateSets();
 
   CoordinateSet* load(size_t frame);
+  // points x, y and z to the coordinates of a frame within a memory mapped
+  // trajectory, indexed by atom. Only possible if the frame is loaded without
+  // any alignment or motion into a cartesian representation, otherwise the
+  // frame has to be loaded.
+  bool map(size_t frame, const float*& x, const float*& y, const float*& z);
 
   // std::vector<CartesianCoor3D> get_prealignmentvectors(size_t frame);
   // std::vector<CartesianCoor3D> get_postalignmentvectors(size_t frame);
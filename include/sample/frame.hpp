@@ -14,6 +14,7 @@ This file contains a class which defines the contents of a generic frame.
 
 // standard header
 #include <string>
+#include <utility>
 #include <vector>
 
 // special library headers
@@ -32,6 +33,12 @@ This file contains a class which defines the contents of a generic frame.
 class Atom;
 class Atoms;
 
+/**
+Ranges of atom indexes first ... second-1 which are read from a frame, ordered
+and without overlap.
+*/
+typedef std::vector<std::pair<size_t, size_t> > AtomRanges;
+
 /**
 Stores Frame information and resembles the trajectory data
 */
@@ -85,6 +85,12 @@ class Frames {
 
   // load a Frame
   Frame load(size_t framenumber);
+  // load the atoms of the ranges of a Frame, see Frameset::read_frame_ranges
+  Frame load(size_t framenumber, const AtomRanges& ranges);
+
+  // see Frameset::map_frame, fails unless the frame has number_of_atoms atoms
+  bool map(size_t framenumber, size_t number_of_atoms, const float*& x,
+           const float*& y, const float*& z);
 };
 
 /**
@@ -106,6 +112,19 @@ class Frameset {
 
   // derived classes have to support this!
   virtual void read_frame(size_t framenumber, Frame& cf) = 0;
+
+  // reads only the atoms of the ranges, which are stored consecutively in cf.
+  // cf.number_of_atoms is the number of atoms of the whole frame. Formats
+  // which cannot seek to atoms read the whole frame and drop the others.
+  virtual void read_frame_ranges(size_t framenumber, const AtomRanges& ranges,
+                                 Frame& cf);
+
+  // points x, y and z to the coordinates of a frame in place, if the format
+  // stores them as blocks of floats which can be mapped into memory
+  virtual bool map_frame(size_t framenumber, const float*& x, const float*& y,
+                         const float*& z) {
+    return false;
+  }
 };
 
 /**
@@ -197,22 +216,39 @@ class DCDFrameset : public FileFrameset {
 
   std::ifstream dcdfile;
 
+  // read-only mapping of the whole file, established by the first access to
+  // a frame. If the file cannot be mapped, frames are read from dcdfile.
+  char* p_map_;
+  size_t map_size_;
+  bool map_failed_;
+  bool map_file();
+  void read_unitcell(size_t internalframenumber, Frame& cf);
+  // appends count coordinates, starting at atom first, of the block at
+  // byte_offset within a frame
+  void read_block(size_t internalframenumber, std::streamoff byte_offset,
+                  size_t first, size_t count, std::vector<coor2_t>& v);
+
   bool detect(const std::string filename);
 
  public:
   // allow construction w/o reading file -> call init manually
-  DCDFrameset() {}
+  DCDFrameset() : p_map_(NULL), map_size_(0), map_failed_(false) {}
   ~DCDFrameset();
   void init(std::string filename, size_t framenumber_offset);
 
   // this constructor should be called by default
-  DCDFrameset(std::string filename, size_t frame_number_offset) {
+  DCDFrameset(std::string filename, size_t frame_number_offset)
+      : p_map_(NULL), map_size_(0), map_failed_(false) {
     init(filename, frame_number_offset);
   }
 
   // internalframenumber used for positioning file pointer, data loaded into
   // Frame argument
   void read_frame(size_t framenumber, Frame& cf);
+  void read_frame_ranges(size_t framenumber, const AtomRanges& ranges,
+                         Frame& cf);
+  bool map_frame(size_t framenumber, const float*& x, const float*& y,
+                 const float*& z);
 
   // fill frame_offsets. non-seekable files have to be scanned completely!
   void generate_index();
@@ -312,6 +348,9 @@ class TRRFrameset : public FileFrameset {
   // internalframenumber used for positioning file pointer, data loaded into
   // Frame argument
   void read_frame(size_t framenumber, Frame& cf);
+  // seeks to the coordinates of the ranges within the frame
+  void read_frame_ranges(size_t framenumber, const AtomRanges& ranges,
+                         Frame& cf);
 
   // fill frame_offsets. non-seekable files have to be scanned completely!
   void generate_index();
@@ -338,6 +377,10 @@ class CloneFrameset : public Frameset {
   // internalframenumber used for positioning file pointer, data loaded into
   // Frame argument
   void read_frame(size_t framenumber, Frame& cf);
+  void read_frame_ranges(size_t framenumber, const AtomRanges& ranges,
+                         Frame& cf);
+  bool map_frame(size_t framenumber, const float*& x, const float*& y,
+                 const float*& z);
 };
 
 #endif
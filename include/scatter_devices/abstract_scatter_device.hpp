@@ -17,6 +17,7 @@ derived.
 // standard header
 #include <sys/time.h>
 #include <complex>
+#include <deque>
 #include <map>
 #include <queue>
 #include <string>
@@ -28,68 +29,87 @@ derived.
 #include <boost/accumulators/statistics.hpp>
 #include <boost/mpi.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
+#include <boost/function.hpp>
 #include <boost/thread.hpp>
 
 // other headers
 #include "decomposition/assignment.hpp"
 #include "math/coor3d.hpp"
+#include "math/simd.hpp"
 #include "report/timer.hpp"
 #include "scatter_devices/scatter_factors.hpp"
 #include "services.hpp"
 
 /**
-Efficent Thread-safe version of a queue
+Pool of worker threads which execute independent tasks. Every worker owns a
+deque of tasks; it takes work from the back of its own deque and steals from
+the front of the other deques once its own deque is empty.
 */
-template <typename Data>
-class concurrent_queue {
+class TaskPool {
+ public:
+  typedef boost::function<void()> Task;
+
+  TaskPool(size_t numthreads);
+  ~TaskPool();
+
+  void submit(const Task& task);
+
+  // blocks until all submitted tasks have finished
+  void wait();
+  // returns true if all submitted tasks have finished within the duration
+  bool timed_wait(const boost::posix_time::time_duration& duration);
+
+  size_t size() const { return threads_.size(); }
+  std::vector<boost::thread::id> get_ids() const;
+
  private:
-  std::queue<Data> the_queue;
-  mutable boost::mutex the_mutex;
-  boost::condition_variable the_condition_variable;
+  struct TaskDeque {
+    std::deque<Task> tasks;
+    boost::mutex mutex;
+  };
+
+  std::vector<TaskDeque*> deques_;
+  std::vector<boost::thread*> threads_;
+
+  boost::mutex mutex_;
+  boost::condition_variable work_available_;
+  boost::condition_variable all_done_;
+  size_t queued_;
+  size_t pending_;
+  size_t next_;
+  bool stop_;
+
+  bool pop(size_t id, Task& task);
+  void run(size_t id);
+};
 
+/**
+Pool of aligned scratch buffers of equal size. Buffers are reserved once and
+recycled afterwards, so the hot loop does not touch the heap. Buffers which
+have to be allocated beyond the reservation are counted.
+*/
+class ScratchArena {
  public:
-  void push(Data const& data) {
-    boost::mutex::scoped_lock lock(the_mutex);
-    the_queue.push(data);
-    lock.unlock();
-
-    // notify everyone who tries to push
-    the_condition_variable.notify_all();
-  }
-
-  bool empty() const {
-    boost::mutex::scoped_lock lock(the_mutex);
-    return the_queue.empty();
-  }
-
-  size_t size() const { return the_queue.size(); }
-
-  bool try_pop(Data& popped_value) {
-    boost::mutex::scoped_lock lock(the_mutex);
-    if (the_queue.empty()) {
-      return false;
-    }
-
-    popped_value = the_queue.front();
-    the_queue.pop();
-    // notify everyone who tries to push
-    return true;
-  }
-
-  void wait_and_pop(Data& popped_value) {
-    boost::mutex::scoped_lock lock(the_mutex);
-    while (the_queue.empty()) {
-      the_condition_variable.wait(lock);
-    }
-
-    popped_value = the_queue.front();
-    the_queue.pop();
-  }
-
-  void wait_for_empty() {
-    while (!the_queue.empty())
-      boost::this_thread::sleep(boost::posix_time::milliseconds(25));
-  }
+  ScratchArena();
+  ~ScratchArena();
+
+  // replaces all buffers by count buffers of size elements
+  void reserve(size_t size, size_t count);
+
+  fftw_complex* acquire();
+  void release(fftw_complex* buffer);
+
+  // returns the bytes allocated beyond the reservation and resets the counter
+  size_t take_allocated();
+
+ private:
+  size_t size_;
+  std::vector<fftw_complex*> buffers_;
+  std::vector<fftw_complex*> free_;
+  size_t allocated_;
+  boost::mutex mutex_;
+
+  void clear();
 };
 
 /**
@@ -133,11 +153,16 @@ class AbstractScatterDevice : public IScatterDevice {
 
   ScatterFactors scatterfactors;
 
+  // instruction set used by the vectorized kernels
+  smath::SimdLevel simd_;
+  // precision of the arithmetic of the phase sums
+  smath::Precision precision_;
+
   virtual void stage_data() = 0;
   virtual void compute() = 0;
 
   void next();
-  void write();
+  virtual void write();
 
   void runner();
 
@@ -147,11 +172,21 @@ class AbstractScatterDevice : public IScatterDevice {
   virtual void print_post_runner_info() {}
 
   virtual bool ram_check();
+  // configures the FFTW planner and shares the wisdom file across processes
+  void init_fft();
+  void save_fft_wisdom();
   void start_workers();
   void stop_workers();
-  virtual void worker() = 0;
-  std::queue<boost::thread*> worker_threads;
-  boost::barrier* workerbarrier;
+  TaskPool* taskpool_;
+
+  // serializes the accumulation of post-processed signals
+  boost::mutex store_mutex_;
+  void wait_for_tasks();
+
+  // zero padded signals (2*NF) of the running tasks
+  ScratchArena scratch_;
+  virtual void reserve_scratch();
+  virtual size_t take_allocated();
 
   size_t status();
   double progress();
@@ -46,6 +46,23 @@ class AbstractVectorsScatterDevice : public AbstractScatterDevice {
   double progress();
   void init_subvectors(CartesianCoor3D& q);
 
+  /**
+  Determines how the phase factors of the current subvectors are obtained.
+  For linear scans the phase factors of the previous vector are advanced by
+  the constant step, with an exact evaluation every reseed vectors.
+  */
+  enum PhaseUpdate {
+    PHASES_EXACT,    // evaluate, nothing is cached
+    PHASES_SEED,     // evaluate and cache
+    PHASES_ADVANCE,  // multiply cached phases by the cached step
+    PHASES_RESTEP    // evaluate a new step, then advance
+  };
+  PhaseUpdate phaseupdate_;
+  size_t phases_age_;
+  std::vector<CartesianCoor3D> previous_subvectors_;
+  std::vector<CartesianCoor3D> step_subvectors_;
+  void init_phaseupdate();
+
   void print_pre_stage_info();
   void print_post_stage_info();
   void print_pre_runner_info();
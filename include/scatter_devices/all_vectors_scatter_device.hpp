@@ -33,6 +33,7 @@ scattering.
 
 // other headers
 #include "math/coor3d.hpp"
+#include "math/simd.hpp"
 #include "report/timer.hpp"
 #include "sample.hpp"
 
@@ -43,31 +44,92 @@ Implements all type scattering using vectors for orientational averaging
 */
 class AllVectorsScatterDevice : public AbstractVectorsScatterDevice {
  protected:
-  // first = q, second = frames
-  fftw_complex* at_;
-
-  // data, outer loop by frame, inner by atoms, XYZ entries
+  // ring of signal buffers, first = q, second = frames, every slot holds the
+  // signals of a block before the exchange
+  std::vector<fftw_complex*> at_;
+  // ring of receive buffers, one per slot of at_
+  std::vector<fftw_complex*> atexchange_;
+  // exchange of the previous block which is still in flight
+  MPI_Request exchange_request_;
+
+  // signals of a tile of vectors (NV*NF) of the running tasks
+  ScratchArena tiles_;
+  void reserve_scratch();
+  size_t take_allocated();
+
+  // data, outer loop by frame, inner by x, y and z planes of atoms
   coor_t* p_coordinates;
 
-  void scatter(size_t this_subvector);
+  // with limits.computation.phases.factoring=species the atoms are staged in
+  // the order of their species, species s covers the atoms
+  // species_offsets_[s] ... species_offsets_[s+1]-1. The unweighted phase
+  // sums of the species are weighted by the species factors afterwards.
+  bool species_factoring_;
+  std::vector<size_t> species_offsets_;
+  std::vector<double> unit_factors_;
+  // scattering factors in the order of the staged atoms
+  std::vector<double> staged_factors_;
+  void update_staged_factors();
+
+  // number of weight sets, the main scattering factors are followed by one
+  // set per scattering.contrasts. The signals of weight set w of a tile of
+  // vectors follow those of w-1, i.e. signal k of w is w*NV+k.
+  size_t NW;
+  std::vector<double>& weights(size_t w);
+  // results of the additional contrasts, see atfinal_, afinal_ and a2final_
+  std::vector<fftw_complex*> atcontrasts_;
+  std::vector<std::complex<double> > acontrasts_;
+  std::vector<std::complex<double> > a2contrasts_;
+
+  // number of vectors handled by one worker per pass over the atoms
+  size_t vectorblock_;
+
+  // phase factors and steps for the recurrence, per vector and frame the real
+  // and imaginary parts of all atoms
+  std::vector<double> phases_;
+  std::vector<double> steps_;
+
+  // the frames f0 ... f1-1 of this node of a tile of vectors
+  void scatter(size_t this_subvector, fftw_complex* p_a, size_t stride,
+               size_t f0, size_t f1);
+  void scatter_recurrence(size_t this_subvector, fftw_complex* p_a,
+                          size_t stride, size_t f0, size_t f1);
+  // number of frame ranges per tile, which keeps all threads busy if there
+  // are fewer tiles than threads
+  size_t frame_ranges(size_t NTILES);
+  // reports the deviation of the selected precision from double precision
+  void check_precision();
+  // adds the unweighted phase sums (Sr, Si) of species s for NQ vectors,
+  // weighted by the species factor of weight set w, to (Ar, Ai)
+  void add_species(size_t s, size_t w, size_t NQ, const double* Sr,
+                   const double* Si, double* Ar, double* Ai);
 
   void stage_data();
 
-  concurrent_queue<size_t> atscatter_;
-  void worker();
+  void task_scatter(size_t this_subvector, fftw_complex* p_a, size_t stride,
+                    size_t f0, size_t f1);
+  void task_dspstore(fftw_complex* at, size_t w);
+  void task_alignpad_dspstore(fftw_complex* at, size_t w);
+  void task_scatter_dspstore(size_t this_subvector);
+  void scatter_dspstore_ranges(size_t NRANGES);
   void compute();
 
-  void scatterblock(size_t index, size_t count);
-  void store(fftw_complex* at);
+  void store(fftw_complex* at, size_t w);
+  void reduce(fftw_complex*& at, std::complex<double>& a,
+              std::complex<double>& a2);
+  void write();
   void dsp(fftw_complex* at);
-  fftw_complex* alignpad(fftw_complex* at);
-  fftw_complex* exchange();
+  fftw_complex* alignpad(fftw_complex* at, size_t stride);
+  void exchange_start(size_t slot);
+  fftw_complex* exchange_wait(size_t slot);
+  void dspstore_block(size_t first, fftw_complex* at);
 
   bool ram_check();
 
   ~AllVectorsScatterDevice();
+  // plans are owned by smath::FFTPlanner
   fftw_plan fftw_planF_;
-  fftw_plan fftw_planB_;
+  fftw_plan fftw_planR_;
 
  public:
   AllVectorsScatterDevice(boost::mpi::communicator allcomm,
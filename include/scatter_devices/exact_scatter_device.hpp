@@ -0,0 +1,104 @@
+/** \file
+This file contains a class which implements the scattering calculation for
+exact spherical orientational averaging by the Debye pair sum ( which is all
+type scattering ).
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+#ifndef SCATTER_DEVICES__EXACT_SCATTER_DEVICE_HPP_
+#define SCATTER_DEVICES__EXACT_SCATTER_DEVICE_HPP_
+
+// common header
+#include "common.hpp"
+
+// standard header
+#include <complex>
+#include <map>
+#include <string>
+#include <vector>
+
+// special library headers
+#include <boost/mpi.hpp>
+#include <boost/thread.hpp>
+
+// other headers
+#include "math/coor3d.hpp"
+#include "report/timer.hpp"
+#include "scatter_devices/abstract_scatter_device.hpp"
+
+/**
+Implements all type scattering with exact spherical orientational averaging.
+The averaged intensity of a frame is the Debye sum
+sum_ij b_i b_j sin(q r_ij) / (q r_ij), the averaged amplitude is
+sum_j b_j sin(q r_j) / (q r_j). Frames are distributed among the nodes of a
+partition, the pairs of a frame are split into blocks of rows which are
+processed by the worker threads. In histogram mode the pair distances of every
+frame are binned once per species pair, which turns the Debye sum of each q
+vector into a product of the histograms with a table of sinc values.
+*/
+class ExactSphereScatterDevice : public AbstractScatterDevice {
+ protected:
+  // number of atoms in a block of rows of the pair matrix
+  size_t rowblock_;
+  // number of blocks of rows per frame
+  size_t NB;
+  // contributions of the blocks, first = frames of this node, second = blocks
+  std::vector<double> partials_;
+  size_t current_block_;
+
+  double progress();
+
+  void print_pre_stage_info();
+  void print_post_stage_info();
+  void print_pre_runner_info();
+  void print_post_runner_info();
+
+  void reserve_scratch();
+
+  // data, outer loop by frame, inner by x, y and z planes of atoms
+  coor_t* p_coordinates;
+
+  // species of the atoms and number of species, see ScatterFactors
+  std::vector<size_t> species_;
+  size_t NS;
+  // number of species pairs and of bins per histogram
+  size_t NP;
+  size_t NBINS;
+  // pair distance histograms, first = frames of this node, second = species
+  // pairs, third = bins
+  std::vector<double> histograms_;
+  bool histograms_ready_;
+  // sinc values at the bin centers for the current q vector
+  std::vector<double> sinc_;
+  // nodes of the other partitions, which own the same frames
+  boost::mpi::communicator interpartitioncomm_;
+
+  void scatter_rows(size_t fi, size_t ib);
+  void scatter_origin(size_t fi);
+  void scatter_histogram(size_t fi);
+
+  void stage_data();
+  void init_histograms();
+  void build_histograms();
+
+  void task_scatter_rows(size_t fi, size_t ib);
+  void task_histogram(size_t fi);
+  void task_scatter_histogram(size_t fi);
+  void compute();
+
+  ~ExactSphereScatterDevice();
+
+ public:
+  ExactSphereScatterDevice(
+      boost::mpi::communicator allcomm, boost::mpi::communicator partitioncomm,
+      Sample& sample, std::vector<CartesianCoor3D> vectors, size_t NAF,
+      boost::asio::ip::tcp::endpoint fileservice_endpoint,
+      boost::asio::ip::tcp::endpoint monitorservice_endpoint);
+};
+
+#endif
+
+// end of file
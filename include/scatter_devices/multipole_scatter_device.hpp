@@ -48,8 +48,6 @@ class MPSphereScatterDevice : public AbstractScatterDevice {
   std::vector<std::pair<long, long> > multipole_index_;
   size_t current_moment_;
 
-  std::vector<std::complex<double> > j_l;
-
   double progress();
   void init_moments(CartesianCoor3D& q);
 
@@ -62,29 +60,44 @@ class MPSphereScatterDevice : public AbstractScatterDevice {
 
   // from all vectors scatter device
 
-  // first = q, second = frames
-  fftw_complex* at_;
+  // ring of signal buffers, first = q, second = frames, every slot holds the
+  // signals of a block before the exchange
+  std::vector<fftw_complex*> at_;
+  // ring of receive buffers, one per slot of at_
+  std::vector<fftw_complex*> atexchange_;
+  // exchange of the previous block which is still in flight
+  MPI_Request exchange_request_;
+  void reserve_scratch();
 
   // data, outer loop by frame, inner by atoms, XYZ entries
   coor_t* p_coordinates;
 
-  void scatter(size_t this_subvector);
+  // amplitudes of all moments, first = moments, second = frames of this node,
+  // which are evaluated in one pass over the atoms of a frame
+  fftw_complex* amplitudes_;
+  void scatter_frames(size_t first, size_t count);
+  void task_scatter_frames(size_t first, size_t count);
+
+  void scatter(size_t this_moment, fftw_complex* p_a);
 
   void stage_data();
 
-  concurrent_queue<size_t> atscatter_;
-  void worker();
+  void task_scatter(size_t this_moment, fftw_complex* p_a);
+  void task_dspstore(fftw_complex* at);
+  void task_scatter_dspstore(size_t this_moment);
   void compute();
 
-  void scatterblock(size_t index, size_t count);
   void store(fftw_complex* at);
   void dsp(fftw_complex* at);
   fftw_complex* alignpad(fftw_complex* at);
-  fftw_complex* exchange();
+  void exchange_start(size_t slot);
+  fftw_complex* exchange_wait(size_t slot);
+  void dspstore_block(size_t first, fftw_complex* at);
 
   ~MPSphereScatterDevice();
+  // plans are owned by smath::FFTPlanner
   fftw_plan fftw_planF_;
-  fftw_plan fftw_planB_;
+  fftw_plan fftw_planR_;
 
  public:
   MPSphereScatterDevice(boost::mpi::communicator allcomm,
@@ -102,13 +115,12 @@ class MPCylinderScatterDevice : public AbstractScatterDevice {
  protected:
   // from abstract vectors scatter device
   size_t NM;
+  long LMAX;
 
   CartesianCoor3D qvector_;
   std::vector<std::pair<long, long> > multipole_index_;
   size_t current_moment_;
 
-  std::vector<std::complex<double> > j_l;
-
   double progress();
   void init_moments(CartesianCoor3D& q);
 
@@ -121,29 +133,44 @@ class MPCylinderScatterDevice : public AbstractScatterDevice {
 
   // from all vectors scatter device
 
-  // first = q, second = frames
-  fftw_complex* at_;
+  // ring of signal buffers, first = q, second = frames, every slot holds the
+  // signals of a block before the exchange
+  std::vector<fftw_complex*> at_;
+  // ring of receive buffers, one per slot of at_
+  std::vector<fftw_complex*> atexchange_;
+  // exchange of the previous block which is still in flight
+  MPI_Request exchange_request_;
+  void reserve_scratch();
 
   // data, outer loop by frame, inner by atoms, XYZ entries
   coor_t* p_coordinates;
 
-  void scatter(size_t this_subvector);
+  // amplitudes of all moments, first = moments, second = frames of this node,
+  // which are evaluated in one pass over the atoms of a frame
+  fftw_complex* amplitudes_;
+  void scatter_frames(size_t first, size_t count);
+  void task_scatter_frames(size_t first, size_t count);
+
+  void scatter(size_t this_moment, fftw_complex* p_a);
 
   void stage_data();
 
-  concurrent_queue<size_t> atscatter_;
-  void worker();
+  void task_scatter(size_t this_moment, fftw_complex* p_a);
+  void task_dspstore(fftw_complex* at);
+  void task_scatter_dspstore(size_t this_moment);
   void compute();
 
-  void scatterblock(size_t index, size_t count);
   void store(fftw_complex* at);
   void dsp(fftw_complex* at);
   fftw_complex* alignpad(fftw_complex* at);
-  fftw_complex* exchange();
+  void exchange_start(size_t slot);
+  fftw_complex* exchange_wait(size_t slot);
+  void dspstore_block(size_t first, fftw_complex* at);
 
   ~MPCylinderScatterDevice();
+  // plans are owned by smath::FFTPlanner
   fftw_plan fftw_planF_;
-  fftw_plan fftw_planB_;
+  fftw_plan fftw_planR_;
 
  public:
   MPCylinderScatterDevice(
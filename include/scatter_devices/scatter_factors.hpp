@@ -14,18 +14,22 @@ factors which may depend on atom and q vector lengths.
 #include "common.hpp"
 
 // standard header
+#include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 // special library headers
 
 // other headers
+#include "control/database.hpp"
 #include "sample.hpp"
 
 // forward declaration...
 
 /**
-Efficient management class for scattering factors.
+Efficient management class for scattering factors. Atoms of the same kind and
+kappa form a species, whose factor is evaluated once per q vector length.
 */
 class ScatterFactors {
   Sample* p_sample;
@@ -36,6 +40,31 @@ class ScatterFactors {
   std::vector<double> factors;
   std::vector<double> m_kappas;
 
+  // all species, first = atom kind, second = kappa. The species of the
+  // selection come first.
+  std::map<std::pair<size_t, double>, size_t> m_species_index;
+  std::vector<std::pair<size_t, double> > m_species_kinds;
+  // species of the atoms of the selection
+  std::vector<size_t> m_species;
+  // factors of the species of the selection
+  std::vector<double> m_species_factors;
+  // factors of the species of the selection per additional contrast, see
+  // scattering.contrasts
+  std::vector<std::vector<double> > m_contrast_factors;
+  // species and their number of atoms per selection, see compute_background
+  std::map<IAtomselection*, std::vector<std::pair<size_t, size_t> > >
+      m_selection_species;
+
+  size_t register_species(size_t atomindex);
+  void init_species();
+  std::vector<std::pair<size_t, size_t> >& selection_species(
+      IAtomselection* selection);
+  // effective scattering length of species s for the given weight tables
+  double species_factor(size_t s, double ql, double background_sl,
+                        DatabaseVolumesParameters& volumes,
+                        DatabaseExlusionParameters& exclusionfactors,
+                        DatabaseSFactorsParameters& sfactors);
+
  public:
   ScatterFactors();
 
@@ -48,6 +77,14 @@ class ScatterFactors {
   double get(size_t atomselectionindex);
   std::vector<double>& get_all();
 
+  // species of the atoms of the selection, numbered from 0
+  std::vector<size_t>& get_species();
+  size_t get_species_count();
+  // factors of the species, which are updated along with get_all
+  std::vector<double>& get_species_factors();
+  // factors of the species for the additional contrast c
+  std::vector<double>& get_contrast_factors(size_t c);
+
   void update(CartesianCoor3D q);
   void update_kappas();
   double compute_background(CartesianCoor3D q, IAtomselection* selection=0);
@@ -42,17 +42,19 @@ Implements self type scattering using vectors for orientational averaging
 */
 class SelfVectorsScatterDevice : public AbstractVectorsScatterDevice {
  protected:
-  fftw_complex* at_;
-  // first = q, second = frames
-  concurrent_queue<std::pair<size_t, size_t> > atscatter_;
   coor_t* p_coordinates;
   size_t current_atomindex_;
 
+  // phase factors and steps for the recurrence, per vector and atom the real
+  // and imaginary parts of all frames
+  std::vector<double> phases_;
+  std::vector<double> steps_;
+
   //////////////////////////////
   // methods
   //////////////////////////////
 
-  fftw_complex* scatter(size_t qindex, size_t aindex);
+  void scatter(size_t qindex, size_t aindex, fftw_complex* p_at_local);
 
   ModAssignment assignment_;
 
@@ -60,18 +62,47 @@ class SelfVectorsScatterDevice : public AbstractVectorsScatterDevice {
 
   void stage_data();
 
-  void worker();
+  // number of vectors whose signals are post-processed together
+  size_t batch_;
+  void reserve_scratch();
+
+  void task_scatter_dspstore(size_t qindex, size_t count, size_t aindex,
+                             fftw_plan planF, fftw_plan planR);
   void compute();
 
-  void scatterblock(size_t atomindex, size_t index, size_t count);
-  void store(fftw_complex* at);
-  void dsp(fftw_complex* at);
+  void store(fftw_complex* at, size_t count);
+
+  // partial sums of a worker thread, which accumulate without locking and are
+  // combined once per vector
+  struct Accumulator {
+    fftw_complex* at;
+    std::complex<double> a;
+    std::complex<double> a2;
+  };
+  std::map<boost::thread::id, Accumulator> accumulators_;
+  void clear_accumulators();
+  void combine_accumulators();
+  // planF and planR are owned by smath::FFTPlanner and transform exactly
+  // count signals
+  void dsp(fftw_complex* at, size_t count, fftw_plan planF, fftw_plan planR);
+
+  // batched plans, first = number of signals of a batch. They are created
+  // before the wisdom is saved and only looked up afterwards.
+  std::map<size_t, fftw_plan> fftw_planF_;
+  std::map<size_t, fftw_plan> fftw_planR_;
+  static fftw_plan plan(const std::map<size_t, fftw_plan>& plans,
+                        size_t count);
 
   bool ram_check();
 
   ~SelfVectorsScatterDevice();
-  fftw_plan fftw_planF_;
-  fftw_plan fftw_planB_;
+  // with scattering.dsp.accumulate=frequency atfinal_ sums the power spectra,
+  // which are transformed once per vector by fftw_planRsum_. weights_ maps a
+  // power spectrum onto the mean of its auto-correlation.
+  fftw_plan fftw_planRsum_;
+  std::vector<std::complex<double> > weights_;
+  void init_weights();
+  void transform_spectrum();
 
  public:
   SelfVectorsScatterDevice(
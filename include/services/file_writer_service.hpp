@@ -42,6 +42,8 @@ Type class which is used to buffer the result data before it is written to file
 */
 struct HDF5DataEntry {
   CartesianCoor3D qvector;
+  // 0 for the main results, c+1 for scattering.contrasts[c]
+  size_t contrast;
   std::vector<std::complex<double> >* p_fqt;
   std::complex<double> fq0;
   std::complex<double> fq;
@@ -65,14 +67,26 @@ class HDF5WriterClient {
   void write(CartesianCoor3D qvector,
              const std::vector<std::complex<double> >& data,
              const std::complex<double> data2,
-             const std::complex<double> data3);
+             const std::complex<double> data3, size_t contrast = 0);
   void write(CartesianCoor3D qvector, const fftw_complex* data, size_t NF,
              const std::complex<double> data2,
-             const std::complex<double> data3);
+             const std::complex<double> data3, size_t contrast = 0);
 
   void flush();
 };
 
+/**
+Result data of the main calculation or of a contrast, which is buffered by the
+server
+*/
+struct HDF5DataBuffer {
+  std::vector<CartesianCoor3D> qvectors;
+  std::vector<std::vector<std::complex<double> >*> fqt;
+  std::vector<std::complex<double> > fq0;
+  std::vector<std::complex<double> > fq;
+  std::vector<std::complex<double> > fq2;
+};
+
 /**
 Server side code which implements buffered writing of the results and does
 automatic flushing of the data into the signal file
@@ -95,18 +109,23 @@ class HDF5WriterService {
   //    qvectors,size_t nf);
   void init_new(size_t nf);
   void init(size_t nf);
+  // adds the groups of contrasts which an existing file does not have yet
+  void init_contrasts(size_t nf);
+  // creates the empty result datasets at loc, i.e. the file or the group of a
+  // contrast
+  void create_datasets(hid_t loc, size_t nf);
 
   bool test_fqt_dim(size_t nf);
 
   void listener();
 
   void flush();
+  // appends the buffered data to the datasets at loc and clears the buffer
+  void flush(hid_t loc, HDF5DataBuffer& buffer);
 
-  std::vector<CartesianCoor3D> data_qvectors;
-  std::vector<std::vector<std::complex<double> >*> data_fqt;
-  std::vector<std::complex<double> > data_fq0;
-  std::vector<std::complex<double> > data_fq;
-  std::vector<std::complex<double> > data_fq2;
+  // first = main results, which are written to the root of the file, then
+  // one buffer per scattering.contrasts, which is written to its group
+  std::vector<HDF5DataBuffer> m_buffers;
 
  public:
   HDF5WriterService(boost::asio::io_service& io_service,
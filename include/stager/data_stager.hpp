@@ -36,6 +36,38 @@ distributes the trajectory to any other partition.
 #include "services.hpp"
 #include "stager/coordinate_writer.hpp"
 
+/**
+Manages the memory of the staged coordinates. Nodes of different partitions
+with the same rank in their partition stage identical data. With
+limits.stage.memory.shared such nodes on the same host map a single copy in an
+MPI shared memory window. The copy is owned by the node of the lowest rank,
+which belongs to the first partition if present, and only the owner writes to
+it. Otherwise every node allocates its own copy.
+*/
+class StagedMemory {
+  struct Window {
+    MPI_Win window;
+    boost::mpi::communicator sharecomm;
+    bool owner;
+  };
+  static std::map<coor_t*, Window>& windows();
+
+ public:
+  // nodes which share the staged data with this node, this node only unless
+  // limits.stage.memory.shared is set
+  static boost::mpi::communicator share_communicator(
+      boost::mpi::communicator& allcomm,
+      boost::mpi::communicator& partitioncomm);
+  static coor_t* allocate(boost::mpi::communicator& sharecomm,
+                          size_t bytesize);
+  // whether this node writes to the memory p
+  static bool owner(coor_t* p);
+  // makes the writes of the owner visible to all nodes which share p
+  static void synchronize(coor_t* p);
+  // collective among the nodes which share p
+  static void free(coor_t* p);
+};
+
 /**
 Loads coordinate data, performs frame decomposition of the trajectory data and
 places it efficiently into the distributed memory of the parallel partition by
@@ -56,14 +88,17 @@ class DataStagerByFrame {
   size_t NA;
   size_t NF;
 
+  boost::mpi::communicator sharecomm_;
   coor_t* p_coordinates;
   //    void stage_registration();
   //    void stage_data();
+  void stage_frames();
   void stage_firstpartition();
   void distribute_coordinates(coor_t* p_coordinates_buffer,
                               std::vector<std::vector<size_t> >& framesbuffer,
                               size_t s);
   void stage_fillpartitions();
+  void arrange_planes(const std::vector<size_t>& order);
 
   void write(std::string filename, std::string format);
 
@@ -71,6 +106,9 @@ class DataStagerByFrame {
   DataStagerByFrame(Sample& sample, boost::mpi::communicator& allcomm,
                     boost::mpi::communicator& partitioncomm, Timer& timer);
   coor_t* stage();
+  // stages the frames and splits each into x, y and z planes, atom j of a
+  // plane being atom order[j] of the frame
+  coor_t* stage_planes(const std::vector<size_t>& order);
 };
 
 /**
@@ -95,8 +133,11 @@ class DataStagerByAtom {
   void fill_coordinates(coor_t* p_localdata, size_t len,
                         std::vector<size_t> frames);
 
+  boost::mpi::communicator sharecomm_;
   coor_t* p_coordinates;
 
+  void load_cycle(size_t c, size_t framebuffer_max, size_t NEC,
+                  coor_t* p_buffer, MPI_Request* p_request);
   void stage_firstpartition();
   void stage_fillpartitions();
 
@@ -70,6 +70,15 @@ void Database::read_xml(std::string filename) {
     }
   }
 
+  read_factors_xml(xmli, volumes, exclusionfactors, sfactors);
+
+  // END OF database section //
+};
+
+void Database::read_factors_xml(XMLInterface& xmli,
+                                DatabaseVolumesParameters& v,
+                                DatabaseExlusionParameters& e,
+                                DatabaseSFactorsParameters& sf) {
   if (xmli.exists("//sizes")) {
     vector<XMLElement> elements = xmli.get("//sizes/element");
     for (size_t i = 0; i < elements.size(); ++i) {
@@ -85,7 +94,7 @@ void Database::read_xml(std::string filename) {
       }
 
       size_t ID = atomIDs.get(label);
-      volumes.reg(ID, values, sizes_function_type);
+      v.reg(ID, values, sizes_function_type);
     }
   }
 
@@ -104,7 +113,7 @@ void Database::read_xml(std::string filename) {
       }
 
       size_t ID = atomIDs.get(label);
-      exclusionfactors.reg(ID, values, sizes_function_type);
+      e.reg(ID, values, sizes_function_type);
     }
   }
 
@@ -123,15 +132,23 @@ void Database::read_xml(std::string filename) {
       }
 
       size_t ID = atomIDs.get(label);
-      sfactors.reg(ID, values, factors_function_type);
+      sf.reg(ID, values, factors_function_type);
     }
   } else {
     Err::Inst()->write("Need scattering factors.");
     throw;
   }
+}
 
-  // END OF database section //
-};
+void Database::read_contrast_xml(std::string filename,
+                                 DatabaseContrastParameters& contrast) {
+  XMLInterface xmli(filename);
+  Info::Inst()->write("Reading contrast database from file: " + filename);
+
+  // names and masses are the ones of the main database
+  read_factors_xml(xmli, contrast.volumes, contrast.exclusionfactors,
+                   contrast.sfactors);
+}
 
 string Database::guessformat(string filename) {
   // do the best you can to guess the format
@@ -193,7 +210,20 @@ bool Database::check() {
       Err::Inst()->write(string("Add the missing definition to proceed"));
       return false;
     }
-    if (volumes.m_functiontypes.find(id) == volumes.m_functiontypes.end()) {
+  }
+
+  return check_factors(volumes, exclusionfactors, sfactors);
+}
+
+bool Database::check_factors(DatabaseVolumesParameters& v,
+                             DatabaseExlusionParameters& e,
+                             DatabaseSFactorsParameters& sf) {
+  for (map<string, string>::iterator pdblabels =
+           names.pdb.m_label2regexp.begin();
+       pdblabels != names.pdb.m_label2regexp.end(); pdblabels++) {
+    string label = pdblabels->first;
+    size_t id = atomIDs.get(label);
+    if (v.m_functiontypes.find(id) == v.m_functiontypes.end()) {
       Err::Inst()->write("Database definition incomplete");
       Err::Inst()->write(
           string("Atom with label '") + label +
@@ -201,14 +231,14 @@ bool Database::check() {
       Err::Inst()->write(string("Add the missing definition to proceed"));
       return false;
     }
-    if (volumes.m_constants.find(id) == volumes.m_constants.end()) {
+    if (v.m_constants.find(id) == v.m_constants.end()) {
       Err::Inst()->write("Database definition incomplete");
       Err::Inst()->write(string("Atom with label '") + label +
                          string("' is missing constants for the volume entry"));
       Err::Inst()->write(string("Add the missing entries to proceed"));
       return false;
     }
-    if (sfactors.m_functiontypes.find(id) == sfactors.m_functiontypes.end()) {
+    if (sf.m_functiontypes.find(id) == sf.m_functiontypes.end()) {
       Err::Inst()->write("Database definition incomplete");
       Err::Inst()->write(
           string("Atom with label '") + label +
@@ -217,7 +247,7 @@ bool Database::check() {
       Err::Inst()->write(string("Add the missing definition to proceed"));
       return false;
     }
-    if (sfactors.m_constants.find(id) == sfactors.m_constants.end()) {
+    if (sf.m_constants.find(id) == sf.m_constants.end()) {
       Err::Inst()->write("Database definition incomplete");
       Err::Inst()->write(
           string("Atom with label '") + label +
@@ -225,8 +255,7 @@ bool Database::check() {
       Err::Inst()->write(string("Add the missing entries to proceed"));
       return false;
     }
-    if (exclusionfactors.m_functiontypes.find(id) ==
-        exclusionfactors.m_functiontypes.end()) {
+    if (e.m_functiontypes.find(id) == e.m_functiontypes.end()) {
       Err::Inst()->write("Database definition incomplete");
       Err::Inst()->write(
           string("Atom with label '") + label +
@@ -235,8 +264,7 @@ bool Database::check() {
       Err::Inst()->write(string("Add the missing definition to proceed"));
       return false;
     }
-    if (exclusionfactors.m_constants.find(id) ==
-        exclusionfactors.m_constants.end()) {
+    if (e.m_constants.find(id) == e.m_constants.end()) {
       Err::Inst()->write("Database definition incomplete");
       Err::Inst()->write(
           string("Atom with label '") + label +
@@ -285,6 +313,32 @@ void Database::init() {
     Err::Inst()->write("Check failed. Please check your input file.");
     throw;
   }
+
+  // contrasts without a database of their own use the main tables
+  std::vector<ScatteringContrastParameters>& pcontrasts =
+      Params::Inst()->scattering.contrasts;
+  contrasts.resize(pcontrasts.size());
+  for (size_t i = 0; i < pcontrasts.size(); ++i) {
+    DatabaseContrastParameters& contrast = contrasts[i];
+    if (pcontrasts[i].database.empty()) {
+      contrast.volumes = volumes;
+      contrast.exclusionfactors = exclusionfactors;
+      contrast.sfactors = sfactors;
+      continue;
+    }
+    if (!boost::filesystem::exists(pcontrasts[i].databasepath)) {
+      Err::Inst()->write(pcontrasts[i].databasepath +
+                         string(" does not exist!"));
+      throw;
+    }
+    read_contrast_xml(pcontrasts[i].databasepath, contrast);
+    if (!check_factors(contrast.volumes, contrast.exclusionfactors,
+                       contrast.sfactors)) {
+      Err::Inst()->write(string("Check failed for contrast: ") +
+                         pcontrasts[i].name);
+      throw;
+    }
+  }
 }
 
 void Database::write(std::string filename, std::string format) {
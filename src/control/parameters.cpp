@@ -468,6 +468,8 @@ void Params::read_xml(std::string filename) {
 
   scattering.dsp.type = "autocorrelate";
   scattering.dsp.method = "fftw";
+  scattering.dsp.accumulate = "time";
+  scattering.dsp.max_lag = 0;
   // defaults
   scattering.average.orientation.type = "none";
   scattering.average.orientation.axis = CartesianCoor3D(0, 0, 1);
@@ -484,6 +486,9 @@ void Params::read_xml(std::string filename) {
   scattering.average.orientation.multipole.moments.filepath =
       get_filepath(scattering.average.orientation.multipole.moments.file);
   scattering.average.orientation.exact.type = "sphere";
+  scattering.average.orientation.exact.method = "pairs";
+  scattering.average.orientation.exact.binwidth = 0.02;
+  scattering.average.orientation.exact.cutoff = 0;
 
   scattering.signal.file = "signal.h5";
   scattering.signal.filepath = get_filepath(scattering.signal.file);
@@ -631,6 +636,52 @@ void Params::read_xml(std::string filename) {
         Info::Inst()->write(string("scattering.dsp.method=") +
                             scattering.dsp.method);
       }
+      if (xmli.exists("//scattering/dsp/accumulate")) {
+        scattering.dsp.accumulate =
+            xmli.get_value<string>("//scattering/dsp/accumulate");
+        if ((scattering.dsp.accumulate != "time") &&
+            (scattering.dsp.accumulate != "frequency")) {
+          Err::Inst()->write(
+              string("scattering.dsp.accumulate not understood: ") +
+              scattering.dsp.accumulate);
+          Err::Inst()->write("scattering.dsp.accumulate == time, frequency");
+          throw;
+        }
+        // power spectra only exist for correlations computed by FFT
+        if ((scattering.dsp.accumulate == "frequency") &&
+            ((scattering.dsp.type != "autocorrelate") ||
+             (scattering.dsp.method != "fftw"))) {
+          Err::Inst()->write(
+              "scattering.dsp.accumulate=frequency requires "
+              "scattering.dsp.type=autocorrelate and "
+              "scattering.dsp.method=fftw");
+          throw;
+        }
+        // only the self scattering device sums up power spectra
+        if ((scattering.dsp.accumulate == "frequency") &&
+            (scattering.type != "self")) {
+          Err::Inst()->write(
+              "scattering.dsp.accumulate=frequency requires "
+              "scattering.type=self");
+          throw;
+        }
+        Info::Inst()->write(string("scattering.dsp.accumulate=") +
+                            scattering.dsp.accumulate);
+      }
+      if (xmli.exists("//scattering/dsp/max_lag")) {
+        scattering.dsp.max_lag =
+            xmli.get_value<size_t>("//scattering/dsp/max_lag");
+        // the FFT computes all lags at once
+        if ((scattering.dsp.max_lag > 0) &&
+            (scattering.dsp.method != "direct")) {
+          Err::Inst()->write(
+              "scattering.dsp.max_lag requires scattering.dsp.method=direct");
+          throw;
+        }
+        Info::Inst()->write(
+            string("scattering.dsp.max_lag=") +
+            boost::lexical_cast<string>(scattering.dsp.max_lag));
+      }
     }
 
     if (xmli.exists("//scattering/average")) {
@@ -801,6 +852,78 @@ void Params::read_xml(std::string filename) {
           }
 
           scattering.average.orientation.multipole.moments.create();
+        } else if (scattering.average.orientation.type == "exact") {
+          if (xmli.exists("//scattering/average/orientation/exact/type")) {
+            scattering.average.orientation.exact.type = xmli.get_value<string>(
+                "//scattering/average/orientation/exact/type");
+            Info::Inst()->write(
+                string("scattering.average.orientation.exact.type=") +
+                scattering.average.orientation.exact.type);
+          }
+          if (scattering.average.orientation.exact.type != "sphere") {
+            Err::Inst()->write(
+                string("scattering.average.orientation.exact.type not "
+                       "understood: ") +
+                scattering.average.orientation.exact.type);
+            Err::Inst()->write(
+                "scattering.average.orientation.exact.type == sphere");
+            throw;
+          }
+          if (xmli.exists("//scattering/average/orientation/exact/method")) {
+            scattering.average.orientation.exact.method =
+                xmli.get_value<string>(
+                    "//scattering/average/orientation/exact/method");
+            if ((scattering.average.orientation.exact.method != "pairs") &&
+                (scattering.average.orientation.exact.method != "histogram")) {
+              Err::Inst()->write(
+                  string("scattering.average.orientation.exact.method not "
+                         "understood: ") +
+                  scattering.average.orientation.exact.method);
+              Err::Inst()->write(
+                  "scattering.average.orientation.exact.method == pairs, "
+                  "histogram");
+              throw;
+            }
+            Info::Inst()->write(
+                string("scattering.average.orientation.exact.method=") +
+                scattering.average.orientation.exact.method);
+          }
+          if (xmli.exists(
+                  "//scattering/average/orientation/exact/binwidth")) {
+            scattering.average.orientation.exact.binwidth =
+                xmli.get_value<double>(
+                    "//scattering/average/orientation/exact/binwidth");
+            if (scattering.average.orientation.exact.binwidth <= 0) {
+              Err::Inst()->write(
+                  "scattering.average.orientation.exact.binwidth must be > 0");
+              throw;
+            }
+          }
+          if (xmli.exists("//scattering/average/orientation/exact/cutoff")) {
+            scattering.average.orientation.exact.cutoff =
+                xmli.get_value<double>(
+                    "//scattering/average/orientation/exact/cutoff");
+            if (scattering.average.orientation.exact.cutoff < 0) {
+              Err::Inst()->write(
+                  "scattering.average.orientation.exact.cutoff must be >= 0");
+              throw;
+            }
+            if ((scattering.average.orientation.exact.cutoff > 0) &&
+                (scattering.average.orientation.exact.method != "histogram")) {
+              Err::Inst()->write(
+                  "scattering.average.orientation.exact.cutoff requires "
+                  "scattering.average.orientation.exact.method == histogram");
+              throw;
+            }
+          }
+          // the pair sum yields orientationally averaged intensities per
+          // frame, correlations between frames are not available
+          if (scattering.dsp.type == "autocorrelate") {
+            Err::Inst()->write(
+                "scattering.average.orientation.type=exact requires "
+                "scattering.dsp.type == square, plain");
+            throw;
+          }
         } else if (scattering.average.orientation.type != "none") {
           Err::Inst()->write(
               string("Orientation averaging type not understood: ") +
@@ -841,6 +964,75 @@ void Params::read_xml(std::string filename) {
                         boost::lexical_cast<string>(scattering.signal.fq));
     Info::Inst()->write(string("scattering.signal.fq2=") +
                         boost::lexical_cast<string>(scattering.signal.fq2));
+
+    if (xmli.exists("//scattering/contrasts")) {
+      vector<XMLElement> contrasts =
+          xmli.get("//scattering/contrasts/contrast");
+      for (size_t i = 0; i < contrasts.size(); ++i) {
+        xmli.set_current(contrasts[i]);
+        ScatteringContrastParameters contrast;
+        contrast.name = "";
+        contrast.database = "";
+        contrast.databasepath = "";
+        contrast.factor = scattering.background.factor.value;
+        if (xmli.exists("./name"))
+          contrast.name = xmli.get_value<string>("./name");
+        // the database file, a nested database section would collide with
+        // the one of the main database
+        if (xmli.exists("./file")) {
+          contrast.database = xmli.get_value<string>("./file");
+          contrast.databasepath = get_filepath(contrast.database);
+        }
+        if (xmli.exists("./background/factor/value")) {
+          contrast.factor =
+              xmli.get_value<double>("./background/factor/value");
+        } else if (!scattering.background.factor.selection.empty()) {
+          Err::Inst()->write(
+              "scattering.contrasts.contrast.background.factor.value is "
+              "required if scattering.background.factor uses a selection");
+          throw;
+        }
+
+        // the name becomes a group of the signal file
+        if (contrast.name.empty() ||
+            (contrast.name.find('/') != string::npos) ||
+            (contrast.name == "meta") || (contrast.name == "qvectors") ||
+            (contrast.name == "fqt") || (contrast.name == "fq0") ||
+            (contrast.name == "fq") || (contrast.name == "fq2")) {
+          Err::Inst()->write(
+              string("scattering.contrasts.contrast.name not valid: ") +
+              contrast.name);
+          throw;
+        }
+        for (size_t j = 0; j < scattering.contrasts.size(); ++j) {
+          if (scattering.contrasts[j].name == contrast.name) {
+            Err::Inst()->write(
+                string("scattering.contrasts.contrast.name not unique: ") +
+                contrast.name);
+            throw;
+          }
+        }
+
+        scattering.contrasts.push_back(contrast);
+        Info::Inst()->write(
+            string("Contrast: name=") + contrast.name +
+            string(", database=") +
+            (contrast.database.empty() ? string("main") : contrast.database) +
+            string(", background.factor.value=") +
+            boost::lexical_cast<string>(contrast.factor));
+      }
+
+      // the phases are shared by computing all contrasts in the same pass
+      if (!scattering.contrasts.empty() &&
+          ((scattering.type != "all") ||
+           ((scattering.average.orientation.type != "vectors") &&
+            (scattering.average.orientation.type != "none")))) {
+        Err::Inst()->write(
+            "scattering.contrasts requires scattering.type=all and "
+            "scattering.average.orientation.type=vectors or none");
+        throw;
+      }
+    }
   }
   // END OF scattering section //
 
@@ -849,16 +1041,29 @@ void Params::read_xml(std::string filename) {
   // assign default memory limits:
   limits.stage.memory.buffer = 100 * 1024 * 1024;
   limits.stage.memory.data = 500 * 1024 * 1024;
+  limits.stage.memory.shared = false;
+  limits.stage.chunksize = 4 * 1024 * 1024;
 
   limits.signal.chunksize = 10000;
 
   limits.computation.cores = 1;
   limits.computation.processes = 1;
   limits.computation.threads = 1;
+  limits.computation.simd = "auto";
+  limits.computation.precision = "double";
+  limits.computation.vectorblock = 4;
+  limits.computation.phases.method = "exact";
+  limits.computation.phases.reseed = 32;
+  limits.computation.phases.factoring = "atoms";
+  limits.computation.fft.planner = "estimate";
+  limits.computation.fft.wisdom = "";
+  limits.computation.fft.threads = 1;
+  limits.computation.fft.batch = 8;
   limits.computation.memory.result_buffer = 100 * 1024 * 1024;    // 100MB
   limits.computation.memory.signal_buffer = 100 * 1024 * 1024;    // 100MB
   limits.computation.memory.exchange_buffer = 100 * 1024 * 1024;  // 100MB
   limits.computation.memory.alignpad_buffer = 200 * 1024 * 1024;  // 200MB
+  limits.computation.memory.phase_buffer = 500 * 1024 * 1024;     // 500MB
   limits.computation.memory.scale = 1;
 
   limits.services.signal.memory.server = 100 * 1024 * 1024;  // 100MB
@@ -887,6 +1092,24 @@ void Params::read_xml(std::string filename) {
           limits.stage.memory.data =
               xmli.get_value<size_t>("//limits/stage/memory/data");
         }
+        if (xmli.exists("//limits/stage/memory/shared")) {
+          limits.stage.memory.shared =
+              xmli.get_value<bool>("//limits/stage/memory/shared");
+          Info::Inst()->write(
+              string("limits.stage.memory.shared=") +
+              boost::lexical_cast<string>(limits.stage.memory.shared));
+        }
+      }
+      if (xmli.exists("//limits/stage/chunksize")) {
+        limits.stage.chunksize =
+            xmli.get_value<size_t>("//limits/stage/chunksize");
+        if (limits.stage.chunksize < sizeof(coor_t)) {
+          Err::Inst()->write("limits.stage.chunksize must hold a coordinate");
+          throw;
+        }
+        Info::Inst()->write(
+            string("limits.stage.chunksize=") +
+            boost::lexical_cast<string>(limits.stage.chunksize));
       }
     }
 
@@ -921,6 +1144,108 @@ void Params::read_xml(std::string filename) {
         limits.computation.threads =
             xmli.get_value<size_t>("//limits/computation/threads");
       }
+      if (xmli.exists("//limits/computation/simd")) {
+        limits.computation.simd =
+            xmli.get_value<string>("//limits/computation/simd");
+        Info::Inst()->write(string("limits.computation.simd=") +
+                            limits.computation.simd);
+      }
+      if (xmli.exists("//limits/computation/precision")) {
+        limits.computation.precision =
+            xmli.get_value<string>("//limits/computation/precision");
+        if ((limits.computation.precision != "double") &&
+            (limits.computation.precision != "mixed")) {
+          Err::Inst()->write(
+              string("limits.computation.precision not understood: ") +
+              limits.computation.precision);
+          Err::Inst()->write("limits.computation.precision == double, mixed");
+          throw;
+        }
+        Info::Inst()->write(string("limits.computation.precision=") +
+                            limits.computation.precision);
+      }
+      if (xmli.exists("//limits/computation/vectorblock")) {
+        limits.computation.vectorblock =
+            xmli.get_value<size_t>("//limits/computation/vectorblock");
+        if (limits.computation.vectorblock < 1) {
+          Err::Inst()->write("limits.computation.vectorblock must be >= 1");
+          throw;
+        }
+      }
+      if (xmli.exists("//limits/computation/phases")) {
+        if (xmli.exists("//limits/computation/phases/method")) {
+          limits.computation.phases.method =
+              xmli.get_value<string>("//limits/computation/phases/method");
+          if ((limits.computation.phases.method != "exact") &&
+              (limits.computation.phases.method != "recurrence")) {
+            Err::Inst()->write(
+                string("limits.computation.phases.method not understood: ") +
+                limits.computation.phases.method);
+            Err::Inst()->write(
+                "limits.computation.phases.method == exact, recurrence");
+            throw;
+          }
+          Info::Inst()->write(string("limits.computation.phases.method=") +
+                              limits.computation.phases.method);
+        }
+        if (xmli.exists("//limits/computation/phases/reseed")) {
+          limits.computation.phases.reseed =
+              xmli.get_value<size_t>("//limits/computation/phases/reseed");
+        }
+        if (xmli.exists("//limits/computation/phases/factoring")) {
+          limits.computation.phases.factoring =
+              xmli.get_value<string>("//limits/computation/phases/factoring");
+          if ((limits.computation.phases.factoring != "atoms") &&
+              (limits.computation.phases.factoring != "species")) {
+            Err::Inst()->write(
+                string("limits.computation.phases.factoring not understood: ") +
+                limits.computation.phases.factoring);
+            Err::Inst()->write(
+                "limits.computation.phases.factoring == atoms, species");
+            throw;
+          }
+          Info::Inst()->write(string("limits.computation.phases.factoring=") +
+                              limits.computation.phases.factoring);
+        }
+      }
+      if (xmli.exists("//limits/computation/fft")) {
+        if (xmli.exists("//limits/computation/fft/planner")) {
+          limits.computation.fft.planner =
+              xmli.get_value<string>("//limits/computation/fft/planner");
+          if ((limits.computation.fft.planner != "estimate") &&
+              (limits.computation.fft.planner != "measure") &&
+              (limits.computation.fft.planner != "patient")) {
+            Err::Inst()->write(
+                string("limits.computation.fft.planner not understood: ") +
+                limits.computation.fft.planner);
+            Err::Inst()->write(
+                "limits.computation.fft.planner == estimate, measure, patient");
+            throw;
+          }
+          Info::Inst()->write(string("limits.computation.fft.planner=") +
+                              limits.computation.fft.planner);
+        }
+        if (xmli.exists("//limits/computation/fft/wisdom")) {
+          limits.computation.fft.wisdom = get_filepath(
+              xmli.get_value<string>("//limits/computation/fft/wisdom"));
+        }
+        if (xmli.exists("//limits/computation/fft/threads")) {
+          limits.computation.fft.threads =
+              xmli.get_value<size_t>("//limits/computation/fft/threads");
+          if (limits.computation.fft.threads < 1) {
+            Err::Inst()->write("limits.computation.fft.threads must be >= 1");
+            throw;
+          }
+        }
+        if (xmli.exists("//limits/computation/fft/batch")) {
+          limits.computation.fft.batch =
+              xmli.get_value<size_t>("//limits/computation/fft/batch");
+          if (limits.computation.fft.batch < 1) {
+            Err::Inst()->write("limits.computation.fft.batch must be >= 1");
+            throw;
+          }
+        }
+      }
       if (xmli.exists("//limits/computation/memory")) {
         if (xmli.exists("//limits/computation/memory/result_buffer")) {
           limits.computation.memory.result_buffer = xmli.get_value<size_t>(
@@ -938,6 +1263,10 @@ void Params::read_xml(std::string filename) {
           limits.computation.memory.alignpad_buffer = xmli.get_value<size_t>(
               "//limits/computation/memory/alignpad_buffer");
         }
+        if (xmli.exists("//limits/computation/memory/phase_buffer")) {
+          limits.computation.memory.phase_buffer = xmli.get_value<size_t>(
+              "//limits/computation/memory/phase_buffer");
+        }
         if (xmli.exists("//limits/computation/memory/scale")) {
           limits.computation.memory.scale =
               xmli.get_value<size_t>("//limits/computation/memory/scale");
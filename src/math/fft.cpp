@@ -0,0 +1,102 @@
+/** \file
+This file contains the plan management for the Fourier transforms used by the
+correlation of signals.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "math/fft.hpp"
+
+// standard header
+#include <cstdlib>
+
+using namespace std;
+
+namespace smath {
+
+FFTPlanner::FFTPlanner() : flags_(FFTW_ESTIMATE), threads_(1) {}
+
+FFTPlanner::~FFTPlanner() {
+  for (map<plankey_t, fftw_plan>::iterator pi = plans_.begin();
+       pi != plans_.end(); pi++) {
+    fftw_destroy_plan(pi->second);
+  }
+  plans_.clear();
+}
+
+size_t FFTPlanner::configure(const std::string& rigor, size_t threads) {
+  if (rigor == "patient") {
+    flags_ = FFTW_PATIENT;
+  } else if (rigor == "measure") {
+    flags_ = FFTW_MEASURE;
+  } else {
+    flags_ = FFTW_ESTIMATE;
+  }
+
+#ifdef HAVE_FFTW_THREADS
+  static bool initialized = false;
+  if (!initialized) {
+    fftw_init_threads();
+    initialized = true;
+  }
+  threads_ = (threads < 1) ? 1 : threads;
+  fftw_plan_with_nthreads(threads_);
+#else
+  threads_ = 1;
+#endif
+  return threads_;
+}
+
+bool FFTPlanner::import_wisdom(const std::string& wisdom) {
+  if (wisdom.empty()) return false;
+  return fftw_import_wisdom_from_string(wisdom.c_str()) != 0;
+}
+
+std::string FFTPlanner::export_wisdom() {
+  char* wisdom = fftw_export_wisdom_to_string();
+  if (wisdom == NULL) return string();
+  string ret(wisdom);
+  free(wisdom);
+  return ret;
+}
+
+fftw_plan FFTPlanner::complex_plan(size_t n, int sign, size_t howmany) {
+  plankey_t key(make_pair(n, howmany), sign);
+  map<plankey_t, fftw_plan>::iterator pi = plans_.find(key);
+  if (pi != plans_.end()) return pi->second;
+
+  // measuring planners overwrite the buffer, hence plan on scratch space
+  fftw_complex* wspace =
+      (fftw_complex*)fftw_malloc(howmany * n * sizeof(fftw_complex));
+  int N = n;
+  fftw_plan plan = fftw_plan_many_dft(1, &N, howmany, wspace, NULL, 1, n,
+                                      wspace, NULL, 1, n, sign, flags_);
+  fftw_free(wspace);
+
+  plans_[key] = plan;
+  return plan;
+}
+
+fftw_plan FFTPlanner::real_plan(size_t n, size_t howmany) {
+  plankey_t key(make_pair(n, howmany), 0);
+  map<plankey_t, fftw_plan>::iterator pi = plans_.find(key);
+  if (pi != plans_.end()) return pi->second;
+
+  // the distance between signals is n complex elements, or 2*n reals
+  fftw_complex* wspace =
+      (fftw_complex*)fftw_malloc(howmany * n * sizeof(fftw_complex));
+  int N = n;
+  fftw_plan plan =
+      fftw_plan_many_dft_r2c(1, &N, howmany, (double*)wspace, NULL, 1, 2 * n,
+                             wspace, NULL, 1, n, flags_);
+  fftw_free(wspace);
+
+  plans_[key] = plan;
+  return plan;
+}
+}
+
+// end of file
@@ -0,0 +1,160 @@
+/** \file
+This file contains recurrences which evaluate the special functions of the
+multipole expansion for all orders at once.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "math/multipole.hpp"
+
+// standard header
+#include <cmath>
+
+// special library headers
+#include <boost/math/special_functions/bessel.hpp>
+
+// other headers
+
+using namespace std;
+
+namespace smath {
+
+void sph_bessel_all(long L, double x, double* j) {
+  if (x == 0) {
+    j[0] = 1;
+    for (long l = 1; l <= L; ++l) j[l] = 0;
+    return;
+  }
+
+  double s = sin(x);
+  double c = cos(x);
+  double j0 = s / x;
+  j[0] = j0;
+  if (L == 0) return;
+  double j1 = s / (x * x) - c / x;
+
+  if (x > L) {
+    j[1] = j1;
+    for (long l = 1; l < L; ++l) {
+      j[l + 1] = (2 * l + 1) / x * j[l] - j[l - 1];
+    }
+    return;
+  }
+
+  // start well above the highest order, the arbitrary start values decay
+  // relative to the minimal solution
+  long start = L + 16 + long(sqrt(40.0 * (L + 1)));
+  double jp1 = 0;
+  double jl = 1e-200;
+  for (long l = start; l > 0; --l) {
+    double jm1 = (2 * l + 1) / x * jl - jp1;
+    jp1 = jl;
+    jl = jm1;
+    if (l - 1 <= L) j[l - 1] = jl;
+    if (fabs(jl) > 1e200) {
+      jl *= 1e-200;
+      jp1 *= 1e-200;
+      for (long k = l - 1; k <= L; ++k) j[k] *= 1e-200;
+    }
+  }
+
+  // normalize by the larger of the closed forms, j0 vanishes at multiples of pi
+  double scale = (fabs(j0) > fabs(j1)) ? j0 / j[0] : j1 / j[1];
+  for (long l = 0; l <= L; ++l) j[l] *= scale;
+}
+
+void cyl_bessel_j_all(long N, double x, double* J) {
+  if (x == 0) {
+    J[0] = 1;
+    for (long n = 1; n <= N; ++n) J[n] = 0;
+    return;
+  }
+
+  if (x > N) {
+    J[0] = boost::math::cyl_bessel_j(0, x);
+    if (N == 0) return;
+    J[1] = boost::math::cyl_bessel_j(1, x);
+    for (long n = 1; n < N; ++n) {
+      J[n + 1] = 2 * n / x * J[n] - J[n - 1];
+    }
+    return;
+  }
+
+  // even start above the highest order, see sph_bessel_all
+  long start = 2 * ((N + 16 + long(sqrt(40.0 * (N + 1)))) / 2);
+  double jp1 = 0;
+  double jn = 1e-200;
+  double sum = 0;
+  for (long n = start; n > 0; --n) {
+    double jm1 = 2 * n / x * jn - jp1;
+    jp1 = jn;
+    jn = jm1;
+    if (n - 1 <= N) J[n - 1] = jn;
+    if ((n - 1 > 0) && ((n - 1) % 2 == 0)) sum += 2 * jn;
+    if (fabs(jn) > 1e200) {
+      jn *= 1e-200;
+      jp1 *= 1e-200;
+      sum *= 1e-200;
+      for (long k = n - 1; k <= N; ++k) J[k] *= 1e-200;
+    }
+  }
+  sum += jn;
+
+  double scale = 1.0 / sum;
+  for (long n = 0; n <= N; ++n) J[n] *= scale;
+}
+
+SphericalHarmonics::SphericalHarmonics(long L) : L_(L) {
+  a_.resize(size());
+  b_.resize(size());
+  for (long l = 2; l <= L_; ++l) {
+    for (long m = 0; m <= l - 2; ++m) {
+      double l2 = double(l) * l;
+      double m2 = double(m) * m;
+      a_[index(l, m)] = sqrt((4 * l2 - 1) / (l2 - m2));
+      double k2 = double(l - 1) * (l - 1);
+      b_[index(l, m)] = sqrt((k2 - m2) / (4 * k2 - 1));
+    }
+  }
+}
+
+void SphericalHarmonics::evaluate(double theta, double phi,
+                                  std::complex<double>* Y) const {
+  double x = cos(theta);
+  double s = fabs(sin(theta));
+
+  // normalized Legendre functions, first the diagonal and its neighbour, then
+  // upward in l for every m. They are kept in the real parts of Y until the
+  // azimuthal factors are applied.
+  double* P = (double*)Y;
+  P[0] = sqrt(1.0 / (4 * M_PI));
+  for (long m = 1; m <= L_; ++m) {
+    P[2 * index(m, m)] =
+        -sqrt((2 * m + 1) / (2.0 * m)) * s * P[2 * index(m - 1, m - 1)];
+  }
+  for (long m = 0; m < L_; ++m) {
+    P[2 * index(m + 1, m)] = sqrt(2.0 * m + 3) * x * P[2 * index(m, m)];
+  }
+  for (long l = 2; l <= L_; ++l) {
+    for (long m = 0; m <= l - 2; ++m) {
+      size_t i = index(l, m);
+      P[2 * i] = a_[i] * (x * P[2 * index(l - 1, m)] -
+                          b_[i] * P[2 * index(l - 2, m)]);
+    }
+  }
+
+  complex<double> step(cos(phi), sin(phi));
+  complex<double> e(1.0, 0.0);
+  for (long m = 0; m <= L_; ++m) {
+    for (long l = m; l <= L_; ++l) {
+      Y[index(l, m)] = P[2 * index(l, m)] * e;
+    }
+    e *= step;
+  }
+}
+}
+
+// end of file
@@ -0,0 +1,183 @@
+/** \file
+This file contains functions which build histograms of the pair distances of
+a frame, sorted by the species of the atoms of a pair.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "math/pair_histogram.hpp"
+
+// standard header
+#include <algorithm>
+#include <cmath>
+
+// special library headers
+
+// other headers
+
+using namespace std;
+
+namespace smath {
+
+namespace {
+
+// offsets of the pair histograms, first = species of i, second = species of j
+void pair_offsets(size_t NS, size_t NBINS, std::vector<size_t>& offsets) {
+  offsets.resize(NS * NS);
+  for (size_t s = 0; s < NS; ++s) {
+    for (size_t t = 0; t < NS; ++t) {
+      offsets[s * NS + t] = species_pair(s, t) * NBINS;
+    }
+  }
+}
+
+void histogram_all(const coor_t* x, const coor_t* y, const coor_t* z,
+                   const size_t* species, size_t NS, size_t N,
+                   double binwidth, size_t NBINS, double* H) {
+  std::vector<size_t> offsets;
+  pair_offsets(NS, NBINS, offsets);
+  double scale = 1.0 / binwidth;
+  size_t last = NBINS - 1;
+
+  for (size_t i = 0; i < N; ++i) {
+    const size_t* p_offsets = &(offsets[species[i] * NS]);
+    double xi = x[i];
+    double yi = y[i];
+    double zi = z[i];
+    for (size_t j = i + 1; j < N; ++j) {
+      double dx = x[j] - xi;
+      double dy = y[j] - yi;
+      double dz = z[j] - zi;
+      size_t k = size_t(sqrt(dx * dx + dy * dy + dz * dz) * scale);
+      H[p_offsets[species[j]] + std::min(k, last)] += 1;
+    }
+  }
+}
+
+void histogram_cells(const coor_t* x, const coor_t* y, const coor_t* z,
+                     const size_t* species, size_t NS, size_t N,
+                     double binwidth, size_t NBINS, double cutoff, double* H) {
+  std::vector<size_t> offsets;
+  pair_offsets(NS, NBINS, offsets);
+  double scale = 1.0 / binwidth;
+  size_t last = NBINS - 1;
+  double cutoff2 = cutoff * cutoff;
+
+  // the cells are at least as large as the cutoff, hence all partners of an
+  // atom are found in its own or one of the 26 neighbouring cells
+  double lo[3] = {x[0], y[0], z[0]};
+  double hi[3] = {x[0], y[0], z[0]};
+  for (size_t i = 1; i < N; ++i) {
+    lo[0] = std::min<double>(lo[0], x[i]);
+    lo[1] = std::min<double>(lo[1], y[i]);
+    lo[2] = std::min<double>(lo[2], z[i]);
+    hi[0] = std::max<double>(hi[0], x[i]);
+    hi[1] = std::max<double>(hi[1], y[i]);
+    hi[2] = std::max<double>(hi[2], z[i]);
+  }
+  long nc[3];
+  double ncells = 1;
+  for (size_t d = 0; d < 3; ++d) {
+    nc[d] = std::max<long>(1, long((hi[d] - lo[d]) / cutoff));
+    ncells *= nc[d];
+  }
+  // sparse systems with a small cutoff would have mostly empty cells, larger
+  // cells keep the number of cells below the number of atoms
+  if (ncells > N) {
+    double shrink = cbrt(N / ncells);
+    for (size_t d = 0; d < 3; ++d) {
+      nc[d] = std::max<long>(1, long(nc[d] * shrink));
+    }
+  }
+  double cellscale[3];
+  for (size_t d = 0; d < 3; ++d) {
+    double extent = hi[d] - lo[d];
+    cellscale[d] = (extent > 0) ? nc[d] / extent : 0;
+  }
+
+  // atoms sorted by cell, first = cell, second = atoms of the cell
+  size_t NC = nc[0] * nc[1] * nc[2];
+  std::vector<size_t> cell(N);
+  std::vector<size_t> start(NC + 1, 0);
+  for (size_t i = 0; i < N; ++i) {
+    long c[3];
+    c[0] = std::min<long>(long((x[i] - lo[0]) * cellscale[0]), nc[0] - 1);
+    c[1] = std::min<long>(long((y[i] - lo[1]) * cellscale[1]), nc[1] - 1);
+    c[2] = std::min<long>(long((z[i] - lo[2]) * cellscale[2]), nc[2] - 1);
+    cell[i] = (c[2] * nc[1] + c[1]) * nc[0] + c[0];
+    start[cell[i] + 1]++;
+  }
+  for (size_t c = 0; c < NC; ++c) start[c + 1] += start[c];
+  std::vector<size_t> atoms(N);
+  std::vector<size_t> fill(start.begin(), start.end() - 1);
+  for (size_t i = 0; i < N; ++i) atoms[fill[cell[i]]++] = i;
+
+  for (long cz = 0; cz < nc[2]; ++cz) {
+    for (long cy = 0; cy < nc[1]; ++cy) {
+      for (long cx = 0; cx < nc[0]; ++cx) {
+        size_t c = (cz * nc[1] + cy) * nc[0] + cx;
+        // the cell itself and the half of its neighbours which follows it,
+        // so every pair of cells is visited once
+        for (long oz = 0; oz <= 1; ++oz) {
+          for (long oy = -1; oy <= 1; ++oy) {
+            for (long ox = -1; ox <= 1; ++ox) {
+              if ((oz == 0) && ((oy < 0) || ((oy == 0) && (ox < 0)))) continue;
+              long nx = cx + ox;
+              long ny = cy + oy;
+              long nz = cz + oz;
+              if ((nx < 0) || (nx >= nc[0]) || (ny < 0) || (ny >= nc[1]) ||
+                  (nz >= nc[2]))
+                continue;
+              size_t n = (nz * nc[1] + ny) * nc[0] + nx;
+              bool same = (n == c);
+
+              for (size_t a = start[c]; a < start[c + 1]; ++a) {
+                size_t i = atoms[a];
+                const size_t* p_offsets = &(offsets[species[i] * NS]);
+                double xi = x[i];
+                double yi = y[i];
+                double zi = z[i];
+                for (size_t b = same ? a + 1 : start[n]; b < start[n + 1];
+                     ++b) {
+                  size_t j = atoms[b];
+                  double dx = x[j] - xi;
+                  double dy = y[j] - yi;
+                  double dz = z[j] - zi;
+                  double r2 = dx * dx + dy * dy + dz * dz;
+                  if (r2 >= cutoff2) continue;
+                  size_t k = size_t(sqrt(r2) * scale);
+                  H[p_offsets[species[j]] + std::min(k, last)] += 1;
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+}
+
+void pair_histogram(const coor_t* x, const coor_t* y, const coor_t* z,
+                    const size_t* species, size_t NS, size_t N,
+                    double binwidth, size_t NBINS, double cutoff, double* H) {
+  if ((N < 2) || (NBINS == 0)) return;
+  if (cutoff > 0) {
+    histogram_cells(x, y, z, species, NS, N, binwidth, NBINS, cutoff, H);
+  } else {
+    histogram_all(x, y, z, species, NS, N, binwidth, NBINS, H);
+  }
+}
+
+void sinc_table(double q, double binwidth, size_t NBINS, double* S) {
+  for (size_t k = 0; k < NBINS; ++k) {
+    double qr = q * (k + 0.5) * binwidth;
+    S[k] = (qr > 0) ? sin(qr) / qr : 1.0;
+  }
+}
+}
+
+// end of file
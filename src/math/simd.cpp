@@ -0,0 +1,1161 @@
+/** \file
+This file contains vectorized kernels for the scattering calculation and the
+runtime detection of the instruction set extensions they depend on.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "math/simd.hpp"
+
+// standard header
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// special library headers
+#if defined(__x86_64__) &&                                       \
+    (defined(__clang__) ||                                       \
+     (defined(__GNUC__) && !defined(__INTEL_COMPILER) &&         \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define SMATH_SIMD_X86
+// GCC 12 seeds the pass-through operand of many AVX-512 intrinsics with the
+// self-initialized register of _mm512_undefined_pd, which warns wherever such
+// an intrinsic is inlined (GCC bug 105593)
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#endif
+
+// the phase q*r has to be rounded exactly like in the scalar kernel, otherwise
+// large phases deviate by an ulp of q*r instead of an ulp of the result
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+// other headers
+
+using namespace std;
+
+namespace smath {
+
+namespace {
+
+// Cody-Waite decomposition of pi/2 (fdlibm)
+const double PIO2_1 = 1.57079632673412561417e+00;
+const double PIO2_2 = 6.07710050630396597660e-11;
+const double PIO2_3 = 2.02226624871116645580e-21;
+const double TWO_OVER_PI = 6.36619772367581382433e-01;
+
+// minimax polynomials for sine and cosine on [-pi/4,pi/4] (fdlibm)
+const double S1 = -1.66666666666666324348e-01;
+const double S2 = 8.33333333332248946124e-03;
+const double S3 = -1.98412698298579493134e-04;
+const double S4 = 2.75573137070700676789e-06;
+const double S5 = -2.50507602534068634195e-08;
+const double S6 = 1.58969099521155010221e-10;
+const double C1 = 4.16666666666666019037e-02;
+const double C2 = -1.38888888888741095749e-03;
+const double C3 = 2.48015872894767294178e-05;
+const double C4 = -2.75573143513906633035e-07;
+const double C5 = 2.08757232129817482790e-09;
+const double C6 = -1.13596475577881948265e-11;
+
+// single precision decomposition of pi/2 and minimax polynomials (cephes)
+const float PIO2F_1 = 1.5703125f;
+const float PIO2F_2 = 4.837512969970703125e-4f;
+const float PIO2F_3 = 7.54978995489188216e-8f;
+const float TWO_OVER_PI_F = 0.636619772367581343f;
+const float SF1 = -1.6666654611e-1f;
+const float SF2 = 8.3321608736e-3f;
+const float SF3 = -1.9515295891e-4f;
+const float CF1 = 4.166664568298827e-2f;
+const float CF2 = -1.388731625493765e-3f;
+const float CF3 = 2.443315711809948e-5f;
+
+// number of q vectors evaluated per pass over the atoms
+const size_t QTILE = 4;
+
+// number of lags evaluated per pass over a block of frames, and number of
+// frames per block, which keeps the block and its shifted copies in cache
+const size_t LTILE = 4;
+const size_t CBLOCK = 1024;
+
+// number of partner atoms per pass over the atoms of a Debye sum, which keeps
+// their coordinates in cache, and the smallest argument of sin(x)/x
+const size_t DBLOCK = 1024;
+const double SINC_MIN = 1e-200;
+
+// C is the type in which the phases and their sine and cosine are evaluated,
+// the sums are accumulated in double precision
+template <size_t T, class C>
+void phase_tile_scalar(const coor_t* x, const coor_t* y, const coor_t* z,
+                       const double* factors, size_t N, const double* qx,
+                       const double* qy, const double* qz, double* Ar,
+                       double* Ai) {
+  double sr[T];
+  double si[T];
+  C cqx[T], cqy[T], cqz[T];
+  for (size_t k = 0; k < T; ++k) {
+    sr[k] = 0;
+    si[k] = 0;
+    cqx[k] = C(qx[k]);
+    cqy[k] = C(qy[k]);
+    cqz[k] = C(qz[k]);
+  }
+  for (size_t j = 0; j < N; ++j) {
+    for (size_t k = 0; k < T; ++k) {
+      C p = C(x[j]) * cqx[k] + C(y[j]) * cqy[k] + C(z[j]) * cqz[k];
+      sr[k] += factors[j] * std::cos(p);
+      si[k] += factors[j] * std::sin(p);
+    }
+  }
+  for (size_t k = 0; k < T; ++k) {
+    Ar[k] = sr[k];
+    Ai[k] = si[k];
+  }
+}
+
+// adds sum_k a_k * conj(a_k+tau) for k0 <= k < min(k1, N - tau) to the
+// interleaved real and imaginary parts c of the lags tau0 <= tau < tau0 + T
+template <size_t T>
+void correlate_tile_scalar(const double* re, const double* im, size_t N,
+                           size_t k0, size_t k1, size_t tau0, double* c) {
+  for (size_t t = 0; t < T; ++t) {
+    size_t tau = tau0 + t;
+    size_t kend = std::min(k1, N - tau);
+    double sr = 0;
+    double si = 0;
+    for (size_t k = k0; k < kend; ++k) {
+      sr += re[k] * re[k + tau] + im[k] * im[k + tau];
+      si += im[k] * re[k + tau] - re[k] * im[k + tau];
+    }
+    c[2 * tau] += sr;
+    c[2 * tau + 1] += si;
+  }
+}
+
+void phase_factors_scalar(const coor_t* x, const coor_t* y, const coor_t* z,
+                          size_t N, double qx, double qy, double qz,
+                          double* re, double* im) {
+  for (size_t j = 0; j < N; ++j) {
+    double p = x[j] * qx + y[j] * qy + z[j] * qz;
+    re[j] = cos(p);
+    im[j] = sin(p);
+  }
+}
+
+// returns sum_j f_j * sin(q r_ij) / (q r_ij) for j0 <= j < j1
+double debye_row_scalar(double xi, double yi, double zi, const coor_t* x,
+                        const coor_t* y, const coor_t* z,
+                        const double* factors, double q, size_t j0,
+                        size_t j1) {
+  double s = 0;
+  for (size_t j = j0; j < j1; ++j) {
+    double dx = xi - x[j];
+    double dy = yi - y[j];
+    double dz = zi - z[j];
+    double qr = std::max(q * sqrt(dx * dx + dy * dy + dz * dz), SINC_MIN);
+    s += factors[j] * (sin(qr) / qr);
+  }
+  return s;
+}
+
+double debye_tile_scalar(const coor_t* x, const coor_t* y, const coor_t* z,
+                         const double* factors, double q, size_t i0,
+                         size_t i1, size_t j0, size_t j1) {
+  double s = 0;
+  for (size_t i = i0; i < i1; ++i) {
+    s += factors[i] *
+         debye_row_scalar(x[i], y[i], z[i], x, y, z, factors, q, j0, j1);
+  }
+  return s;
+}
+
+void phase_advance_scalar(double* re, double* im, const double* step_re,
+                          const double* step_im, const double* factors,
+                          size_t N, double& Ar, double& Ai) {
+  double sr = 0;
+  double si = 0;
+  for (size_t j = 0; j < N; ++j) {
+    double r = re[j] * step_re[j] - im[j] * step_im[j];
+    double i = re[j] * step_im[j] + im[j] * step_re[j];
+    re[j] = r;
+    im[j] = i;
+    sr += factors[j] * r;
+    si += factors[j] * i;
+  }
+  Ar = sr;
+  Ai = si;
+}
+
+#ifdef SMATH_SIMD_X86
+
+__attribute__((target("avx2,fma"))) inline __m256d load4(const float* p) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+
+__attribute__((target("avx2,fma"))) inline __m256d load4(const double* p) {
+  return _mm256_loadu_pd(p);
+}
+
+__attribute__((target("avx2,fma"))) inline void sincos4(__m256d x, __m256d& s,
+                                                       __m256d& c) {
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d sign = _mm256_set1_pd(-0.0);
+
+  // reduce to r in [-pi/4,pi/4], x = j*pi/2 + r
+  __m256d j =
+      _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(TWO_OVER_PI)),
+                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256d r = _mm256_fnmadd_pd(j, _mm256_set1_pd(PIO2_1), x);
+  r = _mm256_fnmadd_pd(j, _mm256_set1_pd(PIO2_2), r);
+  r = _mm256_fnmadd_pd(j, _mm256_set1_pd(PIO2_3), r);
+  __m256d z = _mm256_mul_pd(r, r);
+
+  __m256d ps = _mm256_fmadd_pd(_mm256_set1_pd(S6), z, _mm256_set1_pd(S5));
+  ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(S4));
+  ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(S3));
+  ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(S2));
+  ps = _mm256_fmadd_pd(ps, z, _mm256_set1_pd(S1));
+  __m256d sr = _mm256_fmadd_pd(_mm256_mul_pd(r, z), ps, r);
+
+  __m256d pc = _mm256_fmadd_pd(_mm256_set1_pd(C6), z, _mm256_set1_pd(C5));
+  pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(C4));
+  pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(C3));
+  pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(C2));
+  pc = _mm256_fmadd_pd(pc, z, _mm256_set1_pd(C1));
+  __m256d cr = _mm256_fmadd_pd(_mm256_mul_pd(z, z), pc,
+                               _mm256_fnmadd_pd(_mm256_set1_pd(0.5), z, one));
+
+  // quadrant q = j mod 4 decides about swapping and signs
+  __m256d q = _mm256_sub_pd(
+      j, _mm256_mul_pd(_mm256_set1_pd(4.0),
+                       _mm256_floor_pd(_mm256_mul_pd(
+                           j, _mm256_set1_pd(0.25)))));
+  __m256d odd = _mm256_sub_pd(
+      q, _mm256_mul_pd(_mm256_set1_pd(2.0),
+                       _mm256_floor_pd(_mm256_mul_pd(q, _mm256_set1_pd(0.5)))));
+  __m256d swap = _mm256_cmp_pd(odd, one, _CMP_EQ_OQ);
+  __m256d sneg = _mm256_cmp_pd(q, _mm256_set1_pd(1.5), _CMP_GT_OQ);
+  __m256d cneg =
+      _mm256_and_pd(_mm256_cmp_pd(q, _mm256_set1_pd(0.5), _CMP_GT_OQ),
+                    _mm256_cmp_pd(q, _mm256_set1_pd(2.5), _CMP_LT_OQ));
+
+  s = _mm256_xor_pd(_mm256_blendv_pd(sr, cr, swap), _mm256_and_pd(sneg, sign));
+  c = _mm256_xor_pd(_mm256_blendv_pd(cr, sr, swap), _mm256_and_pd(cneg, sign));
+}
+
+__attribute__((target("avx2,fma"))) inline void accumulate4(
+    __m256d x, __m256d y, __m256d z, __m256d f, double qx, double qy, double qz,
+    __m256d& ar, __m256d& ai) {
+  __m256d s, c;
+  __m256d p = _mm256_add_pd(
+      _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(qx)),
+                    _mm256_mul_pd(y, _mm256_set1_pd(qy))),
+      _mm256_mul_pd(z, _mm256_set1_pd(qz)));
+  sincos4(p, s, c);
+  ar = _mm256_fmadd_pd(f, c, ar);
+  ai = _mm256_fmadd_pd(f, s, ai);
+}
+
+template <size_t T>
+__attribute__((target("avx2,fma"))) void phase_tile_avx2(
+    const coor_t* x, const coor_t* y, const coor_t* z, const double* factors,
+    size_t N, const double* qx, const double* qy, const double* qz, double* Ar,
+    double* Ai) {
+  __m256d ar[T];
+  __m256d ai[T];
+  for (size_t k = 0; k < T; ++k) {
+    ar[k] = _mm256_setzero_pd();
+    ai[k] = _mm256_setzero_pd();
+  }
+
+  size_t j = 0;
+  for (; j + 4 <= N; j += 4) {
+    __m256d vx = load4(x + j);
+    __m256d vy = load4(y + j);
+    __m256d vz = load4(z + j);
+    __m256d f = _mm256_loadu_pd(factors + j);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate4(vx, vy, vz, f, qx[k], qy[k], qz[k], ar[k], ai[k]);
+    }
+  }
+
+  // remainder, padded with zero weights
+  if (j < N) {
+    coor_t tx[4] = {0, 0, 0, 0};
+    coor_t ty[4] = {0, 0, 0, 0};
+    coor_t tz[4] = {0, 0, 0, 0};
+    double tf[4] = {0, 0, 0, 0};
+    for (size_t l = 0; j + l < N; ++l) {
+      tx[l] = x[j + l];
+      ty[l] = y[j + l];
+      tz[l] = z[j + l];
+      tf[l] = factors[j + l];
+    }
+    __m256d vx = load4(tx);
+    __m256d vy = load4(ty);
+    __m256d vz = load4(tz);
+    __m256d f = _mm256_loadu_pd(tf);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate4(vx, vy, vz, f, qx[k], qy[k], qz[k], ar[k], ai[k]);
+    }
+  }
+
+  for (size_t k = 0; k < T; ++k) {
+    double br[4], bi[4];
+    _mm256_storeu_pd(br, ar[k]);
+    _mm256_storeu_pd(bi, ai[k]);
+    Ar[k] = (br[0] + br[1]) + (br[2] + br[3]);
+    Ai[k] = (bi[0] + bi[1]) + (bi[2] + bi[3]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 load8f(const float* p) {
+  return _mm256_loadu_ps(p);
+}
+
+__attribute__((target("avx2,fma"))) inline __m256 load8f(const double* p) {
+  return _mm256_insertf128_ps(
+      _mm256_castps128_ps256(_mm256_cvtpd_ps(_mm256_loadu_pd(p))),
+      _mm256_cvtpd_ps(_mm256_loadu_pd(p + 4)), 1);
+}
+
+__attribute__((target("avx2,fma"))) inline void sincos8f(__m256 x, __m256& s,
+                                                        __m256& c) {
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+
+  // reduce to r in [-pi/4,pi/4], x = j*pi/2 + r
+  __m256 j = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI_F)),
+                             _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PIO2F_1), x);
+  r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PIO2F_2), r);
+  r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PIO2F_3), r);
+  __m256 z = _mm256_mul_ps(r, r);
+
+  __m256 ps = _mm256_fmadd_ps(_mm256_set1_ps(SF3), z, _mm256_set1_ps(SF2));
+  ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(SF1));
+  __m256 sr = _mm256_fmadd_ps(_mm256_mul_ps(r, z), ps, r);
+
+  __m256 pc = _mm256_fmadd_ps(_mm256_set1_ps(CF3), z, _mm256_set1_ps(CF2));
+  pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(CF1));
+  __m256 cr = _mm256_fmadd_ps(_mm256_mul_ps(z, z), pc,
+                              _mm256_fnmadd_ps(_mm256_set1_ps(0.5f), z, one));
+
+  // the two lowest bits of j decide about swapping and signs
+  __m256i q = _mm256_cvtps_epi32(j);
+  __m256i b1 = _mm256_set1_epi32(1);
+  __m256i b2 = _mm256_set1_epi32(2);
+  __m256 swap = _mm256_castsi256_ps(
+      _mm256_cmpeq_epi32(_mm256_and_si256(q, b1), b1));
+  __m256 sneg = _mm256_castsi256_ps(
+      _mm256_cmpeq_epi32(_mm256_and_si256(q, b2), b2));
+  __m256 cneg = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+      _mm256_and_si256(_mm256_add_epi32(q, b1), b2), b2));
+
+  s = _mm256_xor_ps(_mm256_blendv_ps(sr, cr, swap), _mm256_and_ps(sneg, sign));
+  c = _mm256_xor_ps(_mm256_blendv_ps(cr, sr, swap), _mm256_and_ps(cneg, sign));
+}
+
+__attribute__((target("avx2,fma"))) inline void accumulate8f(
+    __m256 x, __m256 y, __m256 z, __m256d flo, __m256d fhi, float qx, float qy,
+    float qz, __m256d& ar, __m256d& ai) {
+  __m256 s, c;
+  __m256 p = _mm256_fmadd_ps(
+      z, _mm256_set1_ps(qz),
+      _mm256_fmadd_ps(y, _mm256_set1_ps(qy),
+                      _mm256_mul_ps(x, _mm256_set1_ps(qx))));
+  sincos8f(p, s, c);
+  ar = _mm256_fmadd_pd(flo, _mm256_cvtps_pd(_mm256_castps256_ps128(c)), ar);
+  ar = _mm256_fmadd_pd(fhi, _mm256_cvtps_pd(_mm256_extractf128_ps(c, 1)), ar);
+  ai = _mm256_fmadd_pd(flo, _mm256_cvtps_pd(_mm256_castps256_ps128(s)), ai);
+  ai = _mm256_fmadd_pd(fhi, _mm256_cvtps_pd(_mm256_extractf128_ps(s, 1)), ai);
+}
+
+template <size_t T>
+__attribute__((target("avx2,fma"))) void phase_tile_avx2_mixed(
+    const coor_t* x, const coor_t* y, const coor_t* z, const double* factors,
+    size_t N, const double* qx, const double* qy, const double* qz, double* Ar,
+    double* Ai) {
+  __m256d ar[T];
+  __m256d ai[T];
+  float fqx[T], fqy[T], fqz[T];
+  for (size_t k = 0; k < T; ++k) {
+    ar[k] = _mm256_setzero_pd();
+    ai[k] = _mm256_setzero_pd();
+    fqx[k] = float(qx[k]);
+    fqy[k] = float(qy[k]);
+    fqz[k] = float(qz[k]);
+  }
+
+  size_t j = 0;
+  for (; j + 8 <= N; j += 8) {
+    __m256 vx = load8f(x + j);
+    __m256 vy = load8f(y + j);
+    __m256 vz = load8f(z + j);
+    __m256d flo = _mm256_loadu_pd(factors + j);
+    __m256d fhi = _mm256_loadu_pd(factors + j + 4);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate8f(vx, vy, vz, flo, fhi, fqx[k], fqy[k], fqz[k], ar[k], ai[k]);
+    }
+  }
+
+  // remainder, padded with zero weights
+  if (j < N) {
+    coor_t tx[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    coor_t ty[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    coor_t tz[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    double tf[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (size_t l = 0; j + l < N; ++l) {
+      tx[l] = x[j + l];
+      ty[l] = y[j + l];
+      tz[l] = z[j + l];
+      tf[l] = factors[j + l];
+    }
+    __m256 vx = load8f(tx);
+    __m256 vy = load8f(ty);
+    __m256 vz = load8f(tz);
+    __m256d flo = _mm256_loadu_pd(tf);
+    __m256d fhi = _mm256_loadu_pd(tf + 4);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate8f(vx, vy, vz, flo, fhi, fqx[k], fqy[k], fqz[k], ar[k], ai[k]);
+    }
+  }
+
+  for (size_t k = 0; k < T; ++k) {
+    double br[4], bi[4];
+    _mm256_storeu_pd(br, ar[k]);
+    _mm256_storeu_pd(bi, ai[k]);
+    Ar[k] = (br[0] + br[1]) + (br[2] + br[3]);
+    Ai[k] = (bi[0] + bi[1]) + (bi[2] + bi[3]);
+  }
+}
+
+// the upper half of v. The masked extraction takes the zero register as source,
+// as the unmasked one expands to an undefined register, which GCC reports.
+__attribute__((target("avx512f"))) inline __m256d upper4(__m512d v) {
+  return _mm512_mask_extractf64x4_pd(_mm256_setzero_pd(), 0xF, v, 1);
+}
+
+// horizontal sum, which adds the halves by AVX2 instead of the expansion of
+// _mm512_reduce_add_pd
+__attribute__((target("avx512f"))) inline double reduce8(__m512d v) {
+  __m256d h = _mm256_add_pd(_mm512_castpd512_pd256(v), upper4(v));
+  __m128d q = _mm_add_pd(_mm256_castpd256_pd128(h), _mm256_extractf128_pd(h, 1));
+  return _mm_cvtsd_f64(_mm_add_sd(q, _mm_unpackhi_pd(q, q)));
+}
+
+__attribute__((target("avx512f"))) inline __m512d load8(const float* p) {
+  return _mm512_cvtps_pd(_mm256_loadu_ps(p));
+}
+
+__attribute__((target("avx512f"))) inline __m512d load8(const double* p) {
+  return _mm512_loadu_pd(p);
+}
+
+__attribute__((target("avx512f"))) inline void sincos8(__m512d x, __m512d& s,
+                                                      __m512d& c) {
+  const __m512d zero = _mm512_setzero_pd();
+  const __m512d one = _mm512_set1_pd(1.0);
+
+  // reduce to r in [-pi/4,pi/4], x = j*pi/2 + r
+  __m512d j =
+      _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(TWO_OVER_PI)),
+                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512d r = _mm512_fnmadd_pd(j, _mm512_set1_pd(PIO2_1), x);
+  r = _mm512_fnmadd_pd(j, _mm512_set1_pd(PIO2_2), r);
+  r = _mm512_fnmadd_pd(j, _mm512_set1_pd(PIO2_3), r);
+  __m512d z = _mm512_mul_pd(r, r);
+
+  __m512d ps = _mm512_fmadd_pd(_mm512_set1_pd(S6), z, _mm512_set1_pd(S5));
+  ps = _mm512_fmadd_pd(ps, z, _mm512_set1_pd(S4));
+  ps = _mm512_fmadd_pd(ps, z, _mm512_set1_pd(S3));
+  ps = _mm512_fmadd_pd(ps, z, _mm512_set1_pd(S2));
+  ps = _mm512_fmadd_pd(ps, z, _mm512_set1_pd(S1));
+  __m512d sr = _mm512_fmadd_pd(_mm512_mul_pd(r, z), ps, r);
+
+  __m512d pc = _mm512_fmadd_pd(_mm512_set1_pd(C6), z, _mm512_set1_pd(C5));
+  pc = _mm512_fmadd_pd(pc, z, _mm512_set1_pd(C4));
+  pc = _mm512_fmadd_pd(pc, z, _mm512_set1_pd(C3));
+  pc = _mm512_fmadd_pd(pc, z, _mm512_set1_pd(C2));
+  pc = _mm512_fmadd_pd(pc, z, _mm512_set1_pd(C1));
+  __m512d cr = _mm512_fmadd_pd(_mm512_mul_pd(z, z), pc,
+                               _mm512_fnmadd_pd(_mm512_set1_pd(0.5), z, one));
+
+  // quadrant q = j mod 4 decides about swapping and signs
+  const int down = _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC;
+  __m512d q = _mm512_fnmadd_pd(
+      _mm512_set1_pd(4.0),
+      _mm512_roundscale_pd(_mm512_mul_pd(j, _mm512_set1_pd(0.25)), down), j);
+  __m512d odd = _mm512_fnmadd_pd(
+      _mm512_set1_pd(2.0),
+      _mm512_roundscale_pd(_mm512_mul_pd(q, _mm512_set1_pd(0.5)), down), q);
+  __mmask8 swap = _mm512_cmp_pd_mask(odd, one, _CMP_EQ_OQ);
+  __mmask8 sneg = _mm512_cmp_pd_mask(q, _mm512_set1_pd(1.5), _CMP_GT_OQ);
+  __mmask8 cneg = _mm512_cmp_pd_mask(q, _mm512_set1_pd(0.5), _CMP_GT_OQ) &
+                  _mm512_cmp_pd_mask(q, _mm512_set1_pd(2.5), _CMP_LT_OQ);
+
+  s = _mm512_mask_blend_pd(swap, sr, cr);
+  c = _mm512_mask_blend_pd(swap, cr, sr);
+  s = _mm512_mask_sub_pd(s, sneg, zero, s);
+  c = _mm512_mask_sub_pd(c, cneg, zero, c);
+}
+
+__attribute__((target("avx512f"))) inline void accumulate8(
+    __m512d x, __m512d y, __m512d z, __m512d f, double qx, double qy, double qz,
+    __m512d& ar, __m512d& ai) {
+  __m512d s, c;
+  __m512d p = _mm512_add_pd(
+      _mm512_add_pd(_mm512_mul_pd(x, _mm512_set1_pd(qx)),
+                    _mm512_mul_pd(y, _mm512_set1_pd(qy))),
+      _mm512_mul_pd(z, _mm512_set1_pd(qz)));
+  sincos8(p, s, c);
+  ar = _mm512_fmadd_pd(f, c, ar);
+  ai = _mm512_fmadd_pd(f, s, ai);
+}
+
+template <size_t T>
+__attribute__((target("avx512f"))) void phase_tile_avx512(
+    const coor_t* x, const coor_t* y, const coor_t* z, const double* factors,
+    size_t N, const double* qx, const double* qy, const double* qz, double* Ar,
+    double* Ai) {
+  __m512d ar[T];
+  __m512d ai[T];
+  for (size_t k = 0; k < T; ++k) {
+    ar[k] = _mm512_setzero_pd();
+    ai[k] = _mm512_setzero_pd();
+  }
+
+  size_t j = 0;
+  for (; j + 8 <= N; j += 8) {
+    __m512d vx = load8(x + j);
+    __m512d vy = load8(y + j);
+    __m512d vz = load8(z + j);
+    __m512d f = _mm512_loadu_pd(factors + j);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate8(vx, vy, vz, f, qx[k], qy[k], qz[k], ar[k], ai[k]);
+    }
+  }
+
+  // remainder, padded with zero weights
+  if (j < N) {
+    coor_t tx[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    coor_t ty[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    coor_t tz[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    double tf[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (size_t l = 0; j + l < N; ++l) {
+      tx[l] = x[j + l];
+      ty[l] = y[j + l];
+      tz[l] = z[j + l];
+      tf[l] = factors[j + l];
+    }
+    __m512d vx = load8(tx);
+    __m512d vy = load8(ty);
+    __m512d vz = load8(tz);
+    __m512d f = _mm512_loadu_pd(tf);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate8(vx, vy, vz, f, qx[k], qy[k], qz[k], ar[k], ai[k]);
+    }
+  }
+
+  for (size_t k = 0; k < T; ++k) {
+    Ar[k] = reduce8(ar[k]);
+    Ai[k] = reduce8(ai[k]);
+  }
+}
+
+__attribute__((target("avx512f"))) inline __m512 load16f(const float* p) {
+  return _mm512_loadu_ps(p);
+}
+
+__attribute__((target("avx512f"))) inline __m512 load16f(const double* p) {
+  __m256 lo = _mm512_cvtpd_ps(_mm512_loadu_pd(p));
+  __m256 hi = _mm512_cvtpd_ps(_mm512_loadu_pd(p + 8));
+  return _mm512_castpd_ps(_mm512_insertf64x4(
+      _mm512_castpd256_pd512(_mm256_castps_pd(lo)), _mm256_castps_pd(hi), 1));
+}
+
+__attribute__((target("avx512f"))) inline void sincos16f(__m512 x, __m512& s,
+                                                        __m512& c) {
+  const __m512 zero = _mm512_setzero_ps();
+  const __m512 one = _mm512_set1_ps(1.0f);
+
+  // reduce to r in [-pi/4,pi/4], x = j*pi/2 + r
+  __m512 j =
+      _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(TWO_OVER_PI_F)),
+                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512 r = _mm512_fnmadd_ps(j, _mm512_set1_ps(PIO2F_1), x);
+  r = _mm512_fnmadd_ps(j, _mm512_set1_ps(PIO2F_2), r);
+  r = _mm512_fnmadd_ps(j, _mm512_set1_ps(PIO2F_3), r);
+  __m512 z = _mm512_mul_ps(r, r);
+
+  __m512 ps = _mm512_fmadd_ps(_mm512_set1_ps(SF3), z, _mm512_set1_ps(SF2));
+  ps = _mm512_fmadd_ps(ps, z, _mm512_set1_ps(SF1));
+  __m512 sr = _mm512_fmadd_ps(_mm512_mul_ps(r, z), ps, r);
+
+  __m512 pc = _mm512_fmadd_ps(_mm512_set1_ps(CF3), z, _mm512_set1_ps(CF2));
+  pc = _mm512_fmadd_ps(pc, z, _mm512_set1_ps(CF1));
+  __m512 cr = _mm512_fmadd_ps(_mm512_mul_ps(z, z), pc,
+                              _mm512_fnmadd_ps(_mm512_set1_ps(0.5f), z, one));
+
+  // the two lowest bits of j decide about swapping and signs
+  __m512i q = _mm512_cvtps_epi32(j);
+  __m512i b1 = _mm512_set1_epi32(1);
+  __m512i b2 = _mm512_set1_epi32(2);
+  __mmask16 swap = _mm512_test_epi32_mask(q, b1);
+  __mmask16 sneg = _mm512_test_epi32_mask(q, b2);
+  __mmask16 cneg = _mm512_test_epi32_mask(_mm512_add_epi32(q, b1), b2);
+
+  s = _mm512_mask_blend_ps(swap, sr, cr);
+  c = _mm512_mask_blend_ps(swap, cr, sr);
+  s = _mm512_mask_sub_ps(s, sneg, zero, s);
+  c = _mm512_mask_sub_ps(c, cneg, zero, c);
+}
+
+__attribute__((target("avx512f"))) inline __m512d upper16f(__m512 v) {
+  return _mm512_cvtps_pd(_mm256_castpd_ps(upper4(_mm512_castps_pd(v))));
+}
+
+__attribute__((target("avx512f"))) inline void accumulate16f(
+    __m512 x, __m512 y, __m512 z, __m512d flo, __m512d fhi, float qx, float qy,
+    float qz, __m512d& ar, __m512d& ai) {
+  __m512 s, c;
+  __m512 p = _mm512_fmadd_ps(
+      z, _mm512_set1_ps(qz),
+      _mm512_fmadd_ps(y, _mm512_set1_ps(qy),
+                      _mm512_mul_ps(x, _mm512_set1_ps(qx))));
+  sincos16f(p, s, c);
+  ar = _mm512_fmadd_pd(flo, _mm512_cvtps_pd(_mm512_castps512_ps256(c)), ar);
+  ar = _mm512_fmadd_pd(fhi, upper16f(c), ar);
+  ai = _mm512_fmadd_pd(flo, _mm512_cvtps_pd(_mm512_castps512_ps256(s)), ai);
+  ai = _mm512_fmadd_pd(fhi, upper16f(s), ai);
+}
+
+template <size_t T>
+__attribute__((target("avx512f"))) void phase_tile_avx512_mixed(
+    const coor_t* x, const coor_t* y, const coor_t* z, const double* factors,
+    size_t N, const double* qx, const double* qy, const double* qz, double* Ar,
+    double* Ai) {
+  __m512d ar[T];
+  __m512d ai[T];
+  float fqx[T], fqy[T], fqz[T];
+  for (size_t k = 0; k < T; ++k) {
+    ar[k] = _mm512_setzero_pd();
+    ai[k] = _mm512_setzero_pd();
+    fqx[k] = float(qx[k]);
+    fqy[k] = float(qy[k]);
+    fqz[k] = float(qz[k]);
+  }
+
+  size_t j = 0;
+  for (; j + 16 <= N; j += 16) {
+    __m512 vx = load16f(x + j);
+    __m512 vy = load16f(y + j);
+    __m512 vz = load16f(z + j);
+    __m512d flo = _mm512_loadu_pd(factors + j);
+    __m512d fhi = _mm512_loadu_pd(factors + j + 8);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate16f(vx, vy, vz, flo, fhi, fqx[k], fqy[k], fqz[k], ar[k],
+                    ai[k]);
+    }
+  }
+
+  // remainder, padded with zero weights
+  if (j < N) {
+    coor_t tx[16] = {0};
+    coor_t ty[16] = {0};
+    coor_t tz[16] = {0};
+    double tf[16] = {0};
+    for (size_t l = 0; j + l < N; ++l) {
+      tx[l] = x[j + l];
+      ty[l] = y[j + l];
+      tz[l] = z[j + l];
+      tf[l] = factors[j + l];
+    }
+    __m512 vx = load16f(tx);
+    __m512 vy = load16f(ty);
+    __m512 vz = load16f(tz);
+    __m512d flo = _mm512_loadu_pd(tf);
+    __m512d fhi = _mm512_loadu_pd(tf + 8);
+    for (size_t k = 0; k < T; ++k) {
+      accumulate16f(vx, vy, vz, flo, fhi, fqx[k], fqy[k], fqz[k], ar[k],
+                    ai[k]);
+    }
+  }
+
+  for (size_t k = 0; k < T; ++k) {
+    Ar[k] = reduce8(ar[k]);
+    Ai[k] = reduce8(ai[k]);
+  }
+}
+
+__attribute__((target("avx2,fma"))) double debye_tile_avx2(
+    const coor_t* x, const coor_t* y, const coor_t* z, const double* factors,
+    double q, size_t i0, size_t i1, size_t j0, size_t j1) {
+  const __m256d vq = _mm256_set1_pd(q);
+  const __m256d vmin = _mm256_set1_pd(SINC_MIN);
+  __m256d total = _mm256_setzero_pd();
+  double rest = 0;
+
+  size_t jend = j0 + 4 * ((j1 - j0) / 4);
+  for (size_t i = i0; i < i1; ++i) {
+    __m256d xi = _mm256_set1_pd(x[i]);
+    __m256d yi = _mm256_set1_pd(y[i]);
+    __m256d zi = _mm256_set1_pd(z[i]);
+    __m256d acc = _mm256_setzero_pd();
+    for (size_t j = j0; j < jend; j += 4) {
+      __m256d dx = _mm256_sub_pd(xi, load4(x + j));
+      __m256d dy = _mm256_sub_pd(yi, load4(y + j));
+      __m256d dz = _mm256_sub_pd(zi, load4(z + j));
+      __m256d r2 = _mm256_fmadd_pd(
+          dz, dz, _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx)));
+      __m256d qr = _mm256_max_pd(_mm256_mul_pd(vq, _mm256_sqrt_pd(r2)), vmin);
+      __m256d s, c;
+      sincos4(qr, s, c);
+      acc = _mm256_fmadd_pd(_mm256_loadu_pd(factors + j),
+                            _mm256_div_pd(s, qr), acc);
+    }
+    total = _mm256_fmadd_pd(_mm256_set1_pd(factors[i]), acc, total);
+    if (jend < j1) {
+      rest += factors[i] * debye_row_scalar(x[i], y[i], z[i], x, y, z,
+                                            factors, q, jend, j1);
+    }
+  }
+
+  double b[4];
+  _mm256_storeu_pd(b, total);
+  return (b[0] + b[1]) + (b[2] + b[3]) + rest;
+}
+
+template <size_t T>
+__attribute__((target("avx2,fma"))) void correlate_tile_avx2(
+    const double* re, const double* im, size_t N, size_t k0, size_t k1,
+    size_t tau0, double* c) {
+  __m256d sr[T];
+  __m256d si[T];
+  for (size_t t = 0; t < T; ++t) {
+    sr[t] = _mm256_setzero_pd();
+    si[t] = _mm256_setzero_pd();
+  }
+
+  // frames for which every lag of the tile has a partner
+  size_t kcommon = std::min(k1, N - (tau0 + T - 1));
+  size_t k = k0;
+  for (; k + 4 <= kcommon; k += 4) {
+    __m256d ar = _mm256_loadu_pd(re + k);
+    __m256d ai = _mm256_loadu_pd(im + k);
+    for (size_t t = 0; t < T; ++t) {
+      __m256d br = _mm256_loadu_pd(re + k + tau0 + t);
+      __m256d bi = _mm256_loadu_pd(im + k + tau0 + t);
+      sr[t] = _mm256_fmadd_pd(ar, br, _mm256_fmadd_pd(ai, bi, sr[t]));
+      si[t] = _mm256_fmadd_pd(ai, br, _mm256_fnmadd_pd(ar, bi, si[t]));
+    }
+  }
+
+  for (size_t t = 0; t < T; ++t) {
+    double br[4], bi[4];
+    _mm256_storeu_pd(br, sr[t]);
+    _mm256_storeu_pd(bi, si[t]);
+    c[2 * (tau0 + t)] += (br[0] + br[1]) + (br[2] + br[3]);
+    c[2 * (tau0 + t) + 1] += (bi[0] + bi[1]) + (bi[2] + bi[3]);
+  }
+  // the compiler does not clear the upper register halves on its own here,
+  // which would slow down subsequent SSE code like libm
+  _mm256_zeroupper();
+  correlate_tile_scalar<T>(re, im, N, k, k1, tau0, c);
+}
+
+__attribute__((target("avx2,fma"))) void phase_factors_avx2(
+    const coor_t* x, const coor_t* y, const coor_t* z, size_t N, double qx,
+    double qy, double qz, double* re, double* im) {
+  const __m256d vqx = _mm256_set1_pd(qx);
+  const __m256d vqy = _mm256_set1_pd(qy);
+  const __m256d vqz = _mm256_set1_pd(qz);
+  __m256d s, c;
+
+  size_t j = 0;
+  for (; j + 4 <= N; j += 4) {
+    __m256d p = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(load4(x + j), vqx),
+                      _mm256_mul_pd(load4(y + j), vqy)),
+        _mm256_mul_pd(load4(z + j), vqz));
+    sincos4(p, s, c);
+    _mm256_storeu_pd(re + j, c);
+    _mm256_storeu_pd(im + j, s);
+  }
+  phase_factors_scalar(x + j, y + j, z + j, N - j, qx, qy, qz, re + j, im + j);
+}
+
+__attribute__((target("avx2,fma"))) void phase_advance_avx2(
+    double* re, double* im, const double* step_re, const double* step_im,
+    const double* factors, size_t N, double& Ar, double& Ai) {
+  __m256d ar = _mm256_setzero_pd();
+  __m256d ai = _mm256_setzero_pd();
+
+  size_t j = 0;
+  for (; j + 4 <= N; j += 4) {
+    __m256d a = _mm256_loadu_pd(re + j);
+    __m256d b = _mm256_loadu_pd(im + j);
+    __m256d c = _mm256_loadu_pd(step_re + j);
+    __m256d d = _mm256_loadu_pd(step_im + j);
+    __m256d r = _mm256_fmsub_pd(a, c, _mm256_mul_pd(b, d));
+    __m256d i = _mm256_fmadd_pd(a, d, _mm256_mul_pd(b, c));
+    _mm256_storeu_pd(re + j, r);
+    _mm256_storeu_pd(im + j, i);
+    __m256d f = _mm256_loadu_pd(factors + j);
+    ar = _mm256_fmadd_pd(f, r, ar);
+    ai = _mm256_fmadd_pd(f, i, ai);
+  }
+
+  double br[4], bi[4];
+  _mm256_storeu_pd(br, ar);
+  _mm256_storeu_pd(bi, ai);
+  double Rr, Ri;
+  phase_advance_scalar(re + j, im + j, step_re + j, step_im + j, factors + j,
+                       N - j, Rr, Ri);
+  Ar = (br[0] + br[1]) + (br[2] + br[3]) + Rr;
+  Ai = (bi[0] + bi[1]) + (bi[2] + bi[3]) + Ri;
+}
+
+__attribute__((target("avx512f"))) double debye_tile_avx512(
+    const coor_t* x, const coor_t* y, const coor_t* z, const double* factors,
+    double q, size_t i0, size_t i1, size_t j0, size_t j1) {
+  const __m512d vq = _mm512_set1_pd(q);
+  const __m512d vmin = _mm512_set1_pd(SINC_MIN);
+  __m512d total = _mm512_setzero_pd();
+  double rest = 0;
+
+  size_t jend = j0 + 8 * ((j1 - j0) / 8);
+  for (size_t i = i0; i < i1; ++i) {
+    __m512d xi = _mm512_set1_pd(x[i]);
+    __m512d yi = _mm512_set1_pd(y[i]);
+    __m512d zi = _mm512_set1_pd(z[i]);
+    __m512d acc = _mm512_setzero_pd();
+    for (size_t j = j0; j < jend; j += 8) {
+      __m512d dx = _mm512_sub_pd(xi, load8(x + j));
+      __m512d dy = _mm512_sub_pd(yi, load8(y + j));
+      __m512d dz = _mm512_sub_pd(zi, load8(z + j));
+      __m512d r2 = _mm512_fmadd_pd(
+          dz, dz, _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx)));
+      __m512d qr = _mm512_max_pd(_mm512_mul_pd(vq, _mm512_sqrt_pd(r2)), vmin);
+      __m512d s, c;
+      sincos8(qr, s, c);
+      acc = _mm512_fmadd_pd(_mm512_loadu_pd(factors + j),
+                            _mm512_div_pd(s, qr), acc);
+    }
+    total = _mm512_fmadd_pd(_mm512_set1_pd(factors[i]), acc, total);
+    if (jend < j1) {
+      rest += factors[i] * debye_row_scalar(x[i], y[i], z[i], x, y, z,
+                                            factors, q, jend, j1);
+    }
+  }
+
+  return reduce8(total) + rest;
+}
+
+template <size_t T>
+__attribute__((target("avx512f"))) void correlate_tile_avx512(
+    const double* re, const double* im, size_t N, size_t k0, size_t k1,
+    size_t tau0, double* c) {
+  __m512d sr[T];
+  __m512d si[T];
+  for (size_t t = 0; t < T; ++t) {
+    sr[t] = _mm512_setzero_pd();
+    si[t] = _mm512_setzero_pd();
+  }
+
+  // frames for which every lag of the tile has a partner
+  size_t kcommon = std::min(k1, N - (tau0 + T - 1));
+  size_t k = k0;
+  for (; k + 8 <= kcommon; k += 8) {
+    __m512d ar = _mm512_loadu_pd(re + k);
+    __m512d ai = _mm512_loadu_pd(im + k);
+    for (size_t t = 0; t < T; ++t) {
+      __m512d br = _mm512_loadu_pd(re + k + tau0 + t);
+      __m512d bi = _mm512_loadu_pd(im + k + tau0 + t);
+      sr[t] = _mm512_fmadd_pd(ar, br, _mm512_fmadd_pd(ai, bi, sr[t]));
+      si[t] = _mm512_fmadd_pd(ai, br, _mm512_fnmadd_pd(ar, bi, si[t]));
+    }
+  }
+
+  for (size_t t = 0; t < T; ++t) {
+    c[2 * (tau0 + t)] += reduce8(sr[t]);
+    c[2 * (tau0 + t) + 1] += reduce8(si[t]);
+  }
+  _mm256_zeroupper();
+  correlate_tile_scalar<T>(re, im, N, k, k1, tau0, c);
+}
+
+__attribute__((target("avx512f"))) void phase_factors_avx512(
+    const coor_t* x, const coor_t* y, const coor_t* z, size_t N, double qx,
+    double qy, double qz, double* re, double* im) {
+  const __m512d vqx = _mm512_set1_pd(qx);
+  const __m512d vqy = _mm512_set1_pd(qy);
+  const __m512d vqz = _mm512_set1_pd(qz);
+  __m512d s, c;
+
+  size_t j = 0;
+  for (; j + 8 <= N; j += 8) {
+    __m512d p = _mm512_add_pd(
+        _mm512_add_pd(_mm512_mul_pd(load8(x + j), vqx),
+                      _mm512_mul_pd(load8(y + j), vqy)),
+        _mm512_mul_pd(load8(z + j), vqz));
+    sincos8(p, s, c);
+    _mm512_storeu_pd(re + j, c);
+    _mm512_storeu_pd(im + j, s);
+  }
+  phase_factors_scalar(x + j, y + j, z + j, N - j, qx, qy, qz, re + j, im + j);
+}
+
+__attribute__((target("avx512f"))) void phase_advance_avx512(
+    double* re, double* im, const double* step_re, const double* step_im,
+    const double* factors, size_t N, double& Ar, double& Ai) {
+  __m512d ar = _mm512_setzero_pd();
+  __m512d ai = _mm512_setzero_pd();
+
+  size_t j = 0;
+  for (; j + 8 <= N; j += 8) {
+    __m512d a = _mm512_loadu_pd(re + j);
+    __m512d b = _mm512_loadu_pd(im + j);
+    __m512d c = _mm512_loadu_pd(step_re + j);
+    __m512d d = _mm512_loadu_pd(step_im + j);
+    __m512d r = _mm512_fmsub_pd(a, c, _mm512_mul_pd(b, d));
+    __m512d i = _mm512_fmadd_pd(a, d, _mm512_mul_pd(b, c));
+    _mm512_storeu_pd(re + j, r);
+    _mm512_storeu_pd(im + j, i);
+    __m512d f = _mm512_loadu_pd(factors + j);
+    ar = _mm512_fmadd_pd(f, r, ar);
+    ai = _mm512_fmadd_pd(f, i, ai);
+  }
+
+  double Rr, Ri;
+  phase_advance_scalar(re + j, im + j, step_re + j, step_im + j, factors + j,
+                       N - j, Rr, Ri);
+  Ar = reduce8(ar) + Rr;
+  Ai = reduce8(ai) + Ri;
+}
+
+#endif
+}
+
+SimdLevel simd_detect() {
+#ifdef SMATH_SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return SIMD_AVX2;
+#endif
+  return SIMD_SCALAR;
+}
+
+std::string simd_name(SimdLevel level) {
+  switch (level) {
+    case SIMD_AVX512:
+      return "avx512";
+    case SIMD_AVX2:
+      return "avx2";
+    default:
+      return "scalar";
+  }
+}
+
+std::string precision_name(Precision precision) {
+  switch (precision) {
+    case PRECISION_MIXED:
+      return "mixed";
+    default:
+      return "double";
+  }
+}
+
+namespace {
+
+template <size_t T>
+void phase_tile(SimdLevel level, Precision precision, const coor_t* x,
+                const coor_t* y, const coor_t* z, const double* factors,
+                size_t N, const double* qx, const double* qy, const double* qz,
+                double* Ar, double* Ai) {
+  if (precision == PRECISION_MIXED) {
+#ifdef SMATH_SIMD_X86
+    if (level == SIMD_AVX512) {
+      phase_tile_avx512_mixed<T>(x, y, z, factors, N, qx, qy, qz, Ar, Ai);
+      return;
+    }
+    if (level == SIMD_AVX2) {
+      phase_tile_avx2_mixed<T>(x, y, z, factors, N, qx, qy, qz, Ar, Ai);
+      return;
+    }
+#endif
+    phase_tile_scalar<T, float>(x, y, z, factors, N, qx, qy, qz, Ar, Ai);
+    return;
+  }
+#ifdef SMATH_SIMD_X86
+  if (level == SIMD_AVX512) {
+    phase_tile_avx512<T>(x, y, z, factors, N, qx, qy, qz, Ar, Ai);
+    return;
+  }
+  if (level == SIMD_AVX2) {
+    phase_tile_avx2<T>(x, y, z, factors, N, qx, qy, qz, Ar, Ai);
+    return;
+  }
+#endif
+  phase_tile_scalar<T, double>(x, y, z, factors, N, qx, qy, qz, Ar, Ai);
+}
+
+template <size_t T>
+void correlate_tile(SimdLevel level, const double* re, const double* im,
+                    size_t N, size_t k0, size_t k1, size_t tau0, double* c) {
+#ifdef SMATH_SIMD_X86
+  if (level == SIMD_AVX512) {
+    correlate_tile_avx512<T>(re, im, N, k0, k1, tau0, c);
+    return;
+  }
+  if (level == SIMD_AVX2) {
+    correlate_tile_avx2<T>(re, im, N, k0, k1, tau0, c);
+    return;
+  }
+#endif
+  correlate_tile_scalar<T>(re, im, N, k0, k1, tau0, c);
+}
+}
+
+void phase_sum(SimdLevel level, Precision precision, const coor_t* x,
+               const coor_t* y, const coor_t* z, const double* factors,
+               size_t N, double qx, double qy, double qz, double& Ar,
+               double& Ai) {
+  phase_tile<1>(level, precision, x, y, z, factors, N, &qx, &qy, &qz, &Ar,
+                &Ai);
+}
+
+void phase_sum_block(SimdLevel level, Precision precision, const coor_t* x,
+                     const coor_t* y, const coor_t* z, const double* factors,
+                     size_t N, const double* qx, const double* qy,
+                     const double* qz, size_t K, double* Ar, double* Ai) {
+  size_t k = 0;
+  for (; k + QTILE <= K; k += QTILE) {
+    phase_tile<QTILE>(level, precision, x, y, z, factors, N, qx + k, qy + k,
+                      qz + k, Ar + k, Ai + k);
+  }
+  switch (K - k) {
+    case 3:
+      phase_tile<3>(level, precision, x, y, z, factors, N, qx + k, qy + k,
+                    qz + k, Ar + k, Ai + k);
+      break;
+    case 2:
+      phase_tile<2>(level, precision, x, y, z, factors, N, qx + k, qy + k,
+                    qz + k, Ar + k, Ai + k);
+      break;
+    case 1:
+      phase_tile<1>(level, precision, x, y, z, factors, N, qx + k, qy + k,
+                    qz + k, Ar + k, Ai + k);
+      break;
+    default:
+      break;
+  }
+}
+
+void phase_factors(SimdLevel level, const coor_t* x, const coor_t* y,
+                   const coor_t* z, size_t N, double qx, double qy, double qz,
+                   double* re, double* im) {
+#ifdef SMATH_SIMD_X86
+  if (level == SIMD_AVX512) {
+    phase_factors_avx512(x, y, z, N, qx, qy, qz, re, im);
+    return;
+  }
+  if (level == SIMD_AVX2) {
+    phase_factors_avx2(x, y, z, N, qx, qy, qz, re, im);
+    return;
+  }
+#endif
+  phase_factors_scalar(x, y, z, N, qx, qy, qz, re, im);
+}
+
+void phase_advance(SimdLevel level, double* re, double* im,
+                   const double* step_re, const double* step_im,
+                   const double* factors, size_t N, double& Ar, double& Ai) {
+#ifdef SMATH_SIMD_X86
+  if (level == SIMD_AVX512) {
+    phase_advance_avx512(re, im, step_re, step_im, factors, N, Ar, Ai);
+    return;
+  }
+  if (level == SIMD_AVX2) {
+    phase_advance_avx2(re, im, step_re, step_im, factors, N, Ar, Ai);
+    return;
+  }
+#endif
+  phase_advance_scalar(re, im, step_re, step_im, factors, N, Ar, Ai);
+}
+
+void correlate_direct(SimdLevel level, const double* re, const double* im,
+                      size_t N, size_t L, double* c) {
+  memset(c, 0, 2 * L * sizeof(double));
+
+  for (size_t k0 = 0; k0 < N; k0 += CBLOCK) {
+    size_t k1 = std::min(k0 + CBLOCK, N);
+    size_t tau = 0;
+    // lags beyond N - k0 have no partners in this block
+    for (; (tau + LTILE <= L) && (tau < N - k0); tau += LTILE) {
+      correlate_tile<LTILE>(level, re, im, N, k0, k1, tau, c);
+    }
+    if (tau >= N - k0) continue;
+    switch (L - tau) {
+      case 3:
+        correlate_tile<3>(level, re, im, N, k0, k1, tau, c);
+        break;
+      case 2:
+        correlate_tile<2>(level, re, im, N, k0, k1, tau, c);
+        break;
+      case 1:
+        correlate_tile<1>(level, re, im, N, k0, k1, tau, c);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+double debye_sum(SimdLevel level, const coor_t* x, const coor_t* y,
+                 const coor_t* z, const double* factors, double q, size_t i0,
+                 size_t i1, size_t j0, size_t j1) {
+  double s = 0;
+  for (size_t jb = j0; jb < j1; jb += DBLOCK) {
+    size_t je = std::min(jb + DBLOCK, j1);
+#ifdef SMATH_SIMD_X86
+    if (level == SIMD_AVX512) {
+      s += debye_tile_avx512(x, y, z, factors, q, i0, i1, jb, je);
+      continue;
+    }
+    if (level == SIMD_AVX2) {
+      s += debye_tile_avx2(x, y, z, factors, q, i0, i1, jb, je);
+      continue;
+    }
+#endif
+    s += debye_tile_scalar(x, y, z, factors, q, i0, i1, jb, je);
+  }
+  return s;
+}
+
+void phase_reduce(const double* re, const double* im, const double* factors,
+                  size_t N, double& Ar, double& Ai) {
+  double sr = 0;
+  double si = 0;
+  for (size_t j = 0; j < N; ++j) {
+    sr += factors[j] * re[j];
+    si += factors[j] * im[j];
+  }
+  Ar = sr;
+  Ai = si;
+}
+}
+
+// end of file
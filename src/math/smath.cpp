@@ -45,10 +45,16 @@ void auto_correlate_direct(std::vector<std::complex<T> >& data) {
 }
 
 void auto_correlate_direct(fftw_complex* data, size_t N) {
-  size_t NF = N;
-
   fftw_complex* data_local =
       (fftw_complex*)fftw_malloc(N * sizeof(fftw_complex));
+  auto_correlate_direct(data, N, data_local);
+  fftw_free(data_local);
+}
+
+void auto_correlate_direct(fftw_complex* data, size_t N, fftw_complex* wspace) {
+  size_t NF = N;
+
+  fftw_complex* data_local = wspace;
   memcpy(data_local, data, N * sizeof(fftw_complex));
 
   // direct
@@ -65,8 +71,27 @@ void auto_correlate_direct(fftw_complex* data, size_t N) {
     data[tau][0] /= (last_starting_frame);
     data[tau][1] /= (last_starting_frame);
   }
+}
 
-  fftw_free(data_local);
+void auto_correlate_direct(fftw_complex* data, size_t N, fftw_complex* wspace,
+                           size_t L, SimdLevel level) {
+  if ((L == 0) || (L > N)) L = N;
+
+  // separate planes of the real and imaginary parts allow for vectorization
+  double* re = (double*)wspace;
+  double* im = re + N;
+  for (size_t k = 0; k < N; ++k) {
+    re[k] = data[k][0];
+    im[k] = data[k][1];
+  }
+
+  correlate_direct(level, re, im, N, L, (double*)data);
+
+  for (size_t tau = 0; tau < L; ++tau) {
+    data[tau][0] /= (N - tau);
+    data[tau][1] /= (N - tau);
+  }
+  memset(&data[L], 0, (N - L) * sizeof(fftw_complex));
 }
 
 void auto_correlate_fftw(std::vector<std::complex<double> >& data, size_t N,
@@ -149,6 +174,43 @@ void auto_correlate_fftw(fftw_complex* data, fftw_plan p1, fftw_plan p2,
   }
 }
 
+void auto_correlate_fftw_r2c(fftw_complex* data, fftw_plan p1, fftw_plan p2,
+                             size_t NF, size_t howmany) {
+  power_spectrum_fftw(data, p1, NF, howmany);
+  auto_correlate_power(data, p2, NF, howmany);
+}
+
+void power_spectrum_fftw(fftw_complex* data, fftw_plan p1, size_t NF,
+                         size_t howmany) {
+  fftw_execute_dft(p1, data, data);
+
+  // pack the power spectrum of every signal into the first 2*NF reals of its
+  // buffer, element i is read before any write reaches it
+  for (size_t k = 0; k < howmany; ++k) {
+    fftw_complex* signal = &(data[k * 2 * NF]);
+    double* power = (double*)signal;
+    for (size_t i = 0; i < 2 * NF; ++i) {
+      power[i] = signal[i][0] * signal[i][0] + signal[i][1] * signal[i][1];
+    }
+  }
+}
+
+void auto_correlate_power(fftw_complex* data, fftw_plan p2, size_t NF,
+                          size_t howmany) {
+  fftw_execute_dft_r2c(p2, (double*)data, data);
+
+  // the backward transform of a real spectrum is the complex conjugate of its
+  // forward transform
+  for (size_t k = 0; k < howmany; ++k) {
+    fftw_complex* signal = &(data[k * 2 * NF]);
+    for (size_t i = 0; i < NF; ++i) {
+      double factor = (1.0 / (2 * NF * (NF - i)));
+      signal[i][0] *= factor;
+      signal[i][1] *= -factor;
+    }
+  }
+}
+
 template <class T>
 void square_elements(std::vector<std::complex<T> >& data) {
   size_t NF = data.size();
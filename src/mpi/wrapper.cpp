@@ -8,6 +8,10 @@ the network.
 */
 
 // direct header
+#include "mpi/wrapper.hpp"
+
+#include <algorithm>
+#include <climits>
 #include <sstream>
 
 #include <boost/archive/binary_iarchive.hpp>
@@ -60,6 +64,94 @@ void broadcast_class(boost::mpi::communicator& comm, T& any, size_t root) {
     ar >> any;
   }
 }
+
+MPI_Request iall_to_all(boost::mpi::communicator& comm, double* in, size_t n,
+                        double* out) {
+  MPI_Request request;
+  BOOST_MPI_CHECK_RESULT(MPI_Ialltoall,
+                         (in, static_cast<int>(n), MPI_DOUBLE, out,
+                          static_cast<int>(n), MPI_DOUBLE, MPI_Comm(comm),
+                          &request));
+  return request;
+}
+
+void all_gather_in_place(boost::mpi::communicator& comm, double* data,
+                         const std::vector<size_t>& counts) {
+  std::vector<int> sizes(counts.size());
+  std::vector<int> offsets(counts.size());
+  size_t offset = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    sizes[i] = static_cast<int>(counts[i]);
+    offsets[i] = static_cast<int>(offset);
+    offset += counts[i];
+  }
+  BOOST_MPI_CHECK_RESULT(MPI_Allgatherv,
+                         (MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, data,
+                          &(sizes[0]), &(offsets[0]), MPI_DOUBLE,
+                          MPI_Comm(comm)));
+}
+
+void iall_to_all_blocks(boost::mpi::communicator& comm, coor_t* in,
+                        const std::vector<size_t>& offsets, size_t n,
+                        size_t blocksize, coor_t* out,
+                        BlockExchange& exchange) {
+  MPI_Datatype block;
+  BOOST_MPI_CHECK_RESULT(
+      MPI_Type_contiguous,
+      (static_cast<int>(blocksize), boost::mpi::get_mpi_datatype<coor_t>(),
+       &block));
+  BOOST_MPI_CHECK_RESULT(MPI_Type_commit, (&block));
+
+  exchange.counts.assign(comm.size(), static_cast<int>(n));
+  exchange.sendoffsets.resize(comm.size());
+  exchange.recvoffsets.resize(comm.size());
+  for (int i = 0; i < comm.size(); ++i) {
+    exchange.sendoffsets[i] = static_cast<int>(offsets[i]);
+    exchange.recvoffsets[i] = static_cast<int>(i * n);
+  }
+
+  BOOST_MPI_CHECK_RESULT(
+      MPI_Ialltoallv,
+      (in, &(exchange.counts[0]), &(exchange.sendoffsets[0]), block, out,
+       &(exchange.counts[0]), &(exchange.recvoffsets[0]), block,
+       MPI_Comm(comm), &(exchange.request)));
+  // a datatype may be released while it is in use by a pending exchange
+  BOOST_MPI_CHECK_RESULT(MPI_Type_free, (&block));
+}
+
+void broadcast_chunked(boost::mpi::communicator& comm, coor_t* data, size_t n,
+                       size_t chunksize, int root) {
+  // number of chunks in flight
+  const size_t depth = 4;
+  chunksize = std::max<size_t>(1, std::min<size_t>(chunksize, INT_MAX));
+  size_t NC = (n + chunksize - 1) / chunksize;
+
+  std::vector<MPI_Request> requests(std::min(depth, NC));
+  for (size_t c = 0; c < NC; ++c) {
+    MPI_Request& request = requests[c % depth];
+    if (c >= depth) wait(request);
+    size_t first = c * chunksize;
+    int count = static_cast<int>(std::min(chunksize, n - first));
+    BOOST_MPI_CHECK_RESULT(
+        MPI_Ibcast,
+        (data + first, count, boost::mpi::get_mpi_datatype<coor_t>(), root,
+         MPI_Comm(comm), &request));
+  }
+  if (!requests.empty()) {
+    BOOST_MPI_CHECK_RESULT(MPI_Waitall, (static_cast<int>(requests.size()),
+                                         &(requests[0]), MPI_STATUSES_IGNORE));
+  }
+}
+
+void wait(MPI_Request& request) {
+  BOOST_MPI_CHECK_RESULT(MPI_Wait, (&request, MPI_STATUS_IGNORE));
+}
+
+bool test(MPI_Request& request) {
+  int flag = 0;
+  BOOST_MPI_CHECK_RESULT(MPI_Test, (&request, &flag, MPI_STATUS_IGNORE));
+  return flag != 0;
+}
 }
 }
 
@@ -61,6 +61,8 @@ void Timer::stop(std::string tk) {
     Info::Inst()->write(string("Stopping timer for <") + tk + string(">"));
 }
 
+void Timer::record(std::string tk, double value) { times[tk](value); }
+
 void Timer::clear() {
   times.clear();
   starttimes.clear();
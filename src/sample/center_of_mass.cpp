@@ -9,6 +9,9 @@ This file contains a class which defines represents a center of mass calculation
 // direct header
 #include "sample/center_of_mass.hpp"
 
+// standard header
+#include <algorithm>
+
 // other headers
 #include "../vendor/boost/numeric/bindings/traits/ublas_matrix.hpp"
 #include "../vendor/boost/numeric/bindings/lapack/gesvd.hpp"
@@ -131,26 +134,33 @@ Fit::Fit(
     }
     
     // now the coordinates are in the local copy, we need  to map them back into the original coordinate set.
-    size_t csel_total = cs_selection_manip.size();
-    size_t ssel_total = ref_selection.size();
-    size_t csel_iter = 0; // iterates target coordinate set
-    size_t ssel_iter = 0; // iterates local copy
+    // atoms are located by their position within the selections, the
+    // coordinate set need not cover the whole system
+    IAtomselection& cs_selection = *pcs_selection;
+    size_t cs_total = cs_selection.size();
+    size_t manip_total = cs_selection_manip.size();
+    size_t ref_total = ref_selection.size();
+    size_t cs_iter = 0; // iterates target coordinate set
+    size_t manip_iter = 0; // iterates atoms to move
+    size_t ref_iter = 0; // iterates local copy
 
-    while( ( csel_iter < csel_total) && (ssel_iter < ssel_total) ) {
-        size_t csel_index = cs_selection_manip[csel_iter];
-        size_t ssel_index = ref_selection[ssel_iter];
+    while( ( cs_iter < cs_total) && (manip_iter < manip_total) && (ref_iter < ref_total) ) {
+        size_t cs_index = cs_selection[cs_iter];
+        size_t manip_index = cs_selection_manip[manip_iter];
+        size_t ref_index = ref_selection[ref_iter];
 
-        if (csel_index==ssel_index) {
-            cs.c1[csel_index]=cs_redcopy.c1[ssel_index];
-            cs.c2[csel_index]=cs_redcopy.c2[ssel_index];
-            cs.c3[csel_index]=cs_redcopy.c3[ssel_index];
-//            cout << "out, " << cs.c1[csel_index] << ", "  << cs.c2[csel_index] << ", "  << cs.c3[csel_index] << endl;
-            ssel_iter++;
-            csel_iter++;           
-        } else if (csel_index>ssel_index) {
-            ssel_iter++;
-        } else if (csel_index<ssel_index) {
-            csel_iter++;
+        if ((cs_index==manip_index) && (manip_index==ref_index)) {
+            cs.c1[cs_iter]=cs_redcopy.c1[ref_iter];
+            cs.c2[cs_iter]=cs_redcopy.c2[ref_iter];
+            cs.c3[cs_iter]=cs_redcopy.c3[ref_iter];
+            cs_iter++;
+            manip_iter++;
+            ref_iter++;
+        } else {
+            size_t min_index = std::min(cs_index, std::min(manip_index, ref_index));
+            if (cs_index==min_index) cs_iter++;
+            if (manip_index==min_index) manip_iter++;
+            if (ref_index==min_index) ref_iter++;
         }
     }
     //done
@@ -29,9 +29,11 @@ This file contains a class which defines a management class for coordinate sets.
 using namespace std;
 
 // has to be default constructible
-CoordinateSets::CoordinateSets() {}
+CoordinateSets::CoordinateSets()
+    : p_loadselection(NULL), m_loadselection_ready(false) {}
 
 CoordinateSets::~CoordinateSets() {
+  delete p_loadselection;
   for (size_t i = 0; i < m_motion_walkers.size(); ++i) {
     delete m_motion_walkers[i].p_reference;
     delete m_motion_walkers[i].p_mw;
@@ -257,14 +259,28 @@ CoordinateRepresentation CoordinateSets::get_representation() {
 void CoordinateSets::set_atoms(Atoms& atoms) { p_atoms = &atoms; }
 
 CoordinateSet* CoordinateSets::load(size_t framenumber) {
-  Frame frame = frames.load(framenumber);
-  CartesianCoordinateSet cset(frame, p_atoms->selections["system"]);
+  if (!m_loadselection_ready) init_loadselection();
+
+  // the coordinate set holds the atoms which are read, in the order of
+  // p_system, which replaces the system selection
+  IAtomselection* p_system = p_atoms->selections["system"];
+  Frame frame;
+  if (p_loadselection != NULL) {
+    frame = frames.load(framenumber, m_loadranges);
+    p_system = p_loadselection;
+  } else {
+    frame = frames.load(framenumber);
+    frame.number_of_atoms = frame.x.size();
+  }
+  RangeAtomselection framerange(0, frame.x.size() - 1);
+  CartesianCoordinateSet cset(
+      frame, (p_loadselection != NULL) ? &framerange : p_system);
 
-  if (frame.x.size() != p_atoms->selections["system"]->size()) {
+  if (frame.number_of_atoms != p_atoms->selections["system"]->size()) {
     Err::Inst()->write(string("Wrong number of atoms, frame:") +
                        boost::lexical_cast<string>(framenumber));
     Err::Inst()->write(string("Atoms in Frame: ") +
-                       boost::lexical_cast<string>(frame.x.size()));
+                       boost::lexical_cast<string>(frame.number_of_atoms));
     Err::Inst()->write(
         string("Atoms in Selection: ") +
         boost::lexical_cast<string>(p_atoms->selections["system"]->size()));
@@ -283,36 +299,36 @@ CoordinateSet* CoordinateSets::load(size_t framenumber) {
       p_refselection = p_atoms->selections[a.reference_selection];
     } else {
       p_reference = &cset;
-      p_refselection = p_atoms->selections["system"];
+      p_refselection = p_system;
     }
 
     if (a.type == "center") {
       CartesianCoor3D origin =
-          CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+          CenterOfMass(*p_atoms, cset, p_system,
                        p_atoms->selections[a.reference_selection]);
-      cset.translate(-1.0 * origin, p_atoms->selections["system"],
+      cset.translate(-1.0 * origin, p_system,
                      p_atoms->selections[a.selection]);
       // m_prealignmentvectors[framenumber].push_back(-1.0*origin);
     } else if (a.type == "fittrans") {
       CartesianCoor3D ref =
           CenterOfMass(*p_atoms, *p_reference, p_refselection);
       CartesianCoor3D pos =
-          CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+          CenterOfMass(*p_atoms, cset, p_system,
                        p_atoms->selections[a.selection]);
-      cset.translate(ref - pos, p_atoms->selections["system"],
+      cset.translate(ref - pos, p_system,
                      p_atoms->selections[a.selection]);
     } else if (a.type == "fitrottrans") {
-      Fit(*p_atoms, cset, p_atoms->selections["system"],
+      Fit(*p_atoms, cset, p_system,
           p_atoms->selections[a.selection], *p_reference, p_refselection);
     } else if (a.type == "fitrot") {
       CartesianCoor3D pos =
-          CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+          CenterOfMass(*p_atoms, cset, p_system,
                        p_atoms->selections[a.selection]);
-      Fit(*p_atoms, cset, p_atoms->selections["system"],
+      Fit(*p_atoms, cset, p_system,
           p_atoms->selections[a.selection], *p_reference, p_refselection);
       // fit moves the center of mass, for rotational alignment only we have to
       // correct the center of mass
-      cset.translate(pos, p_atoms->selections["system"],
+      cset.translate(pos, p_system,
                      p_atoms->selections[a.selection]);
     } else {
       Err::Inst()->write(string("Fitting routine not understood: ") + a.type);
@@ -331,20 +347,20 @@ CoordinateSet* CoordinateSets::load(size_t framenumber) {
       ref = CenterOfMass(*p_atoms, *(mwa.p_reference),
                          p_atoms->selections[mwa.reference_selection]);
     } else {
-      ref = CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+      ref = CenterOfMass(*p_atoms, cset, p_system,
                          p_atoms->selections[mwa.reference_selection]);
     }
 
     //        CartesianCoor3D pos =
-    //        CenterOfMass(*p_atoms,cset,p_atoms->selections["system"],p_atoms->selections[mwa.selection]);
-    cset.translate(-1.0 * ref, p_atoms->selections["system"],
+    //        CenterOfMass(*p_atoms,cset,p_system,p_atoms->selections[mwa.selection]);
+    cset.translate(-1.0 * ref, p_system,
                    p_atoms->selections[mwa.selection]);
     cset.transform(mwa.p_mw->transform(framenumber),
-                   p_atoms->selections["system"],
+                   p_system,
                    p_atoms->selections[mwa.selection]);
     // fit moves the center of mass, for rotational alignment only we have to
     // correct the center of mass
-    cset.translate(ref, p_atoms->selections["system"],
+    cset.translate(ref, p_system,
                    p_atoms->selections[mwa.selection]);
   }
 
@@ -360,36 +376,36 @@ CoordinateSet* CoordinateSets::load(size_t framenumber) {
       p_refselection = p_atoms->selections[a.reference_selection];
     } else {
       p_reference = &cset;
-      p_refselection = p_atoms->selections["system"];
+      p_refselection = p_system;
     }
 
     if (a.type == "center") {
       CartesianCoor3D origin =
-          CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+          CenterOfMass(*p_atoms, cset, p_system,
                        p_atoms->selections[a.reference_selection]);
-      cset.translate(-1.0 * origin, p_atoms->selections["system"],
+      cset.translate(-1.0 * origin, p_system,
                      p_atoms->selections[a.selection]);
       // m_prealignmentvectors[framenumber].push_back(-1.0*origin);
     } else if (a.type == "fittrans") {
       CartesianCoor3D ref =
           CenterOfMass(*p_atoms, *p_reference, p_refselection);
       CartesianCoor3D pos =
-          CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+          CenterOfMass(*p_atoms, cset, p_system,
                        p_atoms->selections[a.selection]);
-      cset.translate(ref - pos, p_atoms->selections["system"],
+      cset.translate(ref - pos, p_system,
                      p_atoms->selections[a.selection]);
     } else if (a.type == "fitrottrans") {
-      Fit(*p_atoms, cset, p_atoms->selections["system"],
+      Fit(*p_atoms, cset, p_system,
           p_atoms->selections[a.selection], *p_reference, p_refselection);
     } else if (a.type == "fitrot") {
       CartesianCoor3D pos =
-          CenterOfMass(*p_atoms, cset, p_atoms->selections["system"],
+          CenterOfMass(*p_atoms, cset, p_system,
                        p_atoms->selections[a.selection]);
-      Fit(*p_atoms, cset, p_atoms->selections["system"],
+      Fit(*p_atoms, cset, p_system,
           p_atoms->selections[a.selection], *p_reference, p_refselection);
       // fit moves the center of mass, for rotational alignment only we have to
       // correct the center of mass
-      cset.translate(pos, p_atoms->selections["system"],
+      cset.translate(pos, p_system,
                      p_atoms->selections[a.selection]);
     } else {
       Err::Inst()->write(string("Fitting routine not understood: ") + a.type);
@@ -401,7 +417,7 @@ CoordinateSet* CoordinateSets::load(size_t framenumber) {
 
   // reduce the coordinate set to the target selection
   CartesianCoordinateSet* pcset_reduced = new CartesianCoordinateSet(
-      cset, p_atoms->selections["system"], p_selection);
+      cset, p_system, p_selection);
 
   // convert to the current representation
   if (m_representation == CARTESIAN) {
@@ -417,6 +433,17 @@ CoordinateSet* CoordinateSets::load(size_t framenumber) {
   }
 }
 
+bool CoordinateSets::map(size_t framenumber, const float*& x, const float*& y,
+                         const float*& z) {
+  if (!m_prealignments.empty() || !m_postalignments.empty() ||
+      !m_motion_walkers.empty() || (m_representation != CARTESIAN)) {
+    return false;
+  }
+  // a mismatch of the atoms is reported by load
+  return frames.map(framenumber, p_atoms->selections["system"]->size(), x, y,
+                    z);
+}
+
 void CoordinateSets::write_xyz(std::string filename) {
   ofstream ofile(filename.c_str());
   for (size_t i = 0; i < size(); ++i) {
@@ -434,6 +461,67 @@ void CoordinateSets::write_xyz(std::string filename) {
 
 void CoordinateSets::set_selection(IAtomselection* selection) {
   p_selection = selection;
+  m_loadselection_ready = false;
+}
+
+void CoordinateSets::init_loadselection() {
+  size_t NS = p_atoms->selections["system"]->size();
+
+  // alignments without reference fit to the current coordinates of the whole
+  // system
+  bool all = false;
+  std::vector<std::string> names;
+  std::vector<CoordinateSetAlignment> alignments(m_prealignments);
+  alignments.insert(alignments.end(), m_postalignments.begin(),
+                    m_postalignments.end());
+  for (size_t i = 0; i < alignments.size(); ++i) {
+    names.push_back(alignments[i].selection);
+    names.push_back(alignments[i].reference_selection);
+    if ((alignments[i].type != "center") &&
+        (alignments[i].p_reference == NULL)) {
+      all = true;
+    }
+  }
+  for (size_t i = 0; i < m_motion_walkers.size(); ++i) {
+    names.push_back(m_motion_walkers[i].selection);
+    names.push_back(m_motion_walkers[i].reference_selection);
+  }
+
+  std::vector<IAtomselection*> selections(1, p_selection);
+  for (size_t i = 0; i < names.size(); ++i) {
+    selections.push_back(p_atoms->selections[names[i]]);
+  }
+  std::vector<char> used(NS, 0);
+  for (size_t s = 0; s < selections.size(); ++s) {
+    IAtomselection& selection = *(selections[s]);
+    for (size_t i = 0; i < selection.size(); ++i) {
+      // let load report atoms out of bounds
+      if (selection[i] >= NS) {
+        all = true;
+        break;
+      }
+      used[selection[i]] = 1;
+    }
+  }
+
+  std::vector<size_t> ids;
+  m_loadranges.clear();
+  for (size_t i = 0; i < NS; ++i) {
+    if (!used[i]) continue;
+    if (ids.empty() || (ids.back() + 1 != i)) {
+      m_loadranges.push_back(std::make_pair(i, i + 1));
+    } else {
+      m_loadranges.back().second = i + 1;
+    }
+    ids.push_back(i);
+  }
+
+  delete p_loadselection;
+  p_loadselection = NULL;
+  if (!all && !ids.empty() && (ids.size() < NS)) {
+    p_loadselection = new IndexAtomselection(ids);
+  }
+  m_loadselection_ready = true;
 }
 
 IAtomselection& CoordinateSets::get_selection() { return *p_selection; }
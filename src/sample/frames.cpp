@@ -11,6 +11,11 @@ different trajectory types.
 #include "sample/frames.hpp"
 
 // standard header
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
 #include <fstream>
 
 // special library headers
@@ -222,6 +227,49 @@ Frame Frames::load(size_t framenumber) {
   return cf;
 }
 
+Frame Frames::load(size_t framenumber, const AtomRanges& ranges) {
+  Frameset& fs = find_frameset(framenumber);
+
+  // prepare empty frame
+  Frame cf;
+  fs.read_frame_ranges(framenumber, ranges, cf);
+
+  return cf;
+}
+
+bool Frames::map(size_t framenumber, size_t number_of_atoms, const float*& x,
+                 const float*& y, const float*& z) {
+  Frameset& fs = find_frameset(framenumber);
+  if (fs.number_of_atoms != number_of_atoms) return false;
+  return fs.map_frame(framenumber, x, y, z);
+}
+
+void Frameset::read_frame_ranges(size_t framenumber, const AtomRanges& ranges,
+                                 Frame& cf) {
+  read_frame(framenumber, cf);
+  cf.number_of_atoms = cf.x.size();
+
+  // the ranges are ordered, which allows to move the atoms in place
+  size_t n = 0;
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    if (ranges[r].second > cf.x.size()) {
+      Err::Inst()->write(
+          "Atom Index out of bounds for frame! Does the structure file match "
+          "the frames?");
+      throw;
+    }
+    for (size_t i = ranges[r].first; i < ranges[r].second; ++i) {
+      cf.x[n] = cf.x[i];
+      cf.y[n] = cf.y[i];
+      cf.z[n] = cf.z[i];
+      n++;
+    }
+  }
+  cf.x.resize(n);
+  cf.y.resize(n);
+  cf.z.resize(n);
+}
+
 void FileFrameset::trim_index(size_t first, size_t last, bool last_set,
                               size_t stride) {
   vector<std::ios::streamoff> lfo;
@@ -387,7 +435,13 @@ bool DCDFrameset::detect(const string filename) {
     return false;
 }
 
-void DCDFrameset::close() { dcdfile.close(); }
+void DCDFrameset::close() {
+  dcdfile.close();
+  if (p_map_ != NULL) {
+    munmap(p_map_, map_size_);
+    p_map_ = NULL;
+  }
+}
 
 DCDFrameset::~DCDFrameset() {
   try {
@@ -397,21 +451,93 @@ DCDFrameset::~DCDFrameset() {
   }
 }
 
-void DCDFrameset::read_frame(size_t framenumber, Frame& cf) {
+bool DCDFrameset::map_file() {
+  map_failed_ = true;
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat filestat;
+  if ((fd < 0) || (fstat(fd, &filestat) != 0)) {
+    if (fd >= 0) ::close(fd);
+    Warn::Inst()->write(string("Cannot map DCD file, reading it instead: ") +
+                        filename);
+    return false;
+  }
+  map_size_ = filestat.st_size;
+  void* p_map = mmap(NULL, map_size_, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if (p_map == MAP_FAILED) {
+    Warn::Inst()->write(string("Cannot map DCD file, reading it instead: ") +
+                        filename);
+    return false;
+  }
+  p_map_ = static_cast<char*>(p_map);
+  map_failed_ = false;
+
+  // frames are accessed in the order of the index, which is sequential unless
+  // the trajectory is strided
+  bool sequential = true;
+  for (size_t i = 1; i < frameset_index_.size(); ++i) {
+    if (frameset_index_[i] - frameset_index_[i - 1] != block_size_byte) {
+      sequential = false;
+      break;
+    }
+  }
+  madvise(p_map_, map_size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+  return true;
+}
+
+bool DCDFrameset::map_frame(size_t framenumber, const float*& x,
+                            const float*& y, const float*& z) {
   size_t internalframenumber = framenumber - frame_number_offset;
 
+  if ((p_map_ == NULL) && (map_failed_ || !map_file())) return false;
+
+  size_t frame_byte_pos = frameset_index_[internalframenumber];
+  if (frame_byte_pos + block_size_byte > map_size_) {
+    Err::Inst()->write(string("DCD file too short for frame ") +
+                       boost::lexical_cast<string>(framenumber) +
+                       string(": ") + filename);
+    throw;
+  }
+
+  const char* p_frame = p_map_ + frame_byte_pos;
+  x = reinterpret_cast<const float*>(p_frame + x_byte_offset);
+  y = reinterpret_cast<const float*>(p_frame + y_byte_offset);
+  z = reinterpret_cast<const float*>(p_frame + z_byte_offset);
+  return true;
+}
+
+void DCDFrameset::read_block(size_t internalframenumber,
+                             std::streamoff byte_offset, size_t first,
+                             size_t count, std::vector<coor2_t>& v) {
   if (!dcdfile.is_open()) {
     dcdfile.open(filename.c_str(), ios::binary);
   }
+  std::vector<float> block(count);
+  dcdfile.seekg(frameset_index_[internalframenumber] + byte_offset +
+                    std::streamoff(first * sizeof(float)),
+                ios_base::beg);
+  if (count > 0) dcdfile.read((char*)&(block[0]), count * sizeof(float));
+  if (!dcdfile.good()) {
+    Err::Inst()->write(string("Unable to read coordinates from file: ") +
+                       filename);
+    throw;
+  }
+  v.insert(v.end(), block.begin(), block.end());
+}
 
-  double unit_cell_block[6];
-
+void DCDFrameset::read_unitcell(size_t internalframenumber, Frame& cf) {
   // This reads the unit cell
   if (flag_ext_block1) {
-    dcdfile.seekg(frameset_index_[internalframenumber] + block1_byte_offset,
-                  ios_base::beg);
-    for (int i = 0; i < 6; i++) {
-      dcdfile.read((char*)&(unit_cell_block[i]), sizeof(double));
+    double unit_cell_block[6];
+    if (p_map_ != NULL) {
+      memcpy(unit_cell_block,
+             p_map_ + frameset_index_[internalframenumber] + block1_byte_offset,
+             6 * sizeof(double));
+    } else {
+      dcdfile.seekg(frameset_index_[internalframenumber] + block1_byte_offset,
+                    ios_base::beg);
+      dcdfile.read((char*)unit_cell_block, 6 * sizeof(double));
     }
     // convert dcd first block to unit cell
 
@@ -425,40 +551,50 @@ void DCDFrameset::read_frame(size_t framenumber, Frame& cf) {
     cf.unitcell.push_back(CartesianCoor3D(0, 0, 0));
     cf.unitcell.push_back(CartesianCoor3D(0, 0, 0));
   }
+}
 
-  cf.number_of_atoms = number_of_atoms;
+void DCDFrameset::read_frame(size_t framenumber, Frame& cf) {
+  AtomRanges all(1, std::make_pair(size_t(0), number_of_atoms));
+  read_frame_ranges(framenumber, all, cf);
 
-  dcdfile.seekg(frameset_index_[internalframenumber] + x_byte_offset,
-                ios_base::beg);
-  for (size_t i = 0; i < number_of_atoms; i++) {
-    float temp;
-    dcdfile.read((char*)&temp, sizeof(float));
-    cf.x.push_back(temp);
-  }
-  dcdfile.seekg(frameset_index_[internalframenumber] + y_byte_offset,
-                ios_base::beg);
-  for (size_t i = 0; i < number_of_atoms; i++) {
-    float temp;
-    dcdfile.read((char*)&temp, sizeof(float));
-    cf.y.push_back(temp);
-  }
-  dcdfile.seekg(frameset_index_[internalframenumber] + z_byte_offset,
-                ios_base::beg);
-  for (size_t i = 0; i < number_of_atoms; i++) {
-    float temp;
-    dcdfile.read((char*)&temp, sizeof(float));
-    cf.z.push_back(temp);
+  // the second extension block has an unknown feature and is skipped
+}
+
+void DCDFrameset::read_frame_ranges(size_t framenumber,
+                                    const AtomRanges& ranges, Frame& cf) {
+  size_t internalframenumber = framenumber - frame_number_offset;
+
+  // only the pages of the ranges are read from the mapping. Without a mapping
+  // every range is read by a single read per dimension.
+  const float* x = NULL;
+  const float* y = NULL;
+  const float* z = NULL;
+  bool mapped = map_frame(framenumber, x, y, z);
+  if (!mapped && !dcdfile.is_open()) {
+    dcdfile.open(filename.c_str(), ios::binary);
   }
 
-  // This block has unknown feature
-  if (flag_ext_block2) {
-    dcdfile.seekg(frameset_index_[internalframenumber] + block2_byte_offset,
-                  ios_base::beg);
-    for (size_t i = 0; i < number_of_atoms; i++) {
-      float temp;
-      dcdfile.read((char*)&temp, sizeof(float));
-      // skip it
-      // cf.block2.push_back(temp);
+  read_unitcell(internalframenumber, cf);
+
+  cf.number_of_atoms = number_of_atoms;
+
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    if (ranges[r].second > number_of_atoms) {
+      Err::Inst()->write(
+          "Atom Index out of bounds for frame! Does the structure file match "
+          "the frames?");
+      throw;
+    }
+    size_t first = ranges[r].first;
+    size_t count = ranges[r].second - ranges[r].first;
+    if (mapped) {
+      cf.x.insert(cf.x.end(), x + first, x + ranges[r].second);
+      cf.y.insert(cf.y.end(), y + first, y + ranges[r].second);
+      cf.z.insert(cf.z.end(), z + first, z + ranges[r].second);
+    } else {
+      read_block(internalframenumber, x_byte_offset, first, count, cf.x);
+      read_block(internalframenumber, y_byte_offset, first, count, cf.y);
+      read_block(internalframenumber, z_byte_offset, first, count, cf.z);
     }
   }
 }
@@ -886,6 +1022,107 @@ void TRRFrameset::read_frame(size_t framenumber, Frame& cf) {
   free(coords);
 }
 
+void TRRFrameset::read_frame_ranges(size_t framenumber,
+                                    const AtomRanges& ranges, Frame& cf) {
+  size_t internalframenumber = framenumber - frame_number_offset;
+
+  if (p_xdrfile == NULL) {
+    p_xdrfile = xdrfile_open(const_cast<char*>(filename.c_str()), "r");
+    if (p_xdrfile == NULL) {
+      Err::Inst()->write(string("Unable to open file: ") + filename);
+      throw;
+    }
+  }
+  FILE* fp = get_filepointer(p_xdrfile);
+  fseek(fp, frameset_index_[internalframenumber], SEEK_SET);
+
+  // frame header, magic number and version string followed by the byte sizes
+  // of the blocks (ir, e, box, vir, pres, top, sym, x, v, f), the number of
+  // atoms, step and nre. The precision of the floats follows from the sizes.
+  int magic = 0;
+  int versionsize = 0;
+  char version[128];
+  int header[13];
+  if ((xdrfile_read_int(&magic, 1, p_xdrfile) != 1) ||
+      (xdrfile_read_int(&versionsize, 1, p_xdrfile) != 1) ||
+      (xdrfile_read_string(version, 128, p_xdrfile) <= 0) ||
+      (xdrfile_read_int(header, 13, p_xdrfile) != 13)) {
+    Err::Inst()->write(string("Unable to read frame header from file: ") +
+                       filename);
+    throw;
+  }
+  long box_size = header[2];
+  long vir_size = header[3];
+  long pres_size = header[4];
+  long x_size = header[7];
+  size_t natoms = header[10];
+  if ((x_size == 0) || (natoms != number_of_atoms)) {
+    Err::Inst()->write(
+        string("Frame without coordinates or with a different number of "
+               "atoms in file: ") +
+        filename);
+    throw;
+  }
+  long float_size = x_size / (3 * natoms);
+  bool is_double = (float_size == sizeof(double));
+
+  // time and lambda
+  fseek(fp, 2 * float_size, SEEK_CUR);
+
+  cf.unitcell.assign(3, CartesianCoor3D(0, 0, 0));
+  if (box_size != 0) {
+    float box[9];
+    if (is_double) {
+      double boxd[9];
+      xdrfile_read_double(boxd, 9, p_xdrfile);
+      for (size_t i = 0; i < 9; ++i) box[i] = boxd[i];
+    } else {
+      xdrfile_read_float(box, 9, p_xdrfile);
+    }
+    for (size_t i = 0; i < 3; ++i) {
+      cf.unitcell[i] =
+          10.0 * CartesianCoor3D(box[3 * i], box[3 * i + 1], box[3 * i + 2]);
+    }
+  }
+  fseek(fp, vir_size + pres_size, SEEK_CUR);
+  long x_pos = ftell(fp);
+
+  // coordinates are converted to single precision, see read_trr
+  std::vector<float> coords;
+  std::vector<double> coordsd;
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    if (ranges[r].second > number_of_atoms) {
+      Err::Inst()->write(
+          "Atom Index out of bounds for frame! Does the structure file match "
+          "the frames?");
+      throw;
+    }
+    int n = 3 * (ranges[r].second - ranges[r].first);
+    coords.resize(n);
+    fseek(fp, x_pos + 3 * ranges[r].first * float_size, SEEK_SET);
+    int read = 0;
+    if (is_double) {
+      coordsd.resize(n);
+      read = xdrfile_read_double(&(coordsd[0]), n, p_xdrfile);
+      for (int i = 0; i < n; ++i) coords[i] = coordsd[i];
+    } else {
+      read = xdrfile_read_float(&(coords[0]), n, p_xdrfile);
+    }
+    if (read != n) {
+      Err::Inst()->write(string("Unable to read coordinates from file: ") +
+                         filename);
+      throw;
+    }
+    for (int i = 0; i < n; i += 3) {
+      cf.x.push_back(10.0 * coords[i]);
+      cf.y.push_back(10.0 * coords[i + 1]);
+      cf.z.push_back(10.0 * coords[i + 2]);
+    }
+  }
+
+  cf.number_of_atoms = number_of_atoms;
+}
+
 CloneFrameset::CloneFrameset(Frameset* original, size_t nof) {
   p_originalframeset = original;
   frame_number_offset = nof;
@@ -901,4 +1138,22 @@ void CloneFrameset::read_frame(size_t framenumber, Frame& cf) {
       internalframenumber + p_originalframeset->frame_number_offset, cf);
 }
 
+void CloneFrameset::read_frame_ranges(size_t framenumber,
+                                      const AtomRanges& ranges, Frame& cf) {
+  // delegate to original frameset
+  size_t internalframenumber = framenumber - frame_number_offset;
+
+  p_originalframeset->read_frame_ranges(
+      internalframenumber + p_originalframeset->frame_number_offset, ranges,
+      cf);
+}
+
+bool CloneFrameset::map_frame(size_t framenumber, const float*& x,
+                              const float*& y, const float*& z) {
+  size_t internalframenumber = framenumber - frame_number_offset;
+
+  return p_originalframeset->map_frame(
+      internalframenumber + p_originalframeset->frame_number_offset, x, y, z);
+}
+
 // end of file
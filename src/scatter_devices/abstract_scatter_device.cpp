@@ -14,6 +14,7 @@ derived.
 // standard header
 #include <complex>
 #include <fstream>
+#include <sstream>
 
 // special library headers
 #include <boost/accumulators/accumulators.hpp>
@@ -27,6 +28,8 @@ derived.
 #include "exceptions/exceptions.hpp"
 #include "log.hpp"
 #include "math/coor3d.hpp"
+#include "math/fft.hpp"
+#include "math/simd.hpp"
 #include "sample.hpp"
 #include "stager/data_stager.hpp"
 
@@ -44,7 +47,8 @@ AbstractScatterDevice::AbstractScatterDevice(
       current_vector_(0),
       atfinal_(NULL),
       afinal_(0),
-      a2final_(0) {
+      a2final_(0),
+      taskpool_(NULL) {
   p_hdf5writer_ = boost::shared_ptr<HDF5WriterClient>(
       new HDF5WriterClient(fileservice_endpoint));
   p_monitor_ = boost::shared_ptr<MonitorClient>(
@@ -67,6 +71,49 @@ AbstractScatterDevice::AbstractScatterDevice(
   Timer blank_timer;
   timer_.insert(map<boost::thread::id, Timer>::value_type(
       boost::this_thread::get_id(), blank_timer));
+
+  smath::SimdLevel available = smath::simd_detect();
+  std::string simd = Params::Inst()->limits.computation.simd;
+  if (simd == "auto") {
+    simd_ = available;
+  } else if (simd == "scalar") {
+    simd_ = smath::SIMD_SCALAR;
+  } else if (simd == "avx2") {
+    simd_ = smath::SIMD_AVX2;
+  } else if (simd == "avx512") {
+    simd_ = smath::SIMD_AVX512;
+  } else {
+    Err::Inst()->write(string("limits.computation.simd not understood: ") +
+                       simd);
+    Err::Inst()->write("limits.computation.simd == auto, scalar, avx2, avx512");
+    throw;
+  }
+  if (simd_ > available) {
+    if (allcomm_.rank() == 0) {
+      Warn::Inst()->write(string("Instruction set not supported by CPU: ") +
+                          smath::simd_name(simd_));
+      Warn::Inst()->write(string("Setting limits.computation.simd=") +
+                          smath::simd_name(available));
+    }
+    simd_ = available;
+  }
+  if (allcomm_.rank() == 0) {
+    Info::Inst()->write(string("Using vectorized kernels: ") +
+                        smath::simd_name(simd_));
+  }
+
+  if (Params::Inst()->limits.computation.precision == "mixed") {
+    precision_ = smath::PRECISION_MIXED;
+  } else {
+    precision_ = smath::PRECISION_DOUBLE;
+  }
+  if (allcomm_.rank() == 0) {
+    Info::Inst()->write(string("Using compute precision: ") +
+                        smath::precision_name(precision_));
+  }
+
+  // derived devices create their plans in their constructors
+  init_fft();
 }
 
 AbstractScatterDevice::~AbstractScatterDevice() {
@@ -108,6 +155,59 @@ bool AbstractScatterDevice::ram_check() {
   return state;
 }
 
+void AbstractScatterDevice::init_fft() {
+  LimitsComputationFftParameters& fft = Params::Inst()->limits.computation.fft;
+
+  size_t threads =
+      smath::FFTPlanner::Inst()->configure(fft.planner, fft.threads);
+  if (threads != fft.threads) {
+    if (allcomm_.rank() == 0) {
+      Warn::Inst()->write("FFTW was built without thread support.");
+      Warn::Inst()->write(string("Setting limits.computation.fft.threads=") +
+                          boost::lexical_cast<string>(threads));
+    }
+    fft.threads = threads;
+  }
+
+  if (fft.wisdom == "") return;
+
+  // the root reads the wisdom and shares it with all processes
+  string wisdom;
+  if (allcomm_.rank() == 0) {
+    ifstream ifs(fft.wisdom.c_str());
+    if (ifs.good()) {
+      stringstream ss;
+      ss << ifs.rdbuf();
+      wisdom = ss.str();
+    }
+  }
+  boost::mpi::broadcast(allcomm_, wisdom, 0);
+  if (wisdom == "") return;
+
+  bool imported = smath::FFTPlanner::Inst()->import_wisdom(wisdom);
+  if (allcomm_.rank() == 0) {
+    if (imported) {
+      Info::Inst()->write(string("Imported FFTW wisdom from ") + fft.wisdom);
+    } else {
+      Warn::Inst()->write(string("Could not import FFTW wisdom from ") +
+                          fft.wisdom);
+    }
+  }
+}
+
+void AbstractScatterDevice::save_fft_wisdom() {
+  LimitsComputationFftParameters& fft = Params::Inst()->limits.computation.fft;
+  if ((fft.wisdom == "") || (allcomm_.rank() != 0)) return;
+
+  ofstream ofs(fft.wisdom.c_str());
+  if (!ofs.good()) {
+    Warn::Inst()->write(string("Could not write FFTW wisdom to ") +
+                        fft.wisdom);
+    return;
+  }
+  ofs << smath::FFTPlanner::Inst()->export_wisdom();
+}
+
 void AbstractScatterDevice::run() {
   Timer& timer = timer_[boost::this_thread::get_id()];
 
@@ -123,7 +223,9 @@ void AbstractScatterDevice::run() {
   timer.start("sd:stage");
   stage_data();
   timer.stop("sd:stage");
-  allcomm_.barrier();
+  // a partition starts computing as soon as all of its nodes hold their data,
+  // instead of waiting for the slowest broadcast to the other partitions
+  partitioncomm_.barrier();
   print_post_stage_info();
 
   if (allcomm_.rank() == 0) {
@@ -144,13 +246,17 @@ void AbstractScatterDevice::run() {
   memset(atfinal_, 0, NF * sizeof(fftw_complex));
 
   print_pre_runner_info();
-  allcomm_.barrier();
+  partitioncomm_.barrier();
   timer.start("sd:runner");
   runner();
   timer.stop("sd:runner");
   allcomm_.barrier();
   print_post_runner_info();
 
+  // devices may create plans while computing, hence the wisdom is exported
+  // once all of them exist
+  save_fft_wisdom();
+
   // notify the services to finalize
   p_monitor_->update(allcomm_.rank(), 1.0);
   p_hdf5writer_->flush();
@@ -160,6 +266,7 @@ void AbstractScatterDevice::runner() {
   Timer& timer = timer_[boost::this_thread::get_id()];
 
   start_workers();
+  reserve_scratch();
 
   size_t samplingfactor = Params::Inst()->limits.services.monitor.sampling;
   if (samplingfactor == 0) {
@@ -178,6 +285,7 @@ void AbstractScatterDevice::runner() {
     timer.start("sd:compute");
     compute();
     timer.stop("sd:compute");
+    timer.record("sd:compute:allocated_bytes", take_allocated());
 
     timer.start("sd:write");
     write();
@@ -214,28 +322,37 @@ void AbstractScatterDevice::start_workers() {
     numthreads = partitioncomm_.size();
   }
 
-  workerbarrier = new boost::barrier(numthreads + 1);
+  taskpool_ = new TaskPool(numthreads);
 
   Timer blank_timer;
-  for (size_t i = 0; i < numthreads; ++i) {
-    boost::thread* p_t =
-        new boost::thread(boost::bind(&AbstractScatterDevice::worker, this));
-    worker_threads.push(p_t);
+  std::vector<boost::thread::id> ids = taskpool_->get_ids();
+  for (size_t i = 0; i < ids.size(); ++i) {
     timer_.insert(
-        map<boost::thread::id, Timer>::value_type(p_t->get_id(), blank_timer));
+        map<boost::thread::id, Timer>::value_type(ids[i], blank_timer));
   }
-
-  workerbarrier->wait();
 }
 
 void AbstractScatterDevice::stop_workers() {
-  while (worker_threads.size() > 0) {
-    boost::thread* p_thread = worker_threads.front();
-    worker_threads.pop();
-    p_thread->interrupt();
-    delete p_thread;
+  delete taskpool_;
+  taskpool_ = NULL;
+}
+
+void AbstractScatterDevice::reserve_scratch() {
+  // one buffer per running task and one staged by the main thread
+  scratch_.reserve(2 * NF, taskpool_->size() + 1);
+}
+
+size_t AbstractScatterDevice::take_allocated() {
+  return scratch_.take_allocated();
+}
+
+void AbstractScatterDevice::wait_for_tasks() {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:c:wait_for_tasks");
+  while (!taskpool_->timed_wait(boost::posix_time::milliseconds(100))) {
+    p_monitor_->update(allcomm_.rank(), progress());
   }
-  delete workerbarrier;
+  timer.stop("sd:c:wait_for_tasks");
 }
 
 void AbstractScatterDevice::next() {
@@ -269,4 +386,166 @@ std::map<boost::thread::id, Timer>& AbstractScatterDevice::getTimer() {
   return timer_;
 }
 
+TaskPool::TaskPool(size_t numthreads)
+    : queued_(0), pending_(0), next_(0), stop_(false) {
+  for (size_t i = 0; i < numthreads; ++i) {
+    deques_.push_back(new TaskDeque());
+  }
+  for (size_t i = 0; i < numthreads; ++i) {
+    threads_.push_back(
+        new boost::thread(boost::bind(&TaskPool::run, this, i)));
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  work_available_.notify_all();
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    threads_[i]->join();
+    delete threads_[i];
+  }
+  for (size_t i = 0; i < deques_.size(); ++i) {
+    delete deques_[i];
+  }
+}
+
+std::vector<boost::thread::id> TaskPool::get_ids() const {
+  std::vector<boost::thread::id> ids;
+  for (size_t i = 0; i < threads_.size(); ++i) {
+    ids.push_back(threads_[i]->get_id());
+  }
+  return ids;
+}
+
+void TaskPool::submit(const Task& task) {
+  size_t id;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    queued_++;
+    pending_++;
+    id = next_;
+    next_ = (next_ + 1) % deques_.size();
+  }
+  {
+    boost::mutex::scoped_lock lock(deques_[id]->mutex);
+    deques_[id]->tasks.push_back(task);
+  }
+  work_available_.notify_one();
+}
+
+void TaskPool::wait() {
+  boost::mutex::scoped_lock lock(mutex_);
+  while (pending_ > 0) {
+    all_done_.wait(lock);
+  }
+}
+
+bool TaskPool::timed_wait(const boost::posix_time::time_duration& duration) {
+  boost::mutex::scoped_lock lock(mutex_);
+  boost::system_time timeout = boost::get_system_time() + duration;
+  while (pending_ > 0) {
+    if (!all_done_.timed_wait(lock, timeout)) return (pending_ == 0);
+  }
+  return true;
+}
+
+bool TaskPool::pop(size_t id, Task& task) {
+  bool found = false;
+  {
+    // own work is taken from the back ...
+    boost::mutex::scoped_lock lock(deques_[id]->mutex);
+    if (!deques_[id]->tasks.empty()) {
+      task = deques_[id]->tasks.back();
+      deques_[id]->tasks.pop_back();
+      found = true;
+    }
+  }
+  // ... while work of other threads is stolen from the front
+  for (size_t i = 1; !found && (i < deques_.size()); ++i) {
+    TaskDeque* victim = deques_[(id + i) % deques_.size()];
+    boost::mutex::scoped_lock lock(victim->mutex);
+    if (!victim->tasks.empty()) {
+      task = victim->tasks.front();
+      victim->tasks.pop_front();
+      found = true;
+    }
+  }
+  if (found) {
+    boost::mutex::scoped_lock lock(mutex_);
+    queued_--;
+  }
+  return found;
+}
+
+void TaskPool::run(size_t id) {
+  while (true) {
+    Task task;
+    if (pop(id, task)) {
+      task();
+      boost::mutex::scoped_lock lock(mutex_);
+      pending_--;
+      if (pending_ == 0) all_done_.notify_all();
+      continue;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    while (!stop_ && (queued_ == 0)) {
+      work_available_.wait(lock);
+    }
+    if (stop_ && (queued_ == 0)) return;
+  }
+}
+
+ScratchArena::ScratchArena() : size_(0), allocated_(0) {}
+
+ScratchArena::~ScratchArena() { clear(); }
+
+void ScratchArena::clear() {
+  for (size_t i = 0; i < buffers_.size(); ++i) fftw_free(buffers_[i]);
+  buffers_.clear();
+  free_.clear();
+}
+
+void ScratchArena::reserve(size_t size, size_t count) {
+  boost::mutex::scoped_lock lock(mutex_);
+  clear();
+  size_ = size;
+  for (size_t i = 0; i < count; ++i) {
+    fftw_complex* buffer =
+        (fftw_complex*)fftw_malloc(size_ * sizeof(fftw_complex));
+    buffers_.push_back(buffer);
+    free_.push_back(buffer);
+  }
+  allocated_ = 0;
+}
+
+fftw_complex* ScratchArena::acquire() {
+  boost::mutex::scoped_lock lock(mutex_);
+  if (free_.empty()) {
+    fftw_complex* buffer =
+        (fftw_complex*)fftw_malloc(size_ * sizeof(fftw_complex));
+    buffers_.push_back(buffer);
+    allocated_ += size_ * sizeof(fftw_complex);
+    return buffer;
+  }
+  fftw_complex* buffer = free_.back();
+  free_.pop_back();
+  return buffer;
+}
+
+void ScratchArena::release(fftw_complex* buffer) {
+  boost::mutex::scoped_lock lock(mutex_);
+  free_.push_back(buffer);
+}
+
+size_t ScratchArena::take_allocated() {
+  boost::mutex::scoped_lock lock(mutex_);
+  size_t allocated = allocated_;
+  allocated_ = 0;
+  return allocated;
+}
+
 // end of file
@@ -36,7 +36,9 @@ AbstractVectorsScatterDevice::AbstractVectorsScatterDevice(
     boost::asio::ip::tcp::endpoint monitorservice_endpoint)
     : AbstractScatterDevice(allcomm, partitioncomm, sample, vectors, NAF,
                             fileservice_endpoint, monitorservice_endpoint),
-      current_subvector_(0) {
+      current_subvector_(0),
+      phaseupdate_(PHASES_EXACT),
+      phases_age_(0) {
   NM = Params::Inst()->scattering.average.orientation.vectors.size();
   if (NM == 0) NM = 1;
   sample_.coordinate_sets.set_representation(CARTESIAN);
@@ -181,4 +183,40 @@ void AbstractVectorsScatterDevice::init_subvectors(CartesianCoor3D& q) {
   NM = subvector_index_.size();
 }
 
+void AbstractVectorsScatterDevice::init_phaseupdate() {
+  if (Params::Inst()->limits.computation.phases.method != "recurrence") {
+    phaseupdate_ = PHASES_EXACT;
+    return;
+  }
+
+  size_t reseed = Params::Inst()->limits.computation.phases.reseed;
+
+  if ((previous_subvectors_.size() != NM) || (phases_age_ >= reseed)) {
+    phaseupdate_ = PHASES_SEED;
+    phases_age_ = 0;
+    step_subvectors_.clear();
+  } else {
+    std::vector<CartesianCoor3D> step(NM);
+    for (size_t i = 0; i < NM; ++i) {
+      step[i] = subvector_index_[i] - previous_subvectors_[i];
+    }
+
+    // a linear scan keeps the step, rounding errors of the scan aside
+    bool same = (step_subvectors_.size() == NM);
+    for (size_t i = 0; same && (i < NM); ++i) {
+      double tolerance = 1e-12 * step[i].length();
+      if ((step[i] - step_subvectors_[i]).length() > tolerance) same = false;
+    }
+
+    if (same) {
+      phaseupdate_ = PHASES_ADVANCE;
+    } else {
+      phaseupdate_ = PHASES_RESTEP;
+      step_subvectors_ = step;
+    }
+    phases_age_++;
+  }
+  previous_subvectors_ = subvector_index_;
+}
+
 // end of file
@@ -24,7 +24,10 @@ scattering.
 #include "control.hpp"
 #include "log.hpp"
 #include "math/coor3d.hpp"
+#include "math/fft.hpp"
+#include "math/simd.hpp"
 #include "math/smath.hpp"
+#include "mpi/wrapper.hpp"
 #include "sample.hpp"
 #include "stager/data_stager.hpp"
 
@@ -38,12 +41,23 @@ AllVectorsScatterDevice::AllVectorsScatterDevice(
     : AbstractVectorsScatterDevice(allcomm, partitioncomm, sample, vectors, NAF,
                                    fileservice_endpoint,
                                    monitorservice_endpoint) {
-  fftw_complex* wspace = NULL;
-  fftw_planF_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_planB_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_BACKWARD, FFTW_ESTIMATE);
-  //    fftw_free(wspace);
+  fftw_planF_ = smath::FFTPlanner::Inst()->complex_plan(2 * NF, FFTW_FORWARD);
+  fftw_planR_ = smath::FFTPlanner::Inst()->real_plan(2 * NF);
+
+  vectorblock_ = Params::Inst()->limits.computation.vectorblock;
+  species_factoring_ =
+      (Params::Inst()->limits.computation.phases.factoring == "species");
+
+  // contrasts share the unweighted phase sums of the species
+  NW = 1 + Params::Inst()->scattering.contrasts.size();
+  if ((NW > 1) && !species_factoring_) {
+    if (allcomm_.rank() == 0) {
+      Info::Inst()->write(
+          "Forcing limits.computation.phases.factoring=species for "
+          "scattering.contrasts");
+    }
+    species_factoring_ = true;
+  }
 }
 
 bool AllVectorsScatterDevice::ram_check() {
@@ -54,21 +68,33 @@ bool AllVectorsScatterDevice::ram_check() {
   size_t NMAXF = zeronode_assignment.max();
   size_t NNPP = partitioncomm_.size();
   size_t NTHREADS = Params::Inst()->limits.computation.threads;
+  size_t NV = vectorblock_;
 
   size_t memscale = Params::Inst()->limits.computation.memory.scale;
   // direct calculation buffer
   size_t bytesize_signal_buffer = 0;
   size_t bytesize_exchange_buffer = 0;
   size_t bytesize_alignpad_buffer = 0;
+  size_t bytesize_phase_buffer = 0;
 
+  // cached phase factors and steps
+  if (Params::Inst()->limits.computation.phases.method == "recurrence") {
+    bytesize_phase_buffer = 2 * NM * NMAXF * 2 * NA * sizeof(double);
+  }
+
+  // scratch arenas, see reserve_scratch
   if (NNPP == 1) {
-    bytesize_signal_buffer = NF * NTHREADS * sizeof(fftw_complex);
+    bytesize_signal_buffer = NF * NTHREADS * NW * NV * sizeof(fftw_complex);
     bytesize_exchange_buffer = 0;  // no exchange
-    bytesize_alignpad_buffer = 2 * NF * sizeof(fftw_complex);
+    bytesize_alignpad_buffer = NTHREADS * 2 * NF * sizeof(fftw_complex);
   } else {
-    bytesize_signal_buffer = NMAXF * NNPP * sizeof(fftw_complex);
-    bytesize_exchange_buffer = NMAXF * NNPP * sizeof(fftw_complex);
-    bytesize_alignpad_buffer = 2 * NF * sizeof(fftw_complex);
+    // two slots for the pipelined exchange
+    bytesize_signal_buffer =
+        2 * NMAXF * NNPP * NW * NV * sizeof(fftw_complex);
+    bytesize_exchange_buffer =
+        2 * NMAXF * NNPP * NW * NV * sizeof(fftw_complex);
+    bytesize_alignpad_buffer =
+        (NTHREADS + NW * NV) * 2 * NF * sizeof(fftw_complex);
   }
 
   if (bytesize_signal_buffer >
@@ -119,6 +145,22 @@ bool AllVectorsScatterDevice::ram_check() {
     }
     state = false;
   }
+  if (bytesize_phase_buffer >
+      memscale * Params::Inst()->limits.computation.memory.phase_buffer) {
+    if (allcomm_.rank() == 0) {
+      Err::Inst()->write("limits.computation.memory.phase_buffer too small");
+      Err::Inst()->write(
+          string("limits.computation.memory.phase_buffer=") +
+          boost::lexical_cast<string>(
+              Params::Inst()->limits.computation.memory.phase_buffer));
+      Err::Inst()->write(string("limits.computation.memory.scale=") +
+                         boost::lexical_cast<string>(
+                             Params::Inst()->limits.computation.memory.scale));
+      Err::Inst()->write(string("requested: ") +
+                         boost::lexical_cast<string>(bytesize_phase_buffer));
+    }
+    state = false;
+  }
 
   if (allcomm_.rank() == 0) {
     Info::Inst()->write(
@@ -130,6 +172,9 @@ bool AllVectorsScatterDevice::ram_check() {
     Info::Inst()->write(
         string("required limits.computation.memory.alignpad_buffer=") +
         boost::lexical_cast<string>(bytesize_alignpad_buffer));
+    Info::Inst()->write(
+        string("required limits.computation.memory.phase_buffer=") +
+        boost::lexical_cast<string>(bytesize_phase_buffer));
   }
   // final buffer for reduction:
   // NF*sizeof(fftw_complex)
@@ -144,75 +189,252 @@ void AllVectorsScatterDevice::stage_data() {
   Timer& timer = timer_[boost::this_thread::get_id()];
   if (allcomm_.rank() == 0)
     Info::Inst()->write(string("Forcing stager.mode=frames"));
+  // atoms keep their order, unless they are grouped by species
+  std::vector<size_t> order(NA);
+  for (size_t j = 0; j < NA; ++j) order[j] = j;
+  if (species_factoring_) {
+    std::vector<size_t>& species = scatterfactors.get_species();
+    size_t NS = scatterfactors.get_species_count();
+    species_offsets_.assign(NS + 1, 0);
+    for (size_t j = 0; j < NA; ++j) species_offsets_[species[j] + 1]++;
+    for (size_t s = 0; s < NS; ++s) {
+      species_offsets_[s + 1] += species_offsets_[s];
+    }
+    std::vector<size_t> fill(species_offsets_.begin(),
+                             species_offsets_.end() - 1);
+    for (size_t j = 0; j < NA; ++j) order[fill[species[j]]++] = j;
+    unit_factors_.assign(NA, 1.0);
+  }
+
+  // split each frame into separate x, y and z planes, which allows the
+  // scatter kernel to process consecutive atoms with vector instructions
   DataStagerByFrame data_stager(sample_, allcomm_, partitioncomm_, timer);
-  p_coordinates = data_stager.stage();
+  p_coordinates = data_stager.stage_planes(order);
+
+  atcontrasts_.resize(NW - 1);
+  acontrasts_.resize(NW - 1);
+  a2contrasts_.resize(NW - 1);
+  for (size_t c = 0; c + 1 < NW; ++c) {
+    atcontrasts_[c] = (fftw_complex*)fftw_malloc(NF * sizeof(fftw_complex));
+    memset(atcontrasts_[c], 0, NF * sizeof(fftw_complex));
+  }
+}
+
+void AllVectorsScatterDevice::update_staged_factors() {
+  if (!species_factoring_) {
+    staged_factors_ = scatterfactors.get_all();
+    return;
+  }
+  std::vector<double>& bs = scatterfactors.get_species_factors();
+  staged_factors_.resize(NA);
+  for (size_t s = 0; s + 1 < species_offsets_.size(); ++s) {
+    for (size_t j = species_offsets_[s]; j < species_offsets_[s + 1]; ++j) {
+      staged_factors_[j] = bs[s];
+    }
+  }
+}
+
+std::vector<double>& AllVectorsScatterDevice::weights(size_t w) {
+  if (w == 0) return scatterfactors.get_species_factors();
+  return scatterfactors.get_contrast_factors(w - 1);
+}
+
+void AllVectorsScatterDevice::add_species(size_t s, size_t w, size_t NQ,
+                                          const double* Sr, const double* Si,
+                                          double* Ar, double* Ai) {
+  double b = weights(w)[s];
+  for (size_t k = 0; k < NQ; ++k) {
+    Ar[k] += b * Sr[k];
+    Ai[k] += b * Si[k];
+  }
 }
 
 AllVectorsScatterDevice::~AllVectorsScatterDevice() {
   if (p_coordinates != NULL) {
-    free(p_coordinates);
+    StagedMemory::free(p_coordinates);
     p_coordinates = NULL;
   }
-  fftw_destroy_plan(fftw_planF_);
-  fftw_destroy_plan(fftw_planB_);
+  for (size_t s = 0; s < at_.size(); ++s) {
+    fftw_free(at_[s]);
+    fftw_free(atexchange_[s]);
+  }
   if (atfinal_ != NULL) {
     fftw_free(atfinal_);
     atfinal_ = NULL;
   }
+  for (size_t c = 0; c < atcontrasts_.size(); ++c) {
+    if (atcontrasts_[c] != NULL) fftw_free(atcontrasts_[c]);
+  }
 }
 
-void AllVectorsScatterDevice::worker() {
-  workerbarrier->wait();
+void AllVectorsScatterDevice::task_scatter(size_t this_subvector,
+                                           fftw_complex* p_a, size_t stride,
+                                           size_t f0, size_t f1) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter(this_subvector, p_a, stride, f0, f1);
+  timer.stop("sd:worker:scatter");
+}
 
+void AllVectorsScatterDevice::task_dspstore(fftw_complex* at, size_t w) {
   Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:dspstore");
+  dsp(at);
+  store(at, w);
+  scratch_.release(at);
+  timer.stop("sd:worker:dspstore");
+}
 
-  while (true) {
-    size_t subvector_index;
-    timer.start("sd:worker:wait");
-    atscatter_.wait_and_pop(subvector_index);
-    timer.stop("sd:worker:wait");
+void AllVectorsScatterDevice::task_alignpad_dspstore(fftw_complex* at,
+                                                     size_t w) {
+  task_dspstore(alignpad(at, NF), w);
 
-    if (subvector_index < NM) {
-      timer.start("sd:worker:scatter");
-      scatter(subvector_index);
-      timer.stop("sd:worker:scatter");
-    }
+  if (w > 0) return;
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_subvector_++;
+}
 
-    workerbarrier->wait();
+void AllVectorsScatterDevice::task_scatter_dspstore(size_t this_subvector) {
+  size_t NQ = std::min(vectorblock_, NM - this_subvector);
+  fftw_complex* at = tiles_.acquire();
+
+  task_scatter(this_subvector, at, NF, 0, NF);
+  for (size_t w = 0; w < NW; ++w) {
+    for (size_t k = 0; k < NQ; ++k) {
+      task_dspstore(alignpad(&(at[(w * vectorblock_ + k) * NF]), NF), w);
+    }
   }
+  tiles_.release(at);
+
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_subvector_ += NQ;
 }
 
-fftw_complex* AllVectorsScatterDevice::exchange() {
+void AllVectorsScatterDevice::reserve_scratch() {
+  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
+  size_t NMAXF = zeronode_assignment.max();
   size_t NNPP = partitioncomm_.size();
+  size_t NTHREADS = taskpool_->size();
+  size_t NV = vectorblock_;
+
+  if (NNPP == 1) {
+    // every task holds a tile and one padded signal at a time
+    tiles_.reserve(NW * NV * NF, NTHREADS);
+    scratch_.reserve(2 * NF, NTHREADS);
+  } else {
+    // the main thread stages the padded signals of a tile for the tasks
+    scratch_.reserve(2 * NF, NTHREADS + NW * NV);
+
+    size_t NSLOTS = 2;
+    size_t NBLOCK = NNPP * NW * NV;
+    at_.resize(NSLOTS);
+    atexchange_.resize(NSLOTS);
+    for (size_t s = 0; s < NSLOTS; ++s) {
+      at_[s] =
+          (fftw_complex*)fftw_malloc(NMAXF * NBLOCK * sizeof(fftw_complex));
+      memset(at_[s], 0, NMAXF * NBLOCK * sizeof(fftw_complex));
+      atexchange_[s] =
+          (fftw_complex*)fftw_malloc(NMAXF * NBLOCK * sizeof(fftw_complex));
+    }
+  }
+}
+
+size_t AllVectorsScatterDevice::frame_ranges(size_t NTILES) {
+  size_t NTHREADS = taskpool_->size();
+  if (NTILES >= NTHREADS) return 1;
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
+  size_t NRANGES = (NTHREADS + NTILES - 1) / NTILES;
+  return std::max<size_t>(1, std::min(NRANGES, NMYF));
+}
+
+void AllVectorsScatterDevice::scatter_dspstore_ranges(size_t NRANGES) {
+  // there are fewer tiles than threads, hence all tiles fit into the arena.
+  // The frame ranges of all tiles are scattered first, then every signal is
+  // post-processed by its own task.
+  size_t NV = vectorblock_;
+  std::vector<fftw_complex*> tiles;
+  for (size_t i = 0; i < NM; i += NV) {
+    fftw_complex* at = tiles_.acquire();
+    tiles.push_back(at);
+    for (size_t r = 0; r < NRANGES; ++r) {
+      DivAssignment range(NRANGES, r, NF);
+      taskpool_->submit(boost::bind(&AllVectorsScatterDevice::task_scatter,
+                                    this, i, at, NF, range.offset(),
+                                    range.offset() + range.size()));
+    }
+  }
+  wait_for_tasks();
+
+  for (size_t t = 0; t < tiles.size(); ++t) {
+    size_t NQ = std::min(NV, NM - t * NV);
+    for (size_t w = 0; w < NW; ++w) {
+      for (size_t k = 0; k < NQ; ++k) {
+        taskpool_->submit(
+            boost::bind(&AllVectorsScatterDevice::task_alignpad_dspstore, this,
+                        &(tiles[t][(w * NV + k) * NF]), w));
+      }
+    }
+  }
+  wait_for_tasks();
+
+  for (size_t t = 0; t < tiles.size(); ++t) tiles_.release(tiles[t]);
+}
 
+size_t AllVectorsScatterDevice::take_allocated() {
+  return scratch_.take_allocated() + tiles_.take_allocated();
+}
+
+void AllVectorsScatterDevice::exchange_start(size_t slot) {
   DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
   size_t NMAXF = zeronode_assignment.max();
 
-  fftw_complex* atOUT =
-      (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+  size_t NV = vectorblock_;
 
-  double* pIN = (double*)at_;
-  double* pOUT = (double*)atOUT;
+  double* pIN = (double*)at_[slot];
+  double* pOUT = (double*)atexchange_[slot];
 
-  boost::mpi::all_to_all(partitioncomm_, pIN, 2 * NMAXF, pOUT);
+  // each node receives the signals of a tile of NV vectors
+  exchange_request_ = mpi::wrapper::iall_to_all(partitioncomm_, pIN,
+                                                2 * NMAXF * NW * NV, pOUT);
+}
 
-  return atOUT;
+fftw_complex* AllVectorsScatterDevice::exchange_wait(size_t slot) {
+  mpi::wrapper::wait(exchange_request_);
+  return atexchange_[slot];
 }
 
-fftw_complex* AllVectorsScatterDevice::alignpad(fftw_complex* at) {
+void AllVectorsScatterDevice::dspstore_block(size_t first, fftw_complex* at) {
+  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
+  size_t NMAXF = zeronode_assignment.max();
   size_t NNPP = partitioncomm_.size();
+  size_t NV = vectorblock_;
+
+  // node r post-processes the vectors first+r*NV ... first+(r+1)*NV-1
+  for (size_t w = 0; w < NW; ++w) {
+    for (size_t k = 0; k < NV; ++k) {
+      if ((first + partitioncomm_.rank() * NV + k) >= NM) break;
+      fftw_complex* nat =
+          alignpad(&(at[(w * NV + k) * NMAXF]), NW * NV * NMAXF);
+      taskpool_->submit(
+          boost::bind(&AllVectorsScatterDevice::task_dspstore, this, nat, w));
+    }
+  }
 
-  DivAssignment zeronode_assignment(NNPP, 0, NF);
-  size_t NMAXF = zeronode_assignment.max();
+  current_subvector_ += std::min(NNPP * NV, NM - first);
+}
 
-  fftw_complex* atOUT =
-      (fftw_complex*)fftw_malloc(2 * NF * sizeof(fftw_complex));
+fftw_complex* AllVectorsScatterDevice::alignpad(fftw_complex* at,
+                                                size_t stride) {
+  size_t NNPP = partitioncomm_.size();
+
+  fftw_complex* atOUT = scratch_.acquire();
 
   for (size_t i = 0; i < NNPP; ++i) {
     DivAssignment node_assignment(NNPP, i, NF);
     size_t offset = node_assignment.offset();
     size_t len = node_assignment.size();
-    double* pIN = (double*)&(at[i * NMAXF]);
+    double* pIN = (double*)&(at[i * stride]);
     double* pOUT = (double*)&(atOUT[offset]);
     memcpy(pOUT, pIN, len * sizeof(fftw_complex));
   }
@@ -225,9 +447,11 @@ void AllVectorsScatterDevice::dsp(fftw_complex* at) {
   // correlate or sum up
   if (Params::Inst()->scattering.dsp.type == "autocorrelate") {
     if (Params::Inst()->scattering.dsp.method == "direct") {
-      smath::auto_correlate_direct(at, NF);
+      smath::auto_correlate_direct(at, NF, &(at[NF]),
+                                   Params::Inst()->scattering.dsp.max_lag,
+                                   simd_);
     } else if (Params::Inst()->scattering.dsp.method == "fftw") {
-      smath::auto_correlate_fftw(at, fftw_planF_, fftw_planB_, NF);
+      smath::auto_correlate_fftw_r2c(at, fftw_planF_, fftw_planR_, NF);
     } else {
       Err::Inst()->write("Correlation method not understood");
       Err::Inst()->write("scattering.dsp.method == direct, fftw");
@@ -243,11 +467,62 @@ void AllVectorsScatterDevice::dsp(fftw_complex* at) {
   }
 }
 
-void AllVectorsScatterDevice::store(fftw_complex* at) {
+void AllVectorsScatterDevice::store(fftw_complex* at, size_t w) {
   complex<double> a = smath::reduce<double>(at, NF) * (1.0 / NF);
-  afinal_ += a;
-  a2final_ += a * conj(a);
-  smath::add_elements(atfinal_, at, NF);
+  boost::mutex::scoped_lock lock(store_mutex_);
+  if (w == 0) {
+    afinal_ += a;
+    a2final_ += a * conj(a);
+    smath::add_elements(atfinal_, at, NF);
+  } else {
+    acontrasts_[w - 1] += a;
+    a2contrasts_[w - 1] += a * conj(a);
+    smath::add_elements(atcontrasts_[w - 1], at, NF);
+  }
+}
+
+void AllVectorsScatterDevice::reduce(fftw_complex*& at, std::complex<double>& a,
+                                     std::complex<double>& a2) {
+  double* p_atfinal = (double*)&(at[0][0]);
+  double* p_atlocal = NULL;
+  if (partitioncomm_.rank() == 0) {
+    fftw_complex* atlocal_ =
+        (fftw_complex*)fftw_malloc(NF * sizeof(fftw_complex));
+    p_atlocal = (double*)&(atlocal_[0][0]);
+    memset(atlocal_, 0, NF * sizeof(fftw_complex));
+  }
+
+  boost::mpi::reduce(partitioncomm_, p_atfinal, 2 * NF, p_atlocal,
+                     std::plus<double>(), 0);
+  double* p_afinal = (double*)&(a);
+  std::complex<double> alocal(0);
+  double* p_alocal = (double*)&(alocal);
+  boost::mpi::reduce(partitioncomm_, p_afinal, 2, p_alocal,
+                     std::plus<double>(), 0);
+  double* p_a2final = (double*)&(a2);
+  std::complex<double> a2local(0);
+  double* p_a2local = (double*)&(a2local);
+  boost::mpi::reduce(partitioncomm_, p_a2final, 2, p_a2local,
+                     std::plus<double>(), 0);
+
+  // swap pointers on rank 0
+  if (partitioncomm_.rank() == 0) {
+    fftw_free(at);
+    at = (fftw_complex*)p_atlocal;
+    a = alocal;
+    a2 = a2local;
+  }
+}
+
+void AllVectorsScatterDevice::write() {
+  AbstractScatterDevice::write();
+  if (partitioncomm_.rank() == 0) {
+    CartesianCoor3D vector = vectors_[current_vector_];
+    for (size_t c = 0; c < atcontrasts_.size(); ++c) {
+      p_hdf5writer_->write(vector, atcontrasts_[c], NF, acontrasts_[c],
+                           a2contrasts_[c], c + 1);
+    }
+  }
 }
 
 void AllVectorsScatterDevice::compute() {
@@ -259,79 +534,117 @@ void AllVectorsScatterDevice::compute() {
   init_subvectors(q);
   scatterfactors.update(q);  // scatter factors only dependent on length of q,
                              // hence we can do it once before the loop
+  init_phaseupdate();
+  if ((precision_ != smath::PRECISION_DOUBLE) &&
+      (phaseupdate_ == PHASES_EXACT) && (current_vector_ == 0) &&
+      (allcomm_.rank() == 0)) {
+    update_staged_factors();
+    check_precision();
+  }
+  if (phaseupdate_ != PHASES_EXACT) {
+    size_t NMYF =
+        DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
+    phases_.resize(NM * NMYF * 2 * NA);
+    steps_.resize(NM * NMYF * 2 * NA);
+  }
   timer.stop("sd:c:init");
 
   DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
   size_t NMAXF = zeronode_assignment.max();
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
   size_t NNPP = partitioncomm_.size();
+  size_t NV = vectorblock_;
 
   current_subvector_ = 0;
   memset(atfinal_, 0, NF * sizeof(fftw_complex));
   afinal_ = 0;
   a2final_ = 0;
+  for (size_t c = 0; c < atcontrasts_.size(); ++c) {
+    memset(atcontrasts_[c], 0, NF * sizeof(fftw_complex));
+    acontrasts_[c] = 0;
+    a2contrasts_[c] = 0;
+  }
+
+  // with fewer tiles of vectors than threads the frames of a tile are split
+  // into ranges, which are scattered by separate tasks
+  size_t NTILES = (NM + NV - 1) / NV;
+  size_t NRANGES =
+      frame_ranges((NNPP == 1) ? NTILES : std::min(NNPP, NTILES));
+  if ((current_vector_ == 0) && (allcomm_.rank() == 0) && (NRANGES > 1)) {
+    Info::Inst()->write(string("Splitting the frames of a tile into ") +
+                        boost::lexical_cast<string>(NRANGES) +
+                        string(" ranges"));
+  }
 
   timer.start("sd:c:block");
   // special case: 1 core, no exchange required
-  if (NNPP == 1) {
-    size_t NTHREADS = worker_threads.size();
+  // every tile of vectors is scattered and post-processed independently
+  if ((NNPP == 1) && (NRANGES > 1)) {
+    scatter_dspstore_ranges(NRANGES);
+  } else if (NNPP == 1) {
+    for (size_t i = 0; i < NM; i += NV) {
+      taskpool_->submit(boost::bind(
+          &AllVectorsScatterDevice::task_scatter_dspstore, this, i));
+    }
+    wait_for_tasks();
+  } else {
+    // the exchange requires all tiles of a block. The blocks are pipelined
+    // through a ring of buffers: while block b is scattered, the exchange of
+    // block b-1 is in flight and its post-processing is submitted as soon as
+    // it arrived.
+    size_t NBLOCK = NNPP * NV;
+    size_t NSLOTS = at_.size();
+
+    bool inflight = false;
+    size_t inflight_first = 0;
+    size_t inflight_slot = 0;
+    for (size_t i = 0, b = 0; i < NM; i += NBLOCK, ++b) {
+      size_t slot = b % NSLOTS;
+
+      for (size_t t = 0; (t < NNPP) && (i + t * NV < NM); ++t) {
+        for (size_t r = 0; r < NRANGES; ++r) {
+          DivAssignment range(NRANGES, r, NMYF);
+          taskpool_->submit(boost::bind(
+              &AllVectorsScatterDevice::task_scatter, this, i + t * NV,
+              &(at_[slot][t * NW * NV * NMAXF]), NMAXF, range.offset(),
+              range.offset() + range.size()));
+        }
+      }
+
+      if (inflight) {
+        timer.start("sd:c:b:exchange");
+        fftw_complex* at = exchange_wait(inflight_slot);
+        timer.stop("sd:c:b:exchange");
 
-    at_ = (fftw_complex*)fftw_malloc(NF * NTHREADS * sizeof(fftw_complex));
-    memset(at_, 0, NF * NTHREADS * sizeof(fftw_complex));
+        timer.start("sd:c:b:dspstore");
+        dspstore_block(inflight_first, at);
+        timer.stop("sd:c:b:dspstore");
+      }
 
-    for (size_t i = 0; i < NM; i += NTHREADS) {
       timer.start("sd:c:b:scatter");
-      scatterblock(i, std::min(NTHREADS, NM - i));
+      wait_for_tasks();
       timer.stop("sd:c:b:scatter");
 
-      timer.start("sd:c:b:dspstore");
-      for (size_t j = 0; j < std::min(NTHREADS, NM - i); ++j) {
-        size_t offset = ((j + i) % NTHREADS) * NF;
-        fftw_complex* pat = &(at_[offset]);
-        fftw_complex* nat = alignpad(pat);
-        dsp(nat);
-        store(nat);
-        fftw_free(nat);
-        nat = NULL;
-      }
-      timer.stop("sd:c:b:dspstore");
+      exchange_start(slot);
+      inflight = true;
+      inflight_first = i;
+      inflight_slot = slot;
 
-      current_subvector_ += NTHREADS;
+      timer.start("sd:c:b:progress");
       p_monitor_->update(allcomm_.rank(), progress());
+      timer.stop("sd:c:b:progress");
     }
-    fftw_free(at_);
-
-  } else {
-    at_ = (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
-    memset(at_, 0, NMAXF * NNPP * sizeof(fftw_complex));
-
-    for (size_t i = 0; i < NM; i += NNPP) {
-      timer.start("sd:c:b:scatter");
-      scatterblock(i, std::min(NNPP, NM - i));
-      timer.stop("sd:c:b:scatter");
-
+    if (inflight) {
       timer.start("sd:c:b:exchange");
-      fftw_complex* at = exchange();
+      fftw_complex* at = exchange_wait(inflight_slot);
       timer.stop("sd:c:b:exchange");
 
       timer.start("sd:c:b:dspstore");
-      if (partitioncomm_.rank() < std::min(NNPP, NM - i)) {
-        fftw_complex* nat = alignpad(at);
-        fftw_free(at);
-        at = NULL;
-        dsp(nat);
-        store(nat);
-        fftw_free(nat);
-        nat = NULL;
-      }
-      if (at != NULL) fftw_free(at);
+      dspstore_block(inflight_first, at);
       timer.stop("sd:c:b:dspstore");
-
-      current_subvector_ += std::min(NNPP, NM - i);
-      timer.start("sd:c:b:progress");
-      p_monitor_->update(allcomm_.rank(), progress());
-      timer.stop("sd:c:b:progress");
     }
-    fftw_free(at_);
+    wait_for_tasks();
   }
   timer.stop("sd:c:block");
 
@@ -341,34 +654,9 @@ void AllVectorsScatterDevice::compute() {
 
   timer.start("sd:c:reduce");
   if (NNPP > 1) {
-    double* p_atfinal = (double*)&(atfinal_[0][0]);
-    double* p_atlocal = NULL;
-    if (partitioncomm_.rank() == 0) {
-      fftw_complex* atlocal_ =
-          (fftw_complex*)fftw_malloc(NF * sizeof(fftw_complex));
-      p_atlocal = (double*)&(atlocal_[0][0]);
-      memset(atlocal_, 0, NF * sizeof(fftw_complex));
-    }
-
-    boost::mpi::reduce(partitioncomm_, p_atfinal, 2 * NF, p_atlocal,
-                       std::plus<double>(), 0);
-    double* p_afinal = (double*)&(afinal_);
-    std::complex<double> alocal(0);
-    double* p_alocal = (double*)&(alocal);
-    boost::mpi::reduce(partitioncomm_, p_afinal, 2, p_alocal,
-                       std::plus<double>(), 0);
-    double* p_a2final = (double*)&(a2final_);
-    std::complex<double> a2local(0);
-    double* p_a2local = (double*)&(a2local);
-    boost::mpi::reduce(partitioncomm_, p_a2final, 2, p_a2local,
-                       std::plus<double>(), 0);
-
-    // swap pointers on rank 0
-    if (partitioncomm_.rank() == 0) {
-      fftw_free(atfinal_);
-      atfinal_ = (fftw_complex*)p_atlocal;
-      afinal_ = alocal;
-      a2final_ = a2local;
+    reduce(atfinal_, afinal_, a2final_);
+    for (size_t c = 0; c < atcontrasts_.size(); ++c) {
+      reduce(atcontrasts_[c], acontrasts_[c], a2contrasts_[c]);
     }
   }
   timer.stop("sd:c:reduce");
@@ -378,80 +666,183 @@ void AllVectorsScatterDevice::compute() {
     smath::multiply_elements(factor, atfinal_, NF);
     afinal_ *= factor;
     a2final_ *= factor;
+    for (size_t c = 0; c < atcontrasts_.size(); ++c) {
+      smath::multiply_elements(factor, atcontrasts_[c], NF);
+      acontrasts_[c] *= factor;
+      a2contrasts_[c] *= factor;
+    }
   }
 }
 
-void AllVectorsScatterDevice::scatterblock(size_t index, size_t count) {
-  size_t SCATTERBLOCK = worker_threads.size();
+void AllVectorsScatterDevice::scatter(size_t this_subvector, fftw_complex* p_a,
+                                      size_t stride, size_t f0, size_t f1) {
+  // outer loop: frames
+  // inner loop: tile of vectors
+
+  using namespace boost::numeric::ublas::detail;
+  //   cerr << "this_subvector " << this_subvector << endl;
+  //   sleep(3);
+  std::vector<double>& sfs = scatterfactors.get_all();
 
-  //    cerr << "loop w/ index=" << index << " , count=" << count << endl;
-  //    sleep(3);
-  for (size_t i = 0; i < count; ++i) {
-    atscatter_.push(index + i);
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
+  f1 = std::min(f1, NMYF);
+
+  size_t NQ = std::min(vectorblock_, NM - this_subvector);
+  std::vector<double> qx(NQ), qy(NQ), qz(NQ);
+  for (size_t k = 0; k < NQ; ++k) {
+    CartesianCoor3D q = subvector_index_[this_subvector + k];
+    qx[k] = q.x;
+    qy[k] = q.y;
+    qz[k] = q.z;
+  }
+  std::vector<double> Ar(NW * NQ), Ai(NW * NQ), Sr(NQ), Si(NQ);
 
-    if (((i + 1) % SCATTERBLOCK) == 0) {
-      workerbarrier->wait();
+  if (phaseupdate_ != PHASES_EXACT) {
+    for (size_t k = 0; k < NQ; ++k) {
+      scatter_recurrence(this_subvector + k, &(p_a[k * stride]),
+                         vectorblock_ * stride, f0, f1);
     }
+    return;
   }
 
-  if ((count % SCATTERBLOCK) != 0) {
-    size_t rest = SCATTERBLOCK - (count % SCATTERBLOCK);
-    for (size_t i = 0; i < rest; ++i) {
-      atscatter_.push(NM);  // NM will be ignored, but triggers a barrier
+  for (size_t fi = f0; fi < f1; ++fi) {
+    coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+
+    if (species_factoring_) {
+      std::fill(Ar.begin(), Ar.end(), 0.0);
+      std::fill(Ai.begin(), Ai.end(), 0.0);
+      for (size_t s = 0; s + 1 < species_offsets_.size(); ++s) {
+        size_t o = species_offsets_[s];
+        size_t n = species_offsets_[s + 1] - o;
+        smath::phase_sum_block(simd_, precision_, &(p_data[o]),
+                               &(p_data[NA + o]), &(p_data[2 * NA + o]),
+                               &(unit_factors_[o]), n, &(qx[0]), &(qy[0]),
+                               &(qz[0]), NQ, &(Sr[0]), &(Si[0]));
+        for (size_t w = 0; w < NW; ++w) {
+          add_species(s, w, NQ, &(Sr[0]), &(Si[0]), &(Ar[w * NQ]),
+                      &(Ai[w * NQ]));
+        }
+      }
+    } else {
+      smath::phase_sum_block(simd_, precision_, p_data, &(p_data[NA]),
+                             &(p_data[2 * NA]), &(sfs[0]), NA, &(qx[0]),
+                             &(qy[0]), &(qz[0]), NQ, &(Ar[0]), &(Ai[0]));
+    }
+    for (size_t w = 0; w < NW; ++w) {
+      fftw_complex* p_aw = &(p_a[w * vectorblock_ * stride]);
+      for (size_t k = 0; k < NQ; ++k) {
+        p_aw[k * stride + fi][0] = Ar[w * NQ + k];
+        p_aw[k * stride + fi][1] = Ai[w * NQ + k];
+      }
     }
-    workerbarrier->wait();
   }
 }
 
-void AllVectorsScatterDevice::scatter(size_t this_subvector) {
-  // outer loop: frames
-  // inner loop: block of moments
+void AllVectorsScatterDevice::check_precision() {
+  // compares the first tile of vectors of the first q vector against the double
+  // precision kernel for all frames of this node
+  std::vector<double>& sfs = staged_factors_;
+  double fsum = 0;
+  for (size_t j = 0; j < NA; ++j) fsum += fabs(sfs[j]);
+  if (fsum == 0) return;
 
-  using namespace boost::numeric::ublas::detail;
-  //   cerr << "this_subvector " << this_subvector << endl;
-  //   sleep(3);
-  std::vector<double>& sfs = scatterfactors.get_all();
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
 
-  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
-  size_t NMAXF = zeronode_assignment.max();
-  size_t NNPP = partitioncomm_.size();
-  size_t offset = 0;
-  if (NNPP == 1) {
-    size_t NTHREADS = worker_threads.size();
-    offset = (this_subvector % NTHREADS) * NF;
-  } else {
-    offset = (this_subvector % NNPP) * NMAXF;
+  size_t NQ = std::min(vectorblock_, NM);
+  std::vector<double> qx(NQ), qy(NQ), qz(NQ);
+  for (size_t k = 0; k < NQ; ++k) {
+    CartesianCoor3D q = subvector_index_[k];
+    qx[k] = q.x;
+    qy[k] = q.y;
+    qz[k] = q.z;
+  }
+  std::vector<double> Ar(NQ), Ai(NQ), Dr(NQ), Di(NQ);
+
+  double deviation = 0;
+  for (size_t fi = 0; fi < NMYF; ++fi) {
+    coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+    smath::phase_sum_block(simd_, precision_, p_data, &(p_data[NA]),
+                           &(p_data[2 * NA]), &(sfs[0]), NA, &(qx[0]),
+                           &(qy[0]), &(qz[0]), NQ, &(Ar[0]), &(Ai[0]));
+    smath::phase_sum_block(simd_, smath::PRECISION_DOUBLE, p_data,
+                           &(p_data[NA]), &(p_data[2 * NA]), &(sfs[0]), NA,
+                           &(qx[0]), &(qy[0]), &(qz[0]), NQ, &(Dr[0]),
+                           &(Di[0]));
+    for (size_t k = 0; k < NQ; ++k) {
+      double d = sqrt(pow(Ar[k] - Dr[k], 2) + pow(Ai[k] - Di[k], 2));
+      deviation = std::max(deviation, d / fsum);
+    }
   }
 
+  Info::Inst()->write(
+      string("Deviation of ") + smath::precision_name(precision_) +
+      string(" precision from double precision (relative to sum |f|): ") +
+      boost::lexical_cast<string>(deviation));
+}
+
+void AllVectorsScatterDevice::scatter_recurrence(size_t this_subvector,
+                                                 fftw_complex* p_a,
+                                                 size_t stride, size_t f0,
+                                                 size_t f1) {
+  std::vector<double>& sfs = scatterfactors.get_all();
+
   size_t NMYF =
       DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
-  fftw_complex* p_a = &(at_[offset]);
 
   CartesianCoor3D q = subvector_index_[this_subvector];
-  double qx = q.x;
-  double qy = q.y;
-  double qz = q.z;
-  coor_t x, y, z;
-  double esf, p;
-
-  for (size_t fi = 0; fi < NMYF; ++fi) {
-    coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+  CartesianCoor3D dq;
+  if (phaseupdate_ == PHASES_RESTEP) dq = step_subvectors_[this_subvector];
 
-    double Ar = 0;
-    double Ai = 0;
+  // the signal of weight set w starts at p_a[w*stride]
+  std::vector<double> Ar(NW), Ai(NW);
 
-    for (size_t j = 0; j < NA; ++j) {
-      esf = sfs[j];
-      x = p_data[3 * j];
-      y = p_data[3 * j + 1];
-      z = p_data[3 * j + 2];
+  for (size_t fi = f0; fi < std::min(f1, NMYF); ++fi) {
+    coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+    size_t offset = (this_subvector * NMYF + fi) * 2 * NA;
+    double* p_re = &(phases_[offset]);
+    double* p_im = &(phases_[offset + NA]);
+    double* p_sre = &(steps_[offset]);
+    double* p_sim = &(steps_[offset + NA]);
+
+    std::fill(Ar.begin(), Ar.end(), 0.0);
+    std::fill(Ai.begin(), Ai.end(), 0.0);
+    if (phaseupdate_ == PHASES_SEED) {
+      smath::phase_factors(simd_, p_data, &(p_data[NA]), &(p_data[2 * NA]),
+                           NA, q.x, q.y, q.z, p_re, p_im);
+    } else if (phaseupdate_ == PHASES_RESTEP) {
+      smath::phase_factors(simd_, p_data, &(p_data[NA]), &(p_data[2 * NA]),
+                           NA, dq.x, dq.y, dq.z, p_sre, p_sim);
+    }
 
-      p = x * qx + y * qy + z * qz;
-      Ar += esf * cos(p);
-      Ai += esf * sin(p);
+    if (species_factoring_) {
+      for (size_t s = 0; s + 1 < species_offsets_.size(); ++s) {
+        size_t o = species_offsets_[s];
+        size_t n = species_offsets_[s + 1] - o;
+        double Sr = 0;
+        double Si = 0;
+        if (phaseupdate_ == PHASES_SEED) {
+          smath::phase_reduce(&(p_re[o]), &(p_im[o]), &(unit_factors_[o]), n,
+                              Sr, Si);
+        } else {
+          smath::phase_advance(simd_, &(p_re[o]), &(p_im[o]), &(p_sre[o]),
+                               &(p_sim[o]), &(unit_factors_[o]), n, Sr, Si);
+        }
+        for (size_t w = 0; w < NW; ++w) {
+          add_species(s, w, 1, &Sr, &Si, &(Ar[w]), &(Ai[w]));
+        }
+      }
+    } else if (phaseupdate_ == PHASES_SEED) {
+      smath::phase_reduce(p_re, p_im, &(sfs[0]), NA, Ar[0], Ai[0]);
+    } else {
+      smath::phase_advance(simd_, p_re, p_im, p_sre, p_sim, &(sfs[0]), NA,
+                           Ar[0], Ai[0]);
+    }
+    for (size_t w = 0; w < NW; ++w) {
+      p_a[w * stride + fi][0] = Ar[w];
+      p_a[w * stride + fi][1] = Ai[w];
     }
-    p_a[fi][0] = Ar;
-    p_a[fi][1] = Ai;
   }
 }
 
@@ -0,0 +1,397 @@
+/** \file
+This file contains a class which implements the scattering calculation for
+exact spherical orientational averaging by the Debye pair sum ( which is all
+type scattering ).
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "scatter_devices/exact_scatter_device.hpp"
+
+// standard header
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+// special library headers
+#include <boost/lexical_cast.hpp>
+
+// other headers
+#include "control.hpp"
+#include "decomposition/assignment.hpp"
+#include "exceptions/exceptions.hpp"
+#include "log.hpp"
+#include "math/coor3d.hpp"
+#include "math/pair_histogram.hpp"
+#include "math/simd.hpp"
+#include "math/smath.hpp"
+#include "sample.hpp"
+#include "mpi/wrapper.hpp"
+#include "stager/data_stager.hpp"
+
+using namespace std;
+
+ExactSphereScatterDevice::ExactSphereScatterDevice(
+    boost::mpi::communicator allcomm, boost::mpi::communicator partitioncomm,
+    Sample& sample, std::vector<CartesianCoor3D> vectors, size_t NAF,
+    boost::asio::ip::tcp::endpoint fileservice_endpoint,
+    boost::asio::ip::tcp::endpoint monitorservice_endpoint)
+    : AbstractScatterDevice(allcomm, partitioncomm, sample, vectors, NAF,
+                            fileservice_endpoint, monitorservice_endpoint),
+      rowblock_(256),
+      current_block_(0),
+      p_coordinates(NULL),
+      NS(0),
+      NP(0),
+      NBINS(0),
+      histograms_ready_(false) {
+  sample_.coordinate_sets.set_representation(CARTESIAN);
+
+  NB = (NA + rowblock_ - 1) / rowblock_;
+}
+
+void ExactSphereScatterDevice::print_pre_stage_info() {
+  if (allcomm_.rank() == 0) {
+    Info::Inst()->write("Staging data...");
+  }
+}
+
+void ExactSphereScatterDevice::print_post_stage_info() {}
+
+void ExactSphereScatterDevice::print_pre_runner_info() {
+  if (allcomm_.rank() == 0) {
+    Info::Inst()->write("Starting computation...");
+  }
+}
+
+void ExactSphereScatterDevice::print_post_runner_info() {}
+
+double ExactSphereScatterDevice::progress() {
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
+  double scale1 = 1.0 / vectors_.size();
+  double scale2 = 1.0 / std::max<size_t>(1, NMYF * NB);
+
+  double base1 = current_vector_ * scale1;
+  double base2 = current_block_ * scale1 * scale2;
+  return base1 + base2;
+}
+
+void ExactSphereScatterDevice::reserve_scratch() {
+  // the pair sums accumulate into partials_, no signal buffers are required
+}
+
+void ExactSphereScatterDevice::stage_data() {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  if (allcomm_.rank() == 0)
+    Info::Inst()->write(string("Forcing stager.mode=frames"));
+  DataStagerByFrame data_stager(sample_, allcomm_, partitioncomm_, timer);
+
+  // split each frame into separate x, y and z planes, which allows the pair
+  // kernel to process consecutive atoms with vector instructions
+  std::vector<size_t> order(NA);
+  for (size_t j = 0; j < NA; ++j) order[j] = j;
+  p_coordinates = data_stager.stage_planes(order);
+
+  if ((Params::Inst()->scattering.average.orientation.exact.method ==
+       "histogram") &&
+      (Params::Inst()->scattering.dsp.type == "square")) {
+    init_histograms();
+  }
+}
+
+void ExactSphereScatterDevice::init_histograms() {
+  ScatteringAverageOrientationExactParameters& exact =
+      Params::Inst()->scattering.average.orientation.exact;
+
+  species_ = scatterfactors.get_species();
+  NS = scatterfactors.get_species_count();
+  NP = NS * (NS + 1) / 2;
+
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
+  if (exact.cutoff > 0) {
+    NBINS = size_t(ceil(exact.cutoff / exact.binwidth));
+  } else {
+    // no pair is further apart than the diagonal of the bounding box
+    double rmax = 0;
+    for (size_t fi = 0; fi < NMYF; ++fi) {
+      coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+      double diagonal = 0;
+      for (size_t d = 0; d < 3; ++d) {
+        coor_t* p_plane = &(p_data[d * NA]);
+        double extent = *std::max_element(p_plane, p_plane + NA) -
+                        *std::min_element(p_plane, p_plane + NA);
+        diagonal += extent * extent;
+      }
+      rmax = std::max(rmax, sqrt(diagonal));
+    }
+    rmax =
+        boost::mpi::all_reduce(allcomm_, rmax, boost::mpi::maximum<double>());
+    NBINS = size_t(rmax / exact.binwidth) + 1;
+  }
+
+  size_t memscale = Params::Inst()->limits.computation.memory.scale;
+  size_t NMAXF = DivAssignment(partitioncomm_.size(), 0, NF).max();
+  size_t bytesize_histogram_buffer = NMAXF * NP * NBINS * sizeof(double);
+  if (bytesize_histogram_buffer >
+      memscale * Params::Inst()->limits.computation.memory.signal_buffer) {
+    if (allcomm_.rank() == 0) {
+      Err::Inst()->write("limits.computation.memory.signal_buffer too small");
+      Err::Inst()->write(
+          string("limits.computation.memory.signal_buffer=") +
+          boost::lexical_cast<string>(
+              Params::Inst()->limits.computation.memory.signal_buffer));
+      Err::Inst()->write(string("limits.computation.memory.scale=") +
+                         boost::lexical_cast<string>(memscale));
+      Err::Inst()->write(
+          string("requested: ") +
+          boost::lexical_cast<string>(bytesize_histogram_buffer));
+    }
+    throw sassena::terminate_request();
+  }
+  if (allcomm_.rank() == 0) {
+    Info::Inst()->write(string("Pair histograms: species=") +
+                        boost::lexical_cast<string>(NS) + string(", bins=") +
+                        boost::lexical_cast<string>(NBINS));
+    Info::Inst()->write(
+        string("required limits.computation.memory.signal_buffer=") +
+        boost::lexical_cast<string>(bytesize_histogram_buffer));
+  }
+
+  histograms_.assign(NMYF * NP * NBINS, 0);
+  sinc_.resize(NBINS);
+  interpartitioncomm_ = allcomm_.split(partitioncomm_.rank());
+}
+
+void ExactSphereScatterDevice::build_histograms() {
+  size_t NMYF =
+      DivAssignment(partitioncomm_.size(), partitioncomm_.rank(), NF).size();
+
+  // all partitions own the same frames, each builds a share of the histograms
+  size_t NPART = interpartitioncomm_.size();
+  DivAssignment share(NPART, interpartitioncomm_.rank(), NMYF);
+  for (size_t i = 0; i < share.size(); ++i) {
+    taskpool_->submit(boost::bind(&ExactSphereScatterDevice::task_histogram,
+                                  this, share.offset() + i));
+  }
+  wait_for_tasks();
+
+  if ((NPART > 1) && (NMYF > 0)) {
+    std::vector<size_t> counts(NPART);
+    for (size_t r = 0; r < NPART; ++r) {
+      counts[r] = DivAssignment(NPART, r, NMYF).size() * NP * NBINS;
+    }
+    mpi::wrapper::all_gather_in_place(interpartitioncomm_, &(histograms_[0]),
+                                      counts);
+  }
+  histograms_ready_ = true;
+}
+
+ExactSphereScatterDevice::~ExactSphereScatterDevice() {
+  if (p_coordinates != NULL) {
+    StagedMemory::free(p_coordinates);
+    p_coordinates = NULL;
+  }
+  if (atfinal_ != NULL) {
+    fftw_free(atfinal_);
+    atfinal_ = NULL;
+  }
+}
+
+void ExactSphereScatterDevice::task_scatter_rows(size_t fi, size_t ib) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter_rows(fi, ib);
+  timer.stop("sd:worker:scatter");
+
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_block_++;
+}
+
+void ExactSphereScatterDevice::task_histogram(size_t fi) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:histogram");
+  ScatteringAverageOrientationExactParameters& exact =
+      Params::Inst()->scattering.average.orientation.exact;
+  coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+  smath::pair_histogram(p_data, &(p_data[NA]), &(p_data[2 * NA]),
+                        &(species_[0]), NS, NA, exact.binwidth, NBINS,
+                        exact.cutoff, &(histograms_[fi * NP * NBINS]));
+  timer.stop("sd:worker:histogram");
+}
+
+void ExactSphereScatterDevice::task_scatter_histogram(size_t fi) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter_histogram(fi);
+  timer.stop("sd:worker:scatter");
+
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_block_ += NB;
+}
+
+void ExactSphereScatterDevice::scatter_rows(size_t fi, size_t ib) {
+  std::vector<double>& sfs = scatterfactors.get_all();
+  double ql = vectors_[current_vector_].length();
+
+  coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+  size_t i0 = ib * rowblock_;
+  size_t i1 = std::min(i0 + rowblock_, NA);
+
+  // the diagonal block covers both triangles, the remaining pairs of the rows
+  // appear twice in the full sum
+  double s = smath::debye_sum(simd_, p_data, &(p_data[NA]), &(p_data[2 * NA]),
+                              &(sfs[0]), ql, i0, i1, i0, i1);
+  if (i1 < NA) {
+    s += 2 * smath::debye_sum(simd_, p_data, &(p_data[NA]),
+                              &(p_data[2 * NA]), &(sfs[0]), ql, i0, i1, i1,
+                              NA);
+  }
+  partials_[fi * NB + ib] = s;
+}
+
+void ExactSphereScatterDevice::scatter_histogram(size_t fi) {
+  std::vector<double>& sfs = scatterfactors.get_all();
+  std::vector<double>& species_sfs = scatterfactors.get_species_factors();
+
+  // pairs of an atom with itself, then all other pairs by their histograms
+  double s = 0;
+  for (size_t j = 0; j < NA; ++j) s += sfs[j] * sfs[j];
+
+  const double* p_histograms = &(histograms_[fi * NP * NBINS]);
+  for (size_t t = 0; t < NS; ++t) {
+    for (size_t u = 0; u <= t; ++u) {
+      const double* p_h = &(p_histograms[smath::species_pair(u, t) * NBINS]);
+      double h = 0;
+      for (size_t k = 0; k < NBINS; ++k) h += p_h[k] * sinc_[k];
+      s += 2 * species_sfs[u] * species_sfs[t] * h;
+    }
+  }
+  partials_[fi * NB] = s;
+}
+
+void ExactSphereScatterDevice::scatter_origin(size_t fi) {
+  std::vector<double>& sfs = scatterfactors.get_all();
+  double ql = vectors_[current_vector_].length();
+
+  coor_t* p_data = &(p_coordinates[fi * NA * 3]);
+  double s = 0;
+  for (size_t j = 0; j < NA; ++j) {
+    double x = p_data[j];
+    double y = p_data[NA + j];
+    double z = p_data[2 * NA + j];
+    double qr = ql * sqrt(x * x + y * y + z * z);
+    s += sfs[j] * ((qr > 0) ? sin(qr) / qr : 1.0);
+  }
+  partials_[fi * NB] = s;
+}
+
+void ExactSphereScatterDevice::compute() {
+  CartesianCoor3D q = vectors_[current_vector_];
+
+  Timer& timer = timer_[boost::this_thread::get_id()];
+
+  timer.start("sd:c:init");
+  scatterfactors.update(q);  // scatter factors only dependent on length of q,
+                             // hence we can do it once before the loop
+  timer.stop("sd:c:init");
+
+  size_t NNPP = partitioncomm_.size();
+  DivAssignment assignment(NNPP, partitioncomm_.rank(), NF);
+  size_t NMYF = assignment.size();
+
+  current_block_ = 0;
+  memset(atfinal_, 0, NF * sizeof(fftw_complex));
+  afinal_ = 0;
+  a2final_ = 0;
+  partials_.assign(NMYF * NB, 0);
+
+  bool histogram =
+      (Params::Inst()->scattering.average.orientation.exact.method ==
+       "histogram") &&
+      (Params::Inst()->scattering.dsp.type == "square");
+  if (histogram && !histograms_ready_) {
+    timer.start("sd:c:histogram");
+    build_histograms();
+    timer.stop("sd:c:histogram");
+  }
+
+  timer.start("sd:c:block");
+  if (histogram) {
+    smath::sinc_table(vectors_[current_vector_].length(),
+                      Params::Inst()->scattering.average.orientation.exact
+                          .binwidth,
+                      NBINS, &(sinc_[0]));
+    for (size_t fi = 0; fi < NMYF; ++fi) {
+      taskpool_->submit(boost::bind(
+          &ExactSphereScatterDevice::task_scatter_histogram, this, fi));
+    }
+    wait_for_tasks();
+  } else if (Params::Inst()->scattering.dsp.type == "plain") {
+    // averaged amplitudes, which are cheap compared to the pair sums
+    for (size_t fi = 0; fi < NMYF; ++fi) {
+      scatter_origin(fi);
+    }
+  } else if (Params::Inst()->scattering.dsp.type == "square") {
+    // the first blocks of rows hold most pairs, submitting them first
+    // balances the load
+    for (size_t ib = 0; ib < NB; ++ib) {
+      for (size_t fi = 0; fi < NMYF; ++fi) {
+        taskpool_->submit(boost::bind(
+            &ExactSphereScatterDevice::task_scatter_rows, this, fi, ib));
+      }
+    }
+    wait_for_tasks();
+  } else {
+    Err::Inst()->write(string("DSP type not understood: ") +
+                       Params::Inst()->scattering.dsp.type);
+    Err::Inst()->write("scattering.dsp.type == square, plain");
+    throw;
+  }
+
+  size_t offset = assignment.offset();
+  for (size_t fi = 0; fi < NMYF; ++fi) {
+    double s = 0;
+    for (size_t ib = 0; ib < NB; ++ib) s += partials_[fi * NB + ib];
+    atfinal_[offset + fi][0] = s;
+  }
+  timer.stop("sd:c:block");
+
+  timer.start("sd:c:wait");
+  partitioncomm_.barrier();
+  timer.stop("sd:c:wait");
+
+  // every frame is owned by exactly one node
+  timer.start("sd:c:reduce");
+  if (NNPP > 1) {
+    double* p_atfinal = (double*)&(atfinal_[0][0]);
+    double* p_atlocal = NULL;
+    if (partitioncomm_.rank() == 0) {
+      fftw_complex* atlocal_ =
+          (fftw_complex*)fftw_malloc(NF * sizeof(fftw_complex));
+      p_atlocal = (double*)&(atlocal_[0][0]);
+      memset(atlocal_, 0, NF * sizeof(fftw_complex));
+    }
+
+    boost::mpi::reduce(partitioncomm_, p_atfinal, 2 * NF, p_atlocal,
+                       std::plus<double>(), 0);
+
+    // swap pointers on rank 0
+    if (partitioncomm_.rank() == 0) {
+      fftw_free(atfinal_);
+      atfinal_ = (fftw_complex*)p_atlocal;
+    }
+  }
+  timer.stop("sd:c:reduce");
+
+  if (partitioncomm_.rank() == 0) {
+    afinal_ = smath::reduce<double>(atfinal_, NF) * (1.0 / NF);
+    a2final_ = afinal_ * conj(afinal_);
+  }
+}
+
+// end of file
@@ -20,13 +20,15 @@ scattering ).
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include <boost/lexical_cast.hpp>
-#include <boost/math/special_functions.hpp>
 
 // other headers
 #include "control.hpp"
 #include "log.hpp"
 #include "math/coor3d.hpp"
+#include "math/fft.hpp"
+#include "math/multipole.hpp"
 #include "math/smath.hpp"
+#include "mpi/wrapper.hpp"
 #include "sample.hpp"
 #include "stager/data_stager.hpp"
 
@@ -39,14 +41,12 @@ MPSphereScatterDevice::MPSphereScatterDevice(
     boost::asio::ip::tcp::endpoint monitorservice_endpoint)
     : AbstractScatterDevice(allcomm, partitioncomm, sample, vectors, NAF,
                             fileservice_endpoint, monitorservice_endpoint),
-      current_moment_(0) {
+      current_moment_(0),
+      amplitudes_(NULL) {
   sample_.coordinate_sets.set_representation(SPHERICAL);
 
-  fftw_complex* wspace = NULL;
-  fftw_planF_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_planB_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_BACKWARD, FFTW_ESTIMATE);
+  fftw_planF_ = smath::FFTPlanner::Inst()->complex_plan(2 * NF, FFTW_FORWARD);
+  fftw_planR_ = smath::FFTPlanner::Inst()->real_plan(2 * NF);
 }
 
 void MPSphereScatterDevice::print_pre_stage_info() {
@@ -89,15 +89,22 @@ bool MPSphereScatterDevice::ram_check() {
   size_t bytesize_exchange_buffer = 0;
   size_t bytesize_alignpad_buffer = 0;
 
+  // scratch arenas, see reserve_scratch
+  // amplitudes of all moments for the frames of a node
+  size_t NMP =
+      Params::Inst()->scattering.average.orientation.multipole.moments.size();
+  size_t bytesize_amplitude_buffer = NMP * NMAXF * sizeof(fftw_complex);
   if (NNPP == 1) {
-    bytesize_signal_buffer = NF * NTHREADS * sizeof(fftw_complex);
+    bytesize_signal_buffer = 2 * NF * NTHREADS * sizeof(fftw_complex);
     bytesize_exchange_buffer = 0;  // no exchange
-    bytesize_alignpad_buffer = 2 * NF * sizeof(fftw_complex);
+    bytesize_alignpad_buffer = NTHREADS * 2 * NF * sizeof(fftw_complex);
   } else {
-    bytesize_signal_buffer = NMAXF * NNPP * sizeof(fftw_complex);
-    bytesize_exchange_buffer = NMAXF * NNPP * sizeof(fftw_complex);
-    bytesize_alignpad_buffer = 2 * NF * sizeof(fftw_complex);
+    // two slots for the pipelined exchange
+    bytesize_signal_buffer = 2 * NMAXF * NNPP * sizeof(fftw_complex);
+    bytesize_exchange_buffer = 2 * NMAXF * NNPP * sizeof(fftw_complex);
+    bytesize_alignpad_buffer = (NTHREADS + 1) * 2 * NF * sizeof(fftw_complex);
   }
+  bytesize_signal_buffer += bytesize_amplitude_buffer;
 
   if (bytesize_signal_buffer >
       memscale * Params::Inst()->limits.computation.memory.signal_buffer) {
@@ -183,6 +190,21 @@ void MPSphereScatterDevice::init_moments(CartesianCoor3D& q) {
 
   qvector_ = q;
   NM = multipole_index_.size();
+
+  LMAX = 0;
+  for (size_t i = 0; i < NM; ++i) {
+    long l = multipole_index_[i].first;
+    long m = multipole_index_[i].second;
+    if (abs(m) > l) {
+      Err::Inst()->write(
+          string("Combination of Major and minor moment not allowed: l=") +
+          boost::lexical_cast<string>(l) + string(", m") +
+          boost::lexical_cast<string>(m));
+      Err::Inst()->write("Consult the manual/reference.");
+      throw;
+    }
+    LMAX = std::max(LMAX, l);
+  }
 }
 
 void MPSphereScatterDevice::stage_data() {
@@ -195,53 +217,114 @@ void MPSphereScatterDevice::stage_data() {
 
 MPSphereScatterDevice::~MPSphereScatterDevice() {
   if (p_coordinates != NULL) {
-    free(p_coordinates);
+    StagedMemory::free(p_coordinates);
     p_coordinates = NULL;
   }
-  fftw_destroy_plan(fftw_planF_);
-  fftw_destroy_plan(fftw_planB_);
+  for (size_t s = 0; s < at_.size(); ++s) {
+    fftw_free(at_[s]);
+    fftw_free(atexchange_[s]);
+  }
+  if (amplitudes_ != NULL) {
+    fftw_free(amplitudes_);
+    amplitudes_ = NULL;
+  }
   if (atfinal_ != NULL) {
     fftw_free(atfinal_);
     atfinal_ = NULL;
   }
 }
 
-void MPSphereScatterDevice::worker() {
-  workerbarrier->wait();
+void MPSphereScatterDevice::task_scatter_frames(size_t first, size_t count) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter_frames(first, count);
+  timer.stop("sd:worker:scatter");
+}
 
+void MPSphereScatterDevice::task_scatter(size_t this_moment,
+                                         fftw_complex* p_a) {
   Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter(this_moment, p_a);
+  timer.stop("sd:worker:scatter");
+}
 
-  while (true) {
-    size_t moment_index;
-    timer.start("sd:worker:wait");
-    atscatter_.wait_and_pop(moment_index);
-    timer.stop("sd:worker:wait");
+void MPSphereScatterDevice::task_dspstore(fftw_complex* at) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:dspstore");
+  dsp(at);
+  store(at);
+  scratch_.release(at);
+  timer.stop("sd:worker:dspstore");
+}
 
-    //        if (moment_index<NM) {
-    timer.start("sd:worker:scatter");
-    scatter(moment_index);
-    timer.stop("sd:worker:scatter");
-    //        }
+void MPSphereScatterDevice::task_scatter_dspstore(size_t this_moment) {
+  fftw_complex* at = scratch_.acquire();
+  task_scatter(this_moment, at);
+  task_dspstore(alignpad(at));
+  scratch_.release(at);
 
-    workerbarrier->wait();
-  }
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_moment_++;
 }
 
-fftw_complex* MPSphereScatterDevice::exchange() {
+void MPSphereScatterDevice::reserve_scratch() {
+  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
+  size_t NMAXF = zeronode_assignment.max();
   size_t NNPP = partitioncomm_.size();
+  size_t NTHREADS = taskpool_->size();
+
+  size_t NMP =
+      Params::Inst()->scattering.average.orientation.multipole.moments.size();
+  amplitudes_ = (fftw_complex*)fftw_malloc(NMP * NMAXF * sizeof(fftw_complex));
+  memset(amplitudes_, 0, NMP * NMAXF * sizeof(fftw_complex));
+
+  if (NNPP == 1) {
+    // every task holds a signal and its padded copy
+    scratch_.reserve(2 * NF, 2 * NTHREADS);
+  } else {
+    // the main thread stages one padded signal per block for the tasks
+    scratch_.reserve(2 * NF, NTHREADS + 1);
+
+    size_t NSLOTS = 2;
+    at_.resize(NSLOTS);
+    atexchange_.resize(NSLOTS);
+    for (size_t s = 0; s < NSLOTS; ++s) {
+      at_[s] =
+          (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+      memset(at_[s], 0, NMAXF * NNPP * sizeof(fftw_complex));
+      atexchange_[s] =
+          (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+    }
+  }
+}
 
+void MPSphereScatterDevice::exchange_start(size_t slot) {
   DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
   size_t NMAXF = zeronode_assignment.max();
 
-  fftw_complex* atOUT =
-      (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+  double* pIN = (double*)at_[slot];
+  double* pOUT = (double*)atexchange_[slot];
 
-  double* pIN = (double*)at_;
-  double* pOUT = (double*)atOUT;
+  exchange_request_ =
+      mpi::wrapper::iall_to_all(partitioncomm_, pIN, 2 * NMAXF, pOUT);
+}
 
-  boost::mpi::all_to_all(partitioncomm_, pIN, 2 * NMAXF, pOUT);
+fftw_complex* MPSphereScatterDevice::exchange_wait(size_t slot) {
+  mpi::wrapper::wait(exchange_request_);
+  return atexchange_[slot];
+}
 
-  return atOUT;
+void MPSphereScatterDevice::dspstore_block(size_t first, fftw_complex* at) {
+  size_t NNPP = partitioncomm_.size();
+
+  // node r post-processes the moment first+r
+  if (size_t(partitioncomm_.rank()) < std::min(NNPP, NM - first)) {
+    taskpool_->submit(
+        boost::bind(&MPSphereScatterDevice::task_dspstore, this, alignpad(at)));
+  }
+
+  current_moment_ += std::min(NNPP, NM - first);
 }
 
 fftw_complex* MPSphereScatterDevice::alignpad(fftw_complex* at) {
@@ -250,8 +333,7 @@ fftw_complex* MPSphereScatterDevice::alignpad(fftw_complex* at) {
   DivAssignment zeronode_assignment(NNPP, 0, NF);
   size_t NMAXF = zeronode_assignment.max();
 
-  fftw_complex* atOUT =
-      (fftw_complex*)fftw_malloc(2 * NF * sizeof(fftw_complex));
+  fftw_complex* atOUT = scratch_.acquire();
 
   for (size_t i = 0; i < NNPP; ++i) {
     DivAssignment node_assignment(NNPP, i, NF);
@@ -270,9 +352,11 @@ void MPSphereScatterDevice::dsp(fftw_complex* at) {
   // correlate or sum up
   if (Params::Inst()->scattering.dsp.type == "autocorrelate") {
     if (Params::Inst()->scattering.dsp.method == "direct") {
-      smath::auto_correlate_direct(at, NF);
+      smath::auto_correlate_direct(at, NF, &(at[NF]),
+                                   Params::Inst()->scattering.dsp.max_lag,
+                                   simd_);
     } else if (Params::Inst()->scattering.dsp.method == "fftw") {
-      smath::auto_correlate_fftw(at, fftw_planF_, fftw_planB_, NF);
+      smath::auto_correlate_fftw_r2c(at, fftw_planF_, fftw_planR_, NF);
     } else {
       Err::Inst()->write("Correlation method not understood");
       Err::Inst()->write("scattering.dsp.method == direct, fftw");
@@ -290,6 +374,7 @@ void MPSphereScatterDevice::dsp(fftw_complex* at) {
 
 void MPSphereScatterDevice::store(fftw_complex* at) {
   complex<double> a = smath::reduce<double>(at, NF) * (1.0 / NF);
+  boost::mutex::scoped_lock lock(store_mutex_);
   afinal_ += a;
   a2final_ += a * conj(a);
   smath::add_elements(atfinal_, at, NF);
@@ -315,68 +400,80 @@ void MPSphereScatterDevice::compute() {
   afinal_ = 0;
   a2final_ = 0;
 
+  // the amplitudes of all moments are evaluated together, frames are split
+  // into several chunks per worker to balance the load
+  timer.start("sd:c:moments");
+  DivAssignment assignment(NNPP, partitioncomm_.rank(), NF);
+  size_t NMYF = assignment.size();
+  size_t chunk = std::max<size_t>(1, NMYF / (4 * taskpool_->size()));
+  for (size_t fi = 0; fi < NMYF; fi += chunk) {
+    taskpool_->submit(boost::bind(&MPSphereScatterDevice::task_scatter_frames,
+                                  this, fi, std::min(chunk, NMYF - fi)));
+  }
+  wait_for_tasks();
+  timer.stop("sd:c:moments");
+
   timer.start("sd:c:block");
   // special case: 1 core, no exchange required
+  // every moment is scattered and post-processed independently
   if (NNPP == 1) {
-    size_t NTHREADS = worker_threads.size();
+    for (size_t i = 0; i < NM; ++i) {
+      taskpool_->submit(
+          boost::bind(&MPSphereScatterDevice::task_scatter_dspstore, this, i));
+    }
+    wait_for_tasks();
+  } else {
+    // the exchange requires all moments of a block. The blocks are pipelined
+    // through a ring of buffers: while block b is scattered, the exchange of
+    // block b-1 is in flight and its post-processing is submitted as soon as
+    // it arrived.
+    size_t NSLOTS = at_.size();
+
+    bool inflight = false;
+    size_t inflight_first = 0;
+    size_t inflight_slot = 0;
+    for (size_t i = 0, b = 0; i < NM; i += NNPP, ++b) {
+      size_t slot = b % NSLOTS;
+
+      for (size_t j = 0; j < std::min(NNPP, NM - i); ++j) {
+        taskpool_->submit(
+            boost::bind(&MPSphereScatterDevice::task_scatter, this, i + j,
+                        &(at_[slot][j * NMAXF])));
+      }
 
-    at_ = (fftw_complex*)fftw_malloc(NF * NTHREADS * sizeof(fftw_complex));
-    memset(at_, 0, NF * NTHREADS * sizeof(fftw_complex));
+      if (inflight) {
+        timer.start("sd:c:b:exchange");
+        fftw_complex* at = exchange_wait(inflight_slot);
+        timer.stop("sd:c:b:exchange");
+
+        timer.start("sd:c:b:dspstore");
+        dspstore_block(inflight_first, at);
+        timer.stop("sd:c:b:dspstore");
+      }
 
-    for (size_t i = 0; i < NM; i += NTHREADS) {
       timer.start("sd:c:b:scatter");
-      scatterblock(i, std::min(NTHREADS, NM - i));
+      wait_for_tasks();
       timer.stop("sd:c:b:scatter");
 
-      timer.start("sd:c:b:dspstore");
-      for (size_t j = 0; j < std::min(NTHREADS, NM - i); ++j) {
-        size_t offset = ((j + i) % NTHREADS) * NF;
-        fftw_complex* pat = &(at_[offset]);
-        fftw_complex* nat = alignpad(pat);
-        dsp(nat);
-        store(nat);
-        fftw_free(nat);
-        nat = NULL;
-      }
-      timer.stop("sd:c:b:dspstore");
+      exchange_start(slot);
+      inflight = true;
+      inflight_first = i;
+      inflight_slot = slot;
 
-      current_moment_ += NTHREADS;
+      timer.start("sd:c:b:progress");
       p_monitor_->update(allcomm_.rank(), progress());
+      timer.stop("sd:c:b:progress");
     }
-    fftw_free(at_);
-
-  } else {
-    at_ = (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
-    memset(at_, 0, NMAXF * NNPP * sizeof(fftw_complex));
-
-    for (size_t i = 0; i < NM; i += NNPP) {
-      timer.start("sd:c:b:scatter");
-      scatterblock(i, std::min(NNPP, NM - i));
-      timer.stop("sd:c:b:scatter");
-
+    if (inflight) {
       timer.start("sd:c:b:exchange");
-      fftw_complex* at = exchange();
+      fftw_complex* at = exchange_wait(inflight_slot);
       timer.stop("sd:c:b:exchange");
 
       timer.start("sd:c:b:dspstore");
-      if (partitioncomm_.rank() < std::min(NNPP, NM - i)) {
-        fftw_complex* nat = alignpad(at);
-        fftw_free(at);
-        at = NULL;
-        dsp(nat);
-        store(nat);
-        fftw_free(nat);
-        nat = NULL;
-      }
-      if (at != NULL) fftw_free(at);
+      dspstore_block(inflight_first, at);
       timer.stop("sd:c:b:dspstore");
-
-      current_moment_ += std::min(NNPP, NM - i);
-      timer.start("sd:c:b:progress");
-      p_monitor_->update(allcomm_.rank(), progress());
-      timer.stop("sd:c:b:progress");
     }
-    fftw_free(at_);
+    wait_for_tasks();
   }
   timer.stop("sd:c:block");
 
@@ -427,105 +524,76 @@ void MPSphereScatterDevice::compute() {
   }
 }
 
-void MPSphereScatterDevice::scatterblock(size_t index, size_t count) {
-  size_t SCATTERBLOCK = worker_threads.size();
-
-  //    cerr << "loop w/ index=" << index << " , count=" << count << endl;
-  //    sleep(3);
-  for (size_t i = 0; i < count; ++i) {
-    atscatter_.push(index + i);
-
-    if (((i + 1) % SCATTERBLOCK) == 0) {
-      workerbarrier->wait();
-    }
-  }
-
-  if ((count % SCATTERBLOCK) != 0) {
-    size_t rest = SCATTERBLOCK - (count % SCATTERBLOCK);
-    for (size_t i = 0; i < rest; ++i) {
-      atscatter_.push(NM);  // NM will be ignored, but triggers a barrier
-    }
-    workerbarrier->wait();
-  }
-}
-
-void MPSphereScatterDevice::scatter(size_t this_moment) {
-  // outer loop: frames
-  // inner loop: block of moments
-
-  using namespace boost::numeric::ublas::detail;
-  //   cerr << "this_subvector " << this_subvector << endl;
-  //   sleep(3);
+void MPSphereScatterDevice::scatter_frames(size_t first, size_t count) {
   std::vector<double>& sfs = scatterfactors.get_all();
 
   DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
   size_t NMAXF = zeronode_assignment.max();
-  size_t NNPP = partitioncomm_.size();
-  size_t offset = 0;
-  if (NNPP == 1) {
-    size_t NTHREADS = worker_threads.size();
-    offset = (this_moment % NTHREADS) * NF;
-  } else {
-    offset = (this_moment % NNPP) * NMAXF;
-  }
-
-  DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
-  size_t NMYF = assignment.size();
-  fftw_complex* p_a = &(at_[offset]);
 
-  std::pair<long, long> moment = multipole_index_[this_moment];
   double ql = qvector_.length();
-  double M_PI_four = 4 * M_PI;
 
-  SphericalCoor3D qs(qvector_);
-
-  long l = moment.first;
-  long m = moment.second;
-
-  if (abs(m) > l) {
-    Err::Inst()->write(
-        string("Combination of Major and minor moment not allowed: l=") +
-        boost::lexical_cast<string>(l) + string(", m") +
-        boost::lexical_cast<string>(m));
-    Err::Inst()->write("Consult the manual/reference.");
-    throw;
+  // 4*pi*i^l
+  std::vector<complex<double> > il(LMAX + 1);
+  complex<double> ipow[4] = {complex<double>(1, 0), complex<double>(0, 1),
+                             complex<double>(-1, 0), complex<double>(0, -1)};
+  for (long l = 0; l <= LMAX; ++l) il[l] = 4 * M_PI * ipow[l % 4];
+
+  // conj(Y_lm) is conj(Y_l|m|) for m >= 0 and (-1)^m Y_l|m| otherwise
+  std::vector<size_t> yindex(NM);
+  std::vector<double> ysign(NM);
+  for (size_t k = 0; k < NM; ++k) {
+    long l = multipole_index_[k].first;
+    long m = multipole_index_[k].second;
+    yindex[k] = smath::SphericalHarmonics::index(l, abs(m));
+    ysign[k] = ((m < 0) && (abs(m) % 2 == 1)) ? -1.0 : 1.0;
   }
 
-  for (size_t fi = 0; fi < NMYF; ++fi) {
+  smath::SphericalHarmonics harmonics(LMAX);
+  std::vector<double> jl(LMAX + 1);
+  std::vector<complex<double> > c(LMAX + 1);
+  std::vector<complex<double> > Y(harmonics.size());
+  std::vector<complex<double> > A(NM);
+
+  for (size_t fi = first; fi < first + count; ++fi) {
     coor_t* p_data = &(p_coordinates[fi * NA * 3]);
 
-    complex<double> A = 0;
+    std::fill(A.begin(), A.end(), complex<double>(0));
     for (size_t j = 0; j < NA; ++j) {
       double r = p_data[3 * j];
       double phi = p_data[3 * j + 1];
       double theta = p_data[3 * j + 2];
 
-      double esf = sfs[j];
-      double p = ql * r;
-      //           cout << "r=" << r << endl;
-      //           cout << "phi=" << phi << endl;
-      //           cout << "theta=" << theta << endl;
-
-      complex<double> fmpiilesf =
-          M_PI_four * pow(complex<double>(0, 1.0), l) * esf;
-      complex<double> aabess = boost::math::sph_bessel(l, p);
-      //           cout << "fmpiilesf=" << fmpiilesf << endl;
-      //           cout << "aabess=" << aabess << endl;
-
-      complex<double> aa =
-          conj(boost::math::spherical_harmonic(l, m, theta, phi));
-      //           cout << "aa=" << aa << endl;
-
-      A += fmpiilesf * aabess *
-           aa;  // * boost::math::spherical_harmonic(l,m,qs.theta,qs.phi);
-                //           cout << "j=" << j << ", A=" << A << endl;
+      smath::sph_bessel_all(LMAX, ql * r, &(jl[0]));
+      harmonics.evaluate(theta, phi, &(Y[0]));
+      for (long l = 0; l <= LMAX; ++l) c[l] = il[l] * (sfs[j] * jl[l]);
+
+      for (size_t k = 0; k < NM; ++k) {
+        complex<double> y = Y[yindex[k]];
+        if (multipole_index_[k].second >= 0) {
+          y = conj(y);
+        } else {
+          y *= ysign[k];
+        }
+        A[k] += c[multipole_index_[k].first] * y;
+      }
+    }
+    for (size_t k = 0; k < NM; ++k) {
+      amplitudes_[k * NMAXF + fi][0] = A[k].real();
+      amplitudes_[k * NMAXF + fi][1] = A[k].imag();
     }
-    p_a[fi][0] = A.real();
-    p_a[fi][1] = A.imag();
-    //       cout << "l,m=" << l << "," << m <<  ", A=" << A << endl;
   }
 }
 
+void MPSphereScatterDevice::scatter(size_t this_moment, fftw_complex* p_a) {
+  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
+  size_t NMAXF = zeronode_assignment.max();
+  DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
+  size_t NMYF = assignment.size();
+
+  memcpy(p_a, &(amplitudes_[this_moment * NMAXF]),
+         NMYF * sizeof(fftw_complex));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Cylinder Multipole
 ////////////////////////////////////////////////////////////////////////////////
@@ -537,14 +605,12 @@ MPCylinderScatterDevice::MPCylinderScatterDevice(
     boost::asio::ip::tcp::endpoint monitorservice_endpoint)
     : AbstractScatterDevice(allcomm, partitioncomm, sample, vectors, NAF,
                             fileservice_endpoint, monitorservice_endpoint),
-      current_moment_(0) {
+      current_moment_(0),
+      amplitudes_(NULL) {
   sample_.coordinate_sets.set_representation(CYLINDRICAL);
 
-  fftw_complex* wspace = NULL;
-  fftw_planF_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_planB_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_BACKWARD, FFTW_ESTIMATE);
+  fftw_planF_ = smath::FFTPlanner::Inst()->complex_plan(2 * NF, FFTW_FORWARD);
+  fftw_planR_ = smath::FFTPlanner::Inst()->real_plan(2 * NF);
 }
 
 void MPCylinderScatterDevice::print_pre_stage_info() {
@@ -587,15 +653,22 @@ bool MPCylinderScatterDevice::ram_check() {
   size_t bytesize_exchange_buffer = 0;
   size_t bytesize_alignpad_buffer = 0;
 
+  // scratch arenas, see reserve_scratch
+  // amplitudes of all moments for the frames of a node
+  size_t NMP =
+      Params::Inst()->scattering.average.orientation.multipole.moments.size();
+  size_t bytesize_amplitude_buffer = NMP * NMAXF * sizeof(fftw_complex);
   if (NNPP == 1) {
-    bytesize_signal_buffer = NF * NTHREADS * sizeof(fftw_complex);
+    bytesize_signal_buffer = 2 * NF * NTHREADS * sizeof(fftw_complex);
     bytesize_exchange_buffer = 0;  // no exchange
-    bytesize_alignpad_buffer = 2 * NF * sizeof(fftw_complex);
+    bytesize_alignpad_buffer = NTHREADS * 2 * NF * sizeof(fftw_complex);
   } else {
-    bytesize_signal_buffer = NMAXF * NNPP * sizeof(fftw_complex);
-    bytesize_exchange_buffer = NMAXF * NNPP * sizeof(fftw_complex);
-    bytesize_alignpad_buffer = 2 * NF * sizeof(fftw_complex);
+    // two slots for the pipelined exchange
+    bytesize_signal_buffer = 2 * NMAXF * NNPP * sizeof(fftw_complex);
+    bytesize_exchange_buffer = 2 * NMAXF * NNPP * sizeof(fftw_complex);
+    bytesize_alignpad_buffer = (NTHREADS + 1) * 2 * NF * sizeof(fftw_complex);
   }
+  bytesize_signal_buffer += bytesize_amplitude_buffer;
 
   if (bytesize_signal_buffer >
       memscale * Params::Inst()->limits.computation.memory.signal_buffer) {
@@ -682,6 +755,12 @@ void MPCylinderScatterDevice::init_moments(CartesianCoor3D& q) {
 
   NM = multipole_index_.size();
   qvector_ = q;
+
+  // the moments have been validated when they were generated
+  LMAX = 0;
+  for (size_t i = 0; i < NM; ++i) {
+    LMAX = std::max(LMAX, multipole_index_[i].first);
+  }
 }
 
 void MPCylinderScatterDevice::stage_data() {
@@ -692,53 +771,116 @@ void MPCylinderScatterDevice::stage_data() {
 
 MPCylinderScatterDevice::~MPCylinderScatterDevice() {
   if (p_coordinates != NULL) {
-    free(p_coordinates);
+    StagedMemory::free(p_coordinates);
     p_coordinates = NULL;
   }
-  fftw_destroy_plan(fftw_planF_);
-  fftw_destroy_plan(fftw_planB_);
+  for (size_t s = 0; s < at_.size(); ++s) {
+    fftw_free(at_[s]);
+    fftw_free(atexchange_[s]);
+  }
+  if (amplitudes_ != NULL) {
+    fftw_free(amplitudes_);
+    amplitudes_ = NULL;
+  }
   if (atfinal_ != NULL) {
     fftw_free(atfinal_);
     atfinal_ = NULL;
   }
 }
 
-void MPCylinderScatterDevice::worker() {
-  workerbarrier->wait();
+void MPCylinderScatterDevice::task_scatter_frames(size_t first,
+                                                  size_t count) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter_frames(first, count);
+  timer.stop("sd:worker:scatter");
+}
 
+void MPCylinderScatterDevice::task_scatter(size_t this_moment,
+                                           fftw_complex* p_a) {
   Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:scatter");
+  scatter(this_moment, p_a);
+  timer.stop("sd:worker:scatter");
+}
 
-  while (true) {
-    size_t moment_index;
-    timer.start("sd:worker:wait");
-    atscatter_.wait_and_pop(moment_index);
-    timer.stop("sd:worker:wait");
+void MPCylinderScatterDevice::task_dspstore(fftw_complex* at) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
+  timer.start("sd:worker:dspstore");
+  dsp(at);
+  store(at);
+  scratch_.release(at);
+  timer.stop("sd:worker:dspstore");
+}
 
-    //        if (moment_index<NM) {
-    timer.start("sd:worker:scatter");
-    scatter(moment_index);
-    timer.stop("sd:worker:scatter");
-    //        }
+void MPCylinderScatterDevice::task_scatter_dspstore(size_t this_moment) {
+  fftw_complex* at = scratch_.acquire();
+  task_scatter(this_moment, at);
+  task_dspstore(alignpad(at));
+  scratch_.release(at);
 
-    workerbarrier->wait();
-  }
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_moment_++;
 }
 
-fftw_complex* MPCylinderScatterDevice::exchange() {
+void MPCylinderScatterDevice::reserve_scratch() {
+  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
+  size_t NMAXF = zeronode_assignment.max();
   size_t NNPP = partitioncomm_.size();
+  size_t NTHREADS = taskpool_->size();
+
+  size_t NMP =
+      Params::Inst()->scattering.average.orientation.multipole.moments.size();
+  amplitudes_ = (fftw_complex*)fftw_malloc(NMP * NMAXF * sizeof(fftw_complex));
+  memset(amplitudes_, 0, NMP * NMAXF * sizeof(fftw_complex));
 
+  if (NNPP == 1) {
+    // every task holds a signal and its padded copy
+    scratch_.reserve(2 * NF, 2 * NTHREADS);
+  } else {
+    // the main thread stages one padded signal per block for the tasks
+    scratch_.reserve(2 * NF, NTHREADS + 1);
+
+    size_t NSLOTS = 2;
+    at_.resize(NSLOTS);
+    atexchange_.resize(NSLOTS);
+    for (size_t s = 0; s < NSLOTS; ++s) {
+      at_[s] =
+          (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+      memset(at_[s], 0, NMAXF * NNPP * sizeof(fftw_complex));
+      atexchange_[s] =
+          (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+    }
+  }
+}
+
+void MPCylinderScatterDevice::exchange_start(size_t slot) {
   DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
   size_t NMAXF = zeronode_assignment.max();
 
-  fftw_complex* atOUT =
-      (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
+  double* pIN = (double*)at_[slot];
+  double* pOUT = (double*)atexchange_[slot];
 
-  double* pIN = (double*)at_;
-  double* pOUT = (double*)atOUT;
+  exchange_request_ =
+      mpi::wrapper::iall_to_all(partitioncomm_, pIN, 2 * NMAXF, pOUT);
+}
 
-  boost::mpi::all_to_all(partitioncomm_, pIN, 2 * NMAXF, pOUT);
+fftw_complex* MPCylinderScatterDevice::exchange_wait(size_t slot) {
+  mpi::wrapper::wait(exchange_request_);
+  return atexchange_[slot];
+}
 
-  return atOUT;
+void MPCylinderScatterDevice::dspstore_block(size_t first, fftw_complex* at) {
+  size_t NNPP = partitioncomm_.size();
+
+  // node r post-processes the moment first+r
+  if (size_t(partitioncomm_.rank()) < std::min(NNPP, NM - first)) {
+    taskpool_->submit(
+        boost::bind(&MPCylinderScatterDevice::task_dspstore, this,
+                    alignpad(at)));
+  }
+
+  current_moment_ += std::min(NNPP, NM - first);
 }
 
 fftw_complex* MPCylinderScatterDevice::alignpad(fftw_complex* at) {
@@ -747,8 +889,7 @@ fftw_complex* MPCylinderScatterDevice::alignpad(fftw_complex* at) {
   DivAssignment zeronode_assignment(NNPP, 0, NF);
   size_t NMAXF = zeronode_assignment.max();
 
-  fftw_complex* atOUT =
-      (fftw_complex*)fftw_malloc(2 * NF * sizeof(fftw_complex));
+  fftw_complex* atOUT = scratch_.acquire();
 
   for (size_t i = 0; i < NNPP; ++i) {
     DivAssignment node_assignment(NNPP, i, NF);
@@ -767,9 +908,11 @@ void MPCylinderScatterDevice::dsp(fftw_complex* at) {
   // correlate or sum up
   if (Params::Inst()->scattering.dsp.type == "autocorrelate") {
     if (Params::Inst()->scattering.dsp.method == "direct") {
-      smath::auto_correlate_direct(at, NF);
+      smath::auto_correlate_direct(at, NF, &(at[NF]),
+                                   Params::Inst()->scattering.dsp.max_lag,
+                                   simd_);
     } else if (Params::Inst()->scattering.dsp.method == "fftw") {
-      smath::auto_correlate_fftw(at, fftw_planF_, fftw_planB_, NF);
+      smath::auto_correlate_fftw_r2c(at, fftw_planF_, fftw_planR_, NF);
     } else {
       Err::Inst()->write("Correlation method not understood");
       Err::Inst()->write("scattering.dsp.method == direct, fftw");
@@ -787,6 +930,7 @@ void MPCylinderScatterDevice::dsp(fftw_complex* at) {
 
 void MPCylinderScatterDevice::store(fftw_complex* at) {
   complex<double> a = smath::reduce<double>(at, NF) * (1.0 / NF);
+  boost::mutex::scoped_lock lock(store_mutex_);
   afinal_ += a;
   a2final_ += a * conj(a);
   smath::add_elements(atfinal_, at, NF);
@@ -811,68 +955,81 @@ void MPCylinderScatterDevice::compute() {
   afinal_ = 0;
   a2final_ = 0;
 
+  // the amplitudes of all moments are evaluated together, frames are split
+  // into several chunks per worker to balance the load
+  timer.start("sd:c:moments");
+  DivAssignment assignment(NNPP, partitioncomm_.rank(), NF);
+  size_t NMYF = assignment.size();
+  size_t chunk = std::max<size_t>(1, NMYF / (4 * taskpool_->size()));
+  for (size_t fi = 0; fi < NMYF; fi += chunk) {
+    taskpool_->submit(boost::bind(&MPCylinderScatterDevice::task_scatter_frames,
+                                  this, fi, std::min(chunk, NMYF - fi)));
+  }
+  wait_for_tasks();
+  timer.stop("sd:c:moments");
+
   timer.start("sd:c:block");
   // special case: 1 core, no exchange required
+  // every moment is scattered and post-processed independently
   if (NNPP == 1) {
-    size_t NTHREADS = worker_threads.size();
+    for (size_t i = 0; i < NM; ++i) {
+      taskpool_->submit(
+          boost::bind(&MPCylinderScatterDevice::task_scatter_dspstore, this,
+                      i));
+    }
+    wait_for_tasks();
+  } else {
+    // the exchange requires all moments of a block. The blocks are pipelined
+    // through a ring of buffers: while block b is scattered, the exchange of
+    // block b-1 is in flight and its post-processing is submitted as soon as
+    // it arrived.
+    size_t NSLOTS = at_.size();
+
+    bool inflight = false;
+    size_t inflight_first = 0;
+    size_t inflight_slot = 0;
+    for (size_t i = 0, b = 0; i < NM; i += NNPP, ++b) {
+      size_t slot = b % NSLOTS;
+
+      for (size_t j = 0; j < std::min(NNPP, NM - i); ++j) {
+        taskpool_->submit(
+            boost::bind(&MPCylinderScatterDevice::task_scatter, this, i + j,
+                        &(at_[slot][j * NMAXF])));
+      }
 
-    at_ = (fftw_complex*)fftw_malloc(NF * NTHREADS * sizeof(fftw_complex));
-    memset(at_, 0, NF * NTHREADS * sizeof(fftw_complex));
+      if (inflight) {
+        timer.start("sd:c:b:exchange");
+        fftw_complex* at = exchange_wait(inflight_slot);
+        timer.stop("sd:c:b:exchange");
+
+        timer.start("sd:c:b:dspstore");
+        dspstore_block(inflight_first, at);
+        timer.stop("sd:c:b:dspstore");
+      }
 
-    for (size_t i = 0; i < NM; i += NTHREADS) {
       timer.start("sd:c:b:scatter");
-      scatterblock(i, std::min(NTHREADS, NM - i));
+      wait_for_tasks();
       timer.stop("sd:c:b:scatter");
 
-      timer.start("sd:c:b:dspstore");
-      for (size_t j = 0; j < std::min(NTHREADS, NM - i); ++j) {
-        size_t offset = ((j + i) % NTHREADS) * NF;
-        fftw_complex* pat = &(at_[offset]);
-        fftw_complex* nat = alignpad(pat);
-        dsp(nat);
-        store(nat);
-        fftw_free(nat);
-        nat = NULL;
-      }
-      timer.stop("sd:c:b:dspstore");
+      exchange_start(slot);
+      inflight = true;
+      inflight_first = i;
+      inflight_slot = slot;
 
-      current_moment_ += NTHREADS;
+      timer.start("sd:c:b:progress");
       p_monitor_->update(allcomm_.rank(), progress());
+      timer.stop("sd:c:b:progress");
     }
-    fftw_free(at_);
-
-  } else {
-    at_ = (fftw_complex*)fftw_malloc(NMAXF * NNPP * sizeof(fftw_complex));
-    memset(at_, 0, NMAXF * NNPP * sizeof(fftw_complex));
-
-    for (size_t i = 0; i < NM; i += NNPP) {
-      timer.start("sd:c:b:scatter");
-      scatterblock(i, std::min(NNPP, NM - i));
-      timer.stop("sd:c:b:scatter");
-
+    if (inflight) {
       timer.start("sd:c:b:exchange");
-      fftw_complex* at = exchange();
+      fftw_complex* at = exchange_wait(inflight_slot);
       timer.stop("sd:c:b:exchange");
 
       timer.start("sd:c:b:dspstore");
-      if (partitioncomm_.rank() < std::min(NNPP, NM - i)) {
-        fftw_complex* nat = alignpad(at);
-        fftw_free(at);
-        at = NULL;
-        dsp(nat);
-        store(nat);
-        fftw_free(nat);
-        nat = NULL;
-      }
-      if (at != NULL) fftw_free(at);
+      dspstore_block(inflight_first, at);
       timer.stop("sd:c:b:dspstore");
-
-      current_moment_ += std::min(NNPP, NM - i);
-      timer.start("sd:c:b:progress");
-      p_monitor_->update(allcomm_.rank(), progress());
-      timer.stop("sd:c:b:progress");
     }
-    fftw_free(at_);
+    wait_for_tasks();
   }
   timer.stop("sd:c:block");
 
@@ -923,53 +1080,11 @@ void MPCylinderScatterDevice::compute() {
   }
 }
 
-void MPCylinderScatterDevice::scatterblock(size_t index, size_t count) {
-  size_t SCATTERBLOCK = worker_threads.size();
-
-  //    cerr << "loop w/ index=" << index << " , count=" << count << endl;
-  //    sleep(3);
-  for (size_t i = 0; i < count; ++i) {
-    atscatter_.push(index + i);
-
-    if (((i + 1) % SCATTERBLOCK) == 0) {
-      workerbarrier->wait();
-    }
-  }
-
-  if ((count % SCATTERBLOCK) != 0) {
-    size_t rest = SCATTERBLOCK - (count % SCATTERBLOCK);
-    for (size_t i = 0; i < rest; ++i) {
-      atscatter_.push(NM);  // NM will be ignored, but triggers a barrier
-    }
-    workerbarrier->wait();
-  }
-}
-
-void MPCylinderScatterDevice::scatter(size_t this_moment) {
-  // outer loop: frames
-  // inner loop: block of moments
-
-  using namespace boost::numeric::ublas::detail;
-  //   cerr << "this_subvector " << this_subvector << endl;
-  //   sleep(3);
+void MPCylinderScatterDevice::scatter_frames(size_t first, size_t count) {
   std::vector<double>& sfs = scatterfactors.get_all();
 
   DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
   size_t NMAXF = zeronode_assignment.max();
-  size_t NNPP = partitioncomm_.size();
-  size_t offset = 0;
-  if (NNPP == 1) {
-    size_t NTHREADS = worker_threads.size();
-    offset = (this_moment % NTHREADS) * NF;
-  } else {
-    offset = (this_moment % NNPP) * NMAXF;
-  }
-
-  DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
-  size_t NMYF = assignment.size();
-  fftw_complex* p_a = &(at_[offset]);
-
-  std::pair<long, long> moment = multipole_index_[this_moment];
 
   CartesianCoor3D o = Params::Inst()->scattering.average.orientation.axis;
 
@@ -981,61 +1096,93 @@ void MPCylinderScatterDevice::scatter(size_t this_moment) {
   double qphi = qcylinder.phi;
   double qz = qcylinder.z;
 
-  long l = moment.first;
-  long m = moment.second;
+  // moment (l,m) is coef * J_n(q_r*r) * cos(n*psi) or sin(n*psi), with the
+  // order n = 2l for m = 0, 1 and n = 2l-1 for m = 2, 3
+  long NMAX = 2 * LMAX;
+  std::vector<long> order(NM);
+  std::vector<bool> odd(NM);
+  std::vector<complex<double> > coef(NM);
+  for (size_t k = 0; k < NM; ++k) {
+    long l = multipole_index_[k].first;
+    long m = multipole_index_[k].second;
+    if (l == 0) {
+      order[k] = 0;
+      odd[k] = false;
+      coef[k] = 1.0;
+    } else if (m < 2) {
+      order[k] = 2 * l;
+      odd[k] = (m == 1);
+      coef[k] = sqrt(0.5) * 2.0 * ((l % 2 == 0) ? 1.0 : -1.0);
+    } else {
+      order[k] = 2 * l - 1;
+      odd[k] = (m == 3);
+      coef[k] = complex<double>(0, 1.0) * sqrt(0.5) * 2.0 *
+                (((l - 1) % 2 == 0) ? 1.0 : -1.0);
+    }
+  }
+
+  std::vector<double> J(NMAX + 1);
+  std::vector<double> cosn(NMAX + 1);
+  std::vector<double> sinn(NMAX + 1);
+  std::vector<complex<double> > A(NM);
 
-  for (size_t fi = 0; fi < NMYF; ++fi) {
+  // normalize with integral over phi
+  double norm = sqrt(2 * M_PI);
+
+  for (size_t fi = first; fi < first + count; ++fi) {
     coor_t* p_data = &(p_coordinates[fi * NA * 3]);
 
-    complex<double> A = 0;
+    std::fill(A.begin(), A.end(), complex<double>(0));
     for (size_t j = 0; j < NA; ++j) {
       double r = p_data[3 * j];
       double phi = p_data[3 * j + 1];
       double z = p_data[3 * j + 2];
 
-      double esf = sfs[j];
-
       double parallel_sign = 1.0;
       if ((z != 0) && (qz != 0)) {
         parallel_sign = (z * qz) / (abs(z) * abs(qz));
       }
-
       complex<double> expi = exp(complex<double>(0, parallel_sign * z * qz));
-      double p = r * qr;
+      complex<double> base = expi * sfs[j];
+
+      smath::cyl_bessel_j_all(NMAX, r * qr, &(J[0]));
+
+      // Chebyshev recurrence of cos(n*psi) and sin(n*psi)
       double psiphi = phi - qphi;  // review this!
+      double c1 = cos(psiphi);
+      double s1 = sin(psiphi);
+      cosn[0] = 1.0;
+      sinn[0] = 0.0;
+      if (NMAX > 0) {
+        cosn[1] = c1;
+        sinn[1] = s1;
+      }
+      for (long n = 1; n < NMAX; ++n) {
+        cosn[n + 1] = 2 * c1 * cosn[n] - cosn[n - 1];
+        sinn[n + 1] = 2 * c1 * sinn[n] - sinn[n - 1];
+      }
 
-      if (m == 0 && l == 0) {
-        A += expi * (double)boost::math::cyl_bessel_j(0, p) * esf;
-      } else if (m == 0) {
-        // if func==1
-        complex<double> fac1 =
-            2.0 * powf(-1.0, l) * boost::math::cyl_bessel_j(2 * l, p);
-        A += sqrt(0.5) * fac1 * expi * cos(2 * l * psiphi) * esf;
-      } else if (m == 1) {
-        // if func==2
-        complex<double> fac1 =
-            2.0 * powf(-1.0, l) * boost::math::cyl_bessel_j(2 * l, p);
-        A += sqrt(0.5) * fac1 * expi * sin(2 * l * psiphi) * esf;
-      } else if (m == 2) {
-        // if func==3
-        complex<double> fac2 = complex<double>(0, 1.0) *
-                               double(2.0 * powf(-1.0, l - 1) *
-                                      boost::math::cyl_bessel_j(2 * l - 1, p));
-        A += sqrt(0.5) * fac2 * expi * cos((2 * l - 1) * psiphi) * esf;
-      } else if (m == 3) {
-        // if func==4
-        complex<double> fac2 = complex<double>(0, 1.0) *
-                               double(2.0 * powf(-1.0, l - 1) *
-                                      boost::math::cyl_bessel_j(2 * l - 1, p));
-        A += sqrt(0.5) * fac2 * expi * sin((2 * l - 1) * psiphi) * esf;
+      for (size_t k = 0; k < NM; ++k) {
+        long n = order[k];
+        double t = J[n] * (odd[k] ? sinn[n] : cosn[n]);
+        A[k] += coef[k] * (t * base);
       }
     }
-    // normalize with integral over phi
-    double norm = sqrt(2 * M_PI);
-    p_a[fi][0] = norm * A.real();
-    p_a[fi][1] = norm * A.imag();
-    //       cout << "l,m=" << l << "," << m <<  ", A=" << A << endl;
+    for (size_t k = 0; k < NM; ++k) {
+      amplitudes_[k * NMAXF + fi][0] = norm * A[k].real();
+      amplitudes_[k * NMAXF + fi][1] = norm * A[k].imag();
+    }
   }
 }
 
+void MPCylinderScatterDevice::scatter(size_t this_moment, fftw_complex* p_a) {
+  DivAssignment zeronode_assignment(partitioncomm_.size(), 0, NF);
+  size_t NMAXF = zeronode_assignment.max();
+  DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
+  size_t NMYF = assignment.size();
+
+  memcpy(p_a, &(amplitudes_[this_moment * NMAXF]),
+         NMYF * sizeof(fftw_complex));
+}
+
 // end of file
@@ -17,6 +17,7 @@ a pointer to the interface.
 #include "decomposition/decomposition_plan.hpp"
 #include "log.hpp"
 #include "scatter_devices/all_vectors_scatter_device.hpp"
+#include "scatter_devices/exact_scatter_device.hpp"
 #include "scatter_devices/multipole_scatter_device.hpp"
 #include "scatter_devices/self_vectors_scatter_device.hpp"
 
@@ -192,6 +193,13 @@ IScatterDevice* ScatterDeviceFactory::create(
             Params::Inst()->scattering.average.orientation.multipole.type);
         throw;
       }
+    } else if (Params::Inst()->scattering.average.orientation.type ==
+               "exact") {
+      if (scatter_comm.rank() == 0)
+        Info::Inst()->write("Initializing Scatter Device, Exact Sphere");
+      p_ScatterDevice = new ExactSphereScatterDevice(
+          all_comm, partition_comm, sample, thispartition_QIV, NAF,
+          fileservice_endpoint, monitorservice_endpoint);
     } else if (Params::Inst()->scattering.average.orientation.type == "none") {
       p_ScatterDevice = new AllVectorsScatterDevice(
           all_comm, partition_comm, sample, thispartition_QIV, NAF,
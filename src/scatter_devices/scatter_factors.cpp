@@ -26,7 +26,11 @@ factors which may depend on atom and q vector lengths.
 
 using namespace std;
 
-ScatterFactors::ScatterFactors() { m_background = true; }
+ScatterFactors::ScatterFactors() {
+  m_background = true;
+  p_sample = NULL;
+  p_selection = NULL;
+}
 
 void ScatterFactors::update_kappas() {
   // kappas fully map atoms
@@ -46,6 +50,76 @@ void ScatterFactors::update_kappas() {
       m_kappas[(*selection)[j]] = kappas[i].value;
     }
   }
+
+  init_species();
+}
+
+size_t ScatterFactors::register_species(size_t atomindex) {
+  std::pair<size_t, double> kind(p_sample->atoms[atomindex],
+                                 m_kappas[atomindex]);
+  std::map<std::pair<size_t, double>, size_t>::iterator found =
+      m_species_index.find(kind);
+  if (found != m_species_index.end()) return found->second;
+
+  size_t species = m_species_kinds.size();
+  m_species_index.insert(make_pair(kind, species));
+  m_species_kinds.push_back(kind);
+  return species;
+}
+
+void ScatterFactors::init_species() {
+  if ((p_sample == NULL) || (p_selection == NULL)) return;
+
+  m_species_index.clear();
+  m_species_kinds.clear();
+  m_selection_species.clear();
+
+  m_species.resize(p_selection->size());
+  for (size_t i = 0; i < p_selection->size(); ++i) {
+    m_species[i] = register_species((*p_selection)[i]);
+  }
+  m_species_factors.assign(m_species_kinds.size(), 0);
+}
+
+std::vector<std::pair<size_t, size_t> >& ScatterFactors::selection_species(
+    IAtomselection* selection) {
+  std::map<IAtomselection*, std::vector<std::pair<size_t, size_t> > >::
+      iterator found = m_selection_species.find(selection);
+  if (found != m_selection_species.end()) return found->second;
+
+  std::vector<size_t> counts;
+  for (size_t i = 0; i < selection->size(); ++i) {
+    size_t species = register_species((*selection)[i]);
+    if (species >= counts.size()) counts.resize(species + 1, 0);
+    counts[species]++;
+  }
+  std::vector<std::pair<size_t, size_t> >& result =
+      m_selection_species[selection];
+  for (size_t species = 0; species < counts.size(); ++species) {
+    if (counts[species] > 0) {
+      result.push_back(make_pair(species, counts[species]));
+    }
+  }
+  return result;
+}
+
+double ScatterFactors::species_factor(
+    size_t s, double ql, double background_sl,
+    DatabaseVolumesParameters& volumes,
+    DatabaseExlusionParameters& exclusionfactors,
+    DatabaseSFactorsParameters& sfactors) {
+  size_t atomID = m_species_kinds[s].first;
+  double sf = sfactors.get(atomID, ql);
+
+  // calculate effective scattering length:
+  if (m_background) {
+    double k = m_species_kinds[s].second;
+    double v = volumes.get(atomID);
+    double efactor = exclusionfactors.get(atomID, k * v, ql);
+
+    sf = sf - background_sl * efactor;
+  }
+  return sf;
 }
 
 void ScatterFactors::update(CartesianCoor3D q) {
@@ -58,29 +132,38 @@ void ScatterFactors::update(CartesianCoor3D q) {
     bl = this->compute_background(q, p_sel);
   }
   double background_sl = Params::Inst()->scattering.background.factor.value;
+  double ql = q.length();
 
-  for (size_t i = 0; i < p_selection->size(); ++i) {
-    size_t atomID = p_sample->atoms[(*p_selection)[i]];
-    double ql = q.length();
-    double sf = Database::Inst()->sfactors.get(atomID, ql);
-
-    // calculate effective scattering length:
-    if (m_background) {
-      double k = m_kappas[(*p_selection)[i]];
-      double v = Database::Inst()->volumes.get(atomID);
-      double efactor =
-          Database::Inst()->exclusionfactors.get(atomID, k * v, ql);
+  // all atoms of a species share the factor
+  Database* db = Database::Inst();
+  for (size_t s = 0; s < m_species_factors.size(); ++s) {
+    m_species_factors[s] = species_factor(s, ql, background_sl, db->volumes,
+                                          db->exclusionfactors, db->sfactors);
+  }
 
-      sf = sf - background_sl * efactor;
+  // the additional contrasts weight the same species
+  std::vector<ScatteringContrastParameters>& contrasts =
+      Params::Inst()->scattering.contrasts;
+  m_contrast_factors.resize(contrasts.size());
+  for (size_t c = 0; c < contrasts.size(); ++c) {
+    DatabaseContrastParameters& dbc = db->contrasts[c];
+    m_contrast_factors[c].resize(m_species_factors.size());
+    for (size_t s = 0; s < m_species_factors.size(); ++s) {
+      m_contrast_factors[c][s] =
+          species_factor(s, ql, contrasts[c].factor, dbc.volumes,
+                         dbc.exclusionfactors, dbc.sfactors);
     }
+  }
 
-    factors[i] = sf;
+  for (size_t i = 0; i < p_selection->size(); ++i) {
+    factors[i] = m_species_factors[m_species[i]];
   }
 }
 
 void ScatterFactors::set_selection(IAtomselection* selection) {
   factors.resize(selection->size());
   p_selection = selection;
+  init_species();
 }
 
 IAtomselection* ScatterFactors::get_selection() { return p_selection; }
@@ -98,6 +181,18 @@ double ScatterFactors::get(size_t atomselectionindex) {
 
 vector<double>& ScatterFactors::get_all() { return factors; }
 
+vector<size_t>& ScatterFactors::get_species() { return m_species; }
+
+size_t ScatterFactors::get_species_count() { return m_species_factors.size(); }
+
+vector<double>& ScatterFactors::get_species_factors() {
+  return m_species_factors;
+}
+
+vector<double>& ScatterFactors::get_contrast_factors(size_t c) {
+  return m_contrast_factors[c];
+}
+
 double ScatterFactors::compute_background(CartesianCoor3D q, IAtomselection* selection) {
   double efactor_sum = 0;
   double sf_sum = 0;
@@ -105,16 +200,18 @@ double ScatterFactors::compute_background(CartesianCoor3D q, IAtomselection* sel
   if(!selection){
     selection = p_selection;
   }
-  for (size_t i = 0; i < selection->size(); ++i) {
-    size_t atomID = p_sample->atoms[(*selection)[i]];
+  std::vector<std::pair<size_t, size_t> >& species =
+      selection_species(selection);
+  for (size_t i = 0; i < species.size(); ++i) {
+    size_t atomID = m_species_kinds[species[i].first].first;
     double sf = Database::Inst()->sfactors.get(atomID, ql);
 
-    double k = m_kappas[(*selection)[i]];
+    double k = m_species_kinds[species[i].first].second;
     double v = Database::Inst()->volumes.get(atomID);
     double efactor = Database::Inst()->exclusionfactors.get(atomID, k * v, ql);
 
-    efactor_sum += efactor;
-    sf_sum += sf;
+    efactor_sum += species[i].second * efactor;
+    sf_sum += species[i].second * sf;
   }
   return sf_sum / efactor_sum;
 }
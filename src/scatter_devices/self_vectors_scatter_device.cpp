@@ -24,6 +24,7 @@ scattering.
 #include "control.hpp"
 #include "log.hpp"
 #include "math/coor3d.hpp"
+#include "math/fft.hpp"
 #include "math/smath.hpp"
 #include "sample.hpp"
 #include "stager/data_stager.hpp"
@@ -41,11 +42,94 @@ SelfVectorsScatterDevice::SelfVectorsScatterDevice(
       assignment_(partitioncomm_.size(), partitioncomm_.rank(), NAF) {
   atfinal_ = NULL;
 
-  fftw_complex* wspace = NULL;
-  fftw_planF_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftw_planB_ =
-      fftw_plan_dft_1d(2 * NF, wspace, wspace, FFTW_BACKWARD, FFTW_ESTIMATE);
+  // the signals of one atom for consecutive vectors are transformed at once
+  batch_ = std::min(Params::Inst()->limits.computation.fft.batch, NM);
+
+  // a vector has NM signals, or a single one if q lies on the axis of a
+  // cylinder. Hence batches hold batch_, NM % batch_ or 1 signals.
+  smath::FFTPlanner* planner = smath::FFTPlanner::Inst();
+  if ((Params::Inst()->scattering.dsp.type == "autocorrelate") &&
+      (Params::Inst()->scattering.dsp.method == "fftw")) {
+    size_t counts[] = {batch_, NM % batch_, 1};
+    for (size_t i = 0; i < 3; ++i) {
+      if ((counts[i] == 0) || (fftw_planF_.count(counts[i]) > 0)) continue;
+      fftw_planF_[counts[i]] =
+          planner->complex_plan(2 * NF, FFTW_FORWARD, counts[i]);
+      fftw_planR_[counts[i]] = planner->real_plan(2 * NF, counts[i]);
+    }
+  }
+
+  fftw_planRsum_ = NULL;
+  if (Params::Inst()->scattering.dsp.accumulate == "frequency") {
+    fftw_planRsum_ = planner->real_plan(2 * NF);
+    init_weights();
+  }
+}
+
+void SelfVectorsScatterDevice::init_weights() {
+  // the mean of the auto-correlation is sum_t u(t) c(t), with the scaling u(t)
+  // of auto_correlate_power and c(t) the backward transform of the power
+  // spectrum P(w). hence it equals sum_w P(w) W(w), where W is the backward
+  // transform of u.
+  fftw_complex* wspace =
+      (fftw_complex*)fftw_malloc(2 * NF * sizeof(fftw_complex));
+  double* u = (double*)wspace;
+  for (size_t t = 0; t < 2 * NF; ++t) {
+    u[t] = (t < NF) ? 1.0 / (2 * NF * (NF - t) * NF) : 0.0;
+  }
+  fftw_execute_dft_r2c(fftw_planRsum_, u, wspace);
+
+  // u is real, hence W(w) = conj(U(w)) = U(2*NF-w)
+  weights_.resize(2 * NF);
+  for (size_t w = 0; w <= NF; ++w) {
+    weights_[w] = complex<double>(wspace[w][0], -wspace[w][1]);
+  }
+  for (size_t w = NF + 1; w < 2 * NF; ++w) {
+    weights_[w] = conj(weights_[2 * NF - w]);
+  }
+  fftw_free(wspace);
+}
+
+void SelfVectorsScatterDevice::transform_spectrum() {
+  // atfinal_ holds the 2*NF reals of the summed power spectrum
+  fftw_complex* wspace = scratch_.acquire();
+  memcpy(wspace, atfinal_, NF * sizeof(fftw_complex));
+  smath::auto_correlate_power(wspace, fftw_planRsum_, NF);
+  memcpy(atfinal_, wspace, NF * sizeof(fftw_complex));
+  scratch_.release(wspace);
+}
+
+void SelfVectorsScatterDevice::reserve_scratch() {
+  // one batch of signals per running task
+  scratch_.reserve(2 * NF * batch_, taskpool_->size());
+
+  // the map is complete before any task runs, workers only look it up
+  std::vector<boost::thread::id> ids = taskpool_->get_ids();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (accumulators_.find(ids[i]) != accumulators_.end()) continue;
+    Accumulator acc;
+    acc.at = (fftw_complex*)fftw_malloc(NF * sizeof(fftw_complex));
+    accumulators_.insert(make_pair(ids[i], acc));
+  }
+  clear_accumulators();
+}
+
+void SelfVectorsScatterDevice::clear_accumulators() {
+  std::map<boost::thread::id, Accumulator>::iterator it;
+  for (it = accumulators_.begin(); it != accumulators_.end(); ++it) {
+    memset(it->second.at, 0, NF * sizeof(fftw_complex));
+    it->second.a = 0;
+    it->second.a2 = 0;
+  }
+}
+
+void SelfVectorsScatterDevice::combine_accumulators() {
+  std::map<boost::thread::id, Accumulator>::iterator it;
+  for (it = accumulators_.begin(); it != accumulators_.end(); ++it) {
+    smath::add_elements(atfinal_, it->second.at, NF);
+    afinal_ += it->second.a;
+    a2final_ += it->second.a2;
+  }
 }
 
 void SelfVectorsScatterDevice::stage_data() {
@@ -58,15 +142,17 @@ void SelfVectorsScatterDevice::stage_data() {
 
 SelfVectorsScatterDevice::~SelfVectorsScatterDevice() {
   if (p_coordinates != NULL) {
-    free(p_coordinates);
+    StagedMemory::free(p_coordinates);
     p_coordinates = NULL;
   }
-  fftw_destroy_plan(fftw_planF_);
-  fftw_destroy_plan(fftw_planB_);
   if (atfinal_ != NULL) {
     fftw_free(atfinal_);
     atfinal_ = NULL;
   }
+  std::map<boost::thread::id, Accumulator>::iterator it;
+  for (it = accumulators_.begin(); it != accumulators_.end(); ++it) {
+    fftw_free(it->second.at);
+  }
 }
 
 bool SelfVectorsScatterDevice::ram_check() {
@@ -75,14 +161,24 @@ bool SelfVectorsScatterDevice::ram_check() {
 
   // total memory requirements during computation:
   // atfinal = NF
-  // at_ = NTHREADS*2*NF
+  // batch of signals of every running task = NTHREADS*batch*2*NF
+  // accumulator of every worker thread = NTHREADS*NF
 
   size_t NTHREADS = Params::Inst()->limits.computation.threads;
 
   size_t bytesize_signal_buffer = 0;
   size_t memscale = Params::Inst()->limits.computation.memory.scale;
 
-  bytesize_signal_buffer = 2 * NF * NTHREADS * sizeof(fftw_complex);
+  size_t batch = std::min(Params::Inst()->limits.computation.fft.batch, NM);
+  bytesize_signal_buffer = 2 * NF * batch * NTHREADS * sizeof(fftw_complex);
+  bytesize_signal_buffer += NF * NTHREADS * sizeof(fftw_complex);
+
+  // cached phase factors and steps
+  size_t bytesize_phase_buffer = 0;
+  if (Params::Inst()->limits.computation.phases.method == "recurrence") {
+    bytesize_phase_buffer =
+        2 * NM * assignment_.size() * 2 * NF * sizeof(double);
+  }
 
   if (bytesize_signal_buffer >
       memscale * Params::Inst()->limits.computation.memory.signal_buffer) {
@@ -100,6 +196,22 @@ bool SelfVectorsScatterDevice::ram_check() {
     }
     state = false;
   }
+  if (bytesize_phase_buffer >
+      memscale * Params::Inst()->limits.computation.memory.phase_buffer) {
+    if (allcomm_.rank() == 0) {
+      Err::Inst()->write("limits.computation.memory.phase_buffer too small");
+      Err::Inst()->write(
+          string("limits.computation.memory.phase_buffer=") +
+          boost::lexical_cast<string>(
+              Params::Inst()->limits.computation.memory.phase_buffer));
+      Err::Inst()->write(string("limits.computation.memory.scale=") +
+                         boost::lexical_cast<string>(
+                             Params::Inst()->limits.computation.memory.scale));
+      Err::Inst()->write(string("requested: ") +
+                         boost::lexical_cast<string>(bytesize_phase_buffer));
+    }
+    state = false;
+  }
 
   // final buffer for reduction:
   // NF*sizeof(fftw_complex)
@@ -110,23 +222,39 @@ bool SelfVectorsScatterDevice::ram_check() {
     Info::Inst()->write(
         string("required limits.computation.memory.signal_buffer=") +
         boost::lexical_cast<string>(bytesize_signal_buffer));
+    Info::Inst()->write(
+        string("required limits.computation.memory.phase_buffer=") +
+        boost::lexical_cast<string>(bytesize_phase_buffer));
   }
   return state;
 }
-void SelfVectorsScatterDevice::dsp(fftw_complex* at) {
+void SelfVectorsScatterDevice::dsp(fftw_complex* at, size_t count,
+                                   fftw_plan planF, fftw_plan planR) {
   // correlate or sum up
   if (Params::Inst()->scattering.dsp.type == "autocorrelate") {
     if (Params::Inst()->scattering.dsp.method == "direct") {
-      smath::auto_correlate_direct(at, NF);
+      for (size_t k = 0; k < count; ++k) {
+        fftw_complex* signal = &(at[k * 2 * NF]);
+        smath::auto_correlate_direct(signal, NF, &(signal[NF]),
+                                     Params::Inst()->scattering.dsp.max_lag,
+                                     simd_);
+      }
     } else if (Params::Inst()->scattering.dsp.method == "fftw") {
-      smath::auto_correlate_fftw(at, fftw_planF_, fftw_planB_, NF);
+      // all signals of the batch pass the transforms together
+      if (Params::Inst()->scattering.dsp.accumulate == "frequency") {
+        smath::power_spectrum_fftw(at, planF, NF, count);
+      } else {
+        smath::auto_correlate_fftw_r2c(at, planF, planR, NF, count);
+      }
     } else {
       Err::Inst()->write("Correlation method not understood");
       Err::Inst()->write("scattering.dsp.method == direct, fftw");
       throw;
     }
   } else if (Params::Inst()->scattering.dsp.type == "square") {
-    smath::square_elements(at, NF);
+    for (size_t k = 0; k < count; ++k) {
+      smath::square_elements(&(at[k * 2 * NF]), NF);
+    }
   } else if (!(Params::Inst()->scattering.dsp.type == "plain")) {
     Err::Inst()->write(string("DSP type not understood: ") +
                        Params::Inst()->scattering.dsp.type);
@@ -135,11 +263,29 @@ void SelfVectorsScatterDevice::dsp(fftw_complex* at) {
   }
 }
 
-void SelfVectorsScatterDevice::store(fftw_complex* at) {
-  complex<double> a = smath::reduce<double>(at, NF) * (1.0 / NF);
-  afinal_ += a;
-  a2final_ += a * conj(a);
-  smath::add_elements(atfinal_, at, NF);
+void SelfVectorsScatterDevice::store(fftw_complex* at, size_t count) {
+  // sum up the batch locally, then add it to the accumulator of this thread
+  complex<double> a(0);
+  complex<double> a2(0);
+  bool frequency = (Params::Inst()->scattering.dsp.accumulate == "frequency");
+  for (size_t k = 0; k < count; ++k) {
+    fftw_complex* signal = &(at[k * 2 * NF]);
+    complex<double> ak;
+    if (frequency) {
+      // the first 2*NF reals hold the power spectrum
+      double* power = (double*)signal;
+      for (size_t w = 0; w < 2 * NF; ++w) ak += power[w] * weights_[w];
+    } else {
+      ak = smath::reduce<double>(signal, NF) * (1.0 / NF);
+    }
+    a += ak;
+    a2 += ak * conj(ak);
+    if (k > 0) smath::add_elements(at, signal, NF);
+  }
+  Accumulator& acc = accumulators_.find(boost::this_thread::get_id())->second;
+  acc.a += a;
+  acc.a2 += a2;
+  smath::add_elements(acc.at, at, NF);
 }
 
 void SelfVectorsScatterDevice::compute() {
@@ -151,6 +297,11 @@ void SelfVectorsScatterDevice::compute() {
   init_subvectors(q);
   scatterfactors.update(q);  // scatter factors only dependent on length of q,
                              // hence we can do it once before the loop
+  init_phaseupdate();
+  if (phaseupdate_ != PHASES_EXACT) {
+    phases_.resize(NM * assignment_.size() * 2 * NF);
+    steps_.resize(NM * assignment_.size() * 2 * NF);
+  }
   timer.stop("sd:c:init");
 
   current_subvector_ = 0;
@@ -159,40 +310,26 @@ void SelfVectorsScatterDevice::compute() {
   afinal_ = 0;
   a2final_ = 0;
 
-  size_t NTHREADS = worker_threads.size();
   size_t NNPP = partitioncomm_.size();
-  at_ = (fftw_complex*)fftw_malloc(2 * NF * NTHREADS * sizeof(fftw_complex));
-  memset(at_, 0, 2 * NF * NTHREADS * sizeof(fftw_complex));
 
+  // the signals of an atom are scattered and post-processed in batches of
+  // consecutive vectors. Every pair of atom and batch is a task, which keeps
+  // all threads busy even for a single vector.
   timer.start("sd:c:block");
+  clear_accumulators();
   for (size_t n = 0; n < assignment_.size(); ++n) {
-    current_subvector_ = 0;
-    for (size_t i = 0; i < NM; i += NTHREADS) {
-      timer.start("sd:c:b:scatter");
-      scatterblock(n, i, std::min(NTHREADS, NM - i));
-      timer.stop("sd:c:b:scatter");
-
-      timer.start("sd:c:b:dspstore");
-      for (size_t j = 0; j < std::min(NTHREADS, NM - i); ++j) {
-        size_t offset = ((j + i) % NTHREADS) * 2 * NF;
-        fftw_complex* pat = &(at_[offset]);
-        dsp(pat);
-        store(pat);
-      }
-      timer.stop("sd:c:b:dspstore");
-
-      current_subvector_ += std::min(NTHREADS, NM - i);
-
-      timer.start("sd:c:b:progress");
-      p_monitor_->update(allcomm_.rank(), progress());
-      timer.stop("sd:c:b:progress");
+    for (size_t i = 0; i < NM; i += batch_) {
+      size_t count = std::min(batch_, NM - i);
+      taskpool_->submit(
+          boost::bind(&SelfVectorsScatterDevice::task_scatter_dspstore, this,
+                      i, count, n, plan(fftw_planF_, count),
+                      plan(fftw_planR_, count)));
     }
-    current_atomindex_ += 1;
   }
+  wait_for_tasks();
+  combine_accumulators();
   timer.stop("sd:c:block");
 
-  fftw_free(at_);
-
   timer.start("sd:c:wait");
   partitioncomm_.barrier();
   timer.stop("sd:c:wait");
@@ -232,6 +369,13 @@ void SelfVectorsScatterDevice::compute() {
   }
   timer.stop("sd:c:reduce");
 
+  if ((Params::Inst()->scattering.dsp.accumulate == "frequency") &&
+      (partitioncomm_.rank() == 0)) {
+    timer.start("sd:c:transform");
+    transform_spectrum();
+    timer.stop("sd:c:transform");
+  }
+
   double factor = 1.0 / subvector_index_.size();
   if (partitioncomm_.rank() == 0) {
     smath::multiply_elements(factor, atfinal_, NF);
@@ -240,67 +384,98 @@ void SelfVectorsScatterDevice::compute() {
   }
 }
 
-void SelfVectorsScatterDevice::scatterblock(size_t atomindex, size_t index,
-                                            size_t count) {
-  size_t SCATTERBLOCK = worker_threads.size();
+fftw_plan SelfVectorsScatterDevice::plan(
+    const std::map<size_t, fftw_plan>& plans, size_t count) {
+  std::map<size_t, fftw_plan>::const_iterator pi = plans.find(count);
+  return (pi != plans.end()) ? pi->second : NULL;
+}
 
-  //    cerr << "loop w/ index=" << index << " , count=" << count << endl;
-  //    sleep(3);
-  for (size_t i = 0; i < count; ++i) {
-    atscatter_.push(std::make_pair(index + i, atomindex));
+void SelfVectorsScatterDevice::task_scatter_dspstore(size_t mi, size_t count,
+                                                     size_t ai,
+                                                     fftw_plan planF,
+                                                     fftw_plan planR) {
+  Timer& timer = timer_[boost::this_thread::get_id()];
 
-    if (((i + 1) % SCATTERBLOCK) == 0) {
-      workerbarrier->wait();
-    }
-  }
+  // double allocate (2*NF) every signal, to allow direct application of
+  // autocorrelation.
+  fftw_complex* at = scratch_.acquire();
 
-  if ((count % SCATTERBLOCK) != 0) {
-    size_t rest = SCATTERBLOCK - (count % SCATTERBLOCK);
-    for (size_t i = 0; i < rest; ++i) {
-      atscatter_.push(std::make_pair(
-          NM, atomindex));  // NM will be ignored, but triggers a barrier
-    }
-    workerbarrier->wait();
+  timer.start("sd:worker:scatter");
+  for (size_t k = 0; k < count; ++k) {
+    scatter(mi + k, ai, &(at[k * 2 * NF]));
   }
-}
+  timer.stop("sd:worker:scatter");
 
-void SelfVectorsScatterDevice::worker() {
-  workerbarrier->wait();
+  timer.start("sd:worker:dspstore");
+  dsp(at, count, planF, planR);
+  store(at, count);
+  timer.stop("sd:worker:dspstore");
 
-  Timer& timer = timer_[boost::this_thread::get_id()];
-
-  while (true) {
-    std::pair<size_t, size_t> vectoratom;
-    timer.start("sd:worker:wait");
-    atscatter_.wait_and_pop(vectoratom);
-    timer.stop("sd:worker:wait");
+  scratch_.release(at);
 
-    if (vectoratom.first < NM) {
-      timer.start("sd:worker:scatter");
-      scatter(vectoratom.first, vectoratom.second);
-      timer.stop("sd:worker:scatter");
-    }
-
-    workerbarrier->wait();
+  // progress counts completed pairs of atom and vector
+  boost::mutex::scoped_lock lock(store_mutex_);
+  current_subvector_ += count;
+  while (current_subvector_ >= NM) {
+    current_subvector_ -= NM;
+    current_atomindex_++;
   }
 }
 
-fftw_complex* SelfVectorsScatterDevice::scatter(size_t mi, size_t ai) {
+void SelfVectorsScatterDevice::scatter(size_t mi, size_t ai,
+                                       fftw_complex* p_at_local) {
   // this is broken <-- revise this!!!
   double s = scatterfactors.get(assignment_[ai]);
 
-  // double allocate (2*NF), to allow direct application of autocorrelation.
-  size_t NTHREADS = worker_threads.size();
-  size_t offset = (mi % NTHREADS) * 2 * NF;
-
-  fftw_complex* p_at_local = &(at_[offset]);
-
   double qx = subvector_index_[mi].x;
   double qy = subvector_index_[mi].y;
   double qz = subvector_index_[mi].z;
 
   coor_t* p_data = &(p_coordinates[ai * NF * 3]);
 
+  if (phaseupdate_ != PHASES_EXACT) {
+    size_t poffset = (mi * assignment_.size() + ai) * 2 * NF;
+    double* p_re = &(phases_[poffset]);
+    double* p_im = &(phases_[poffset + NF]);
+    double* p_sre = &(steps_[poffset]);
+    double* p_sim = &(steps_[poffset + NF]);
+
+    if (phaseupdate_ == PHASES_SEED) {
+      for (size_t j = 0; j < NF; ++j) {
+        double p1 = p_data[j * 3] * qx + p_data[j * 3 + 1] * qy +
+                    p_data[j * 3 + 2] * qz;
+        p_re[j] = cos(p1);
+        p_im[j] = sin(p1);
+      }
+    } else {
+      if (phaseupdate_ == PHASES_RESTEP) {
+        double dqx = step_subvectors_[mi].x;
+        double dqy = step_subvectors_[mi].y;
+        double dqz = step_subvectors_[mi].z;
+        for (size_t j = 0; j < NF; ++j) {
+          double p1 = p_data[j * 3] * dqx + p_data[j * 3 + 1] * dqy +
+                      p_data[j * 3 + 2] * dqz;
+          p_sre[j] = cos(p1);
+          p_sim[j] = sin(p1);
+        }
+      }
+      for (size_t j = 0; j < NF; ++j) {
+        double r = p_re[j] * p_sre[j] - p_im[j] * p_sim[j];
+        double i = p_re[j] * p_sim[j] + p_im[j] * p_sre[j];
+        p_re[j] = r;
+        p_im[j] = i;
+      }
+    }
+
+    for (size_t j = 0; j < NF; ++j) {
+      p_at_local[j][0] = s * p_re[j];
+      p_at_local[j][1] = s * p_im[j];
+    }
+    memset(&p_at_local[NF], 0, NF * sizeof(fftw_complex));
+
+    return;
+  }
+
   for (size_t j = 0; j < NF; ++j) {
     coor_t x1 = p_data[j * 3];
     coor_t y1 = p_data[j * 3 + 1];
@@ -314,8 +489,6 @@ fftw_complex* SelfVectorsScatterDevice::scatter(size_t mi, size_t ai) {
   }
 
   memset(&p_at_local[NF], 0, NF * sizeof(fftw_complex));
-
-  return p_at_local;
 }
 
 double SelfVectorsScatterDevice::progress() {
@@ -323,6 +496,8 @@ double SelfVectorsScatterDevice::progress() {
   double scale2 = 1.0 / assignment_.size();
   double scale3 = 1.0 / subvector_index_.size();
 
+  // the counters are advanced by the workers in task_scatter_dspstore
+  boost::mutex::scoped_lock lock(store_mutex_);
   double base1 = current_vector_ * scale1;
   double base2 = current_atomindex_ * scale1 * scale2;
   double base3 = current_subvector_ * scale1 * scale2 * scale3;
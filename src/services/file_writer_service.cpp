@@ -36,17 +36,36 @@ void HDF5WriterService::init(size_t nf) {
           "Error when testing for HDF5 character of data file. aborting...");
       throw;
     }
+    init_contrasts(nf);
   } else {
     init_new(nf);
   }
 }
 
+void HDF5WriterService::init_contrasts(size_t nf) {
+  // files of a previous run may lack the groups of the contrasts. they only
+  // receive the vectors computed from now on.
+  hid_t h5file = H5Fopen(m_filename.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  std::vector<ScatteringContrastParameters>& contrasts =
+      Params::Inst()->scattering.contrasts;
+  for (size_t c = 0; c < contrasts.size(); ++c) {
+    const char* name = contrasts[c].name.c_str();
+    if (H5Lexists(h5file, name, H5P_DEFAULT) > 0) continue;
+    Warn::Inst()->write(string("Adding group for contrast to signal file: ") +
+                        contrasts[c].name);
+    hid_t group =
+        H5Gcreate(h5file, name, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    create_datasets(group, nf);
+    H5Gclose(group);
+  }
+  H5Fclose(h5file);
+}
+
 void HDF5WriterService::init_new(size_t nf) {
   const string filename = m_filename;
   hid_t h5file =
       H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
 
-  double fill_val_double = 0;
   // store the carbon copy of the configuration file
   {
     hid_t metagroup =
@@ -67,6 +86,23 @@ void HDF5WriterService::init_new(size_t nf) {
     H5Gclose(metagroup);
   }
 
+  create_datasets(h5file, nf);
+
+  // every contrast has its own set of datasets
+  std::vector<ScatteringContrastParameters>& contrasts =
+      Params::Inst()->scattering.contrasts;
+  for (size_t c = 0; c < contrasts.size(); ++c) {
+    hid_t group = H5Gcreate(h5file, contrasts[c].name.c_str(), H5P_DEFAULT,
+                            H5P_DEFAULT, H5P_DEFAULT);
+    create_datasets(group, nf);
+    H5Gclose(group);
+  }
+
+  H5Fclose(h5file);
+}
+
+void HDF5WriterService::create_datasets(hid_t loc, size_t nf) {
+  double fill_val_double = 0;
   {
     // qvectors
     hsize_t dims[2];
@@ -85,7 +121,7 @@ void HDF5WriterService::init_new(size_t nf) {
     H5Pset_fill_value(dcpl, H5T_NATIVE_DOUBLE, &fill_val_double);
     H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_DEFAULT);
     hid_t dspace = H5Screate_simple(2, dims, mdims);
-    hid_t ds = H5Dcreate(h5file, "qvectors", H5T_NATIVE_DOUBLE, dspace, lcpl,
+    hid_t ds = H5Dcreate(loc, "qvectors", H5T_NATIVE_DOUBLE, dspace, lcpl,
                          dcpl, dapl);
     H5Pclose(lcpl);
     H5Pclose(dcpl);
@@ -119,7 +155,7 @@ void HDF5WriterService::init_new(size_t nf) {
     H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_DEFAULT);
     hid_t dspace = H5Screate_simple(3, dims, mdims);
     hid_t ds =
-        H5Dcreate(h5file, "fqt", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
+        H5Dcreate(loc, "fqt", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
     H5Pclose(lcpl);
     H5Pclose(dcpl);
     H5Pclose(dapl);
@@ -145,7 +181,7 @@ void HDF5WriterService::init_new(size_t nf) {
     H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_DEFAULT);
     hid_t dspace = H5Screate_simple(2, dims, mdims);
     hid_t ds =
-        H5Dcreate(h5file, "fq0", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
+        H5Dcreate(loc, "fq0", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
     H5Pclose(lcpl);
     H5Pclose(dcpl);
     H5Pclose(dapl);
@@ -171,7 +207,7 @@ void HDF5WriterService::init_new(size_t nf) {
     H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_DEFAULT);
     hid_t dspace = H5Screate_simple(2, dims, mdims);
     hid_t ds =
-        H5Dcreate(h5file, "fq", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
+        H5Dcreate(loc, "fq", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
     H5Pclose(lcpl);
     H5Pclose(dcpl);
     H5Pclose(dapl);
@@ -197,15 +233,13 @@ void HDF5WriterService::init_new(size_t nf) {
     H5Pset_alloc_time(dcpl, H5D_ALLOC_TIME_DEFAULT);
     hid_t dspace = H5Screate_simple(2, dims, mdims);
     hid_t ds =
-        H5Dcreate(h5file, "fq2", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
+        H5Dcreate(loc, "fq2", H5T_NATIVE_DOUBLE, dspace, lcpl, dcpl, dapl);
     H5Pclose(lcpl);
     H5Pclose(dcpl);
     H5Pclose(dapl);
     H5Sclose(dspace);
     H5Dclose(ds);
   }
-
-  H5Fclose(h5file);
 }
 
 bool HDF5WriterService::test_fqt_dim(size_t nf) {
@@ -258,6 +292,7 @@ HDF5WriterService::HDF5WriterService(boost::asio::io_service& io_service,
   m_filename = filename;
   m_listener = NULL;
   m_listener_status = false;
+  m_buffers.resize(1 + Params::Inst()->scattering.contrasts.size());
   // initialize and check file
   init(nf);
 
@@ -296,8 +331,12 @@ void HDF5WriterService::listener() {
         CartesianCoor3D qvector;
         boost::asio::read(
             socket, boost::asio::buffer(&qvector, sizeof(CartesianCoor3D)));
+        size_t contrast;
+        boost::asio::read(socket,
+                          boost::asio::buffer(&contrast, sizeof(size_t)));
+        HDF5DataBuffer& buffer = m_buffers[contrast];
 
-        data_qvectors.push_back(qvector);
+        buffer.qvectors.push_back(qvector);
 
         if (Params::Inst()->scattering.signal.fqt) {
           boost::asio::read(socket, boost::asio::buffer(&size, sizeof(size_t)));
@@ -306,28 +345,28 @@ void HDF5WriterService::listener() {
           double* p_doubledata = (double*)&((*p_data)[0]);
           boost::asio::read(
               socket, boost::asio::buffer(p_doubledata, sizeof(double) * size));
-          data_fqt.push_back(p_data);
+          buffer.fqt.push_back(p_data);
         }
         if (Params::Inst()->scattering.signal.fq0) {
           std::complex<double> fq0;
           double* p_fq0 = (double*)&fq0;
           boost::asio::read(socket,
                             boost::asio::buffer(p_fq0, sizeof(double) * 2));
-          data_fq0.push_back(fq0);
+          buffer.fq0.push_back(fq0);
         }
         if (Params::Inst()->scattering.signal.fq) {
           std::complex<double> fq;
           double* p_fq = (double*)&fq;
           boost::asio::read(socket,
                             boost::asio::buffer(p_fq, sizeof(double) * 2));
-          data_fq.push_back(fq);
+          buffer.fq.push_back(fq);
         }
         if (Params::Inst()->scattering.signal.fq2) {
           std::complex<double> fq;
           double* p_fq = (double*)&fq;
           boost::asio::read(socket,
                             boost::asio::buffer(p_fq, sizeof(double) * 2));
-          data_fq2.push_back(fq);
+          buffer.fq2.push_back(fq);
         }
       }
     }
@@ -340,9 +379,12 @@ void HDF5WriterService::listener() {
     }
 
     // use size from above. works since all elements have same size
-    size_t data_bytesize = (sizeof(double) * 2 * size) * data_fqt.size();
-    data_bytesize += (sizeof(double) * 3) * data_qvectors.size();
-    data_bytesize += (sizeof(double) * 2) * data_fq.size();
+    size_t data_bytesize = 0;
+    for (size_t c = 0; c < m_buffers.size(); ++c) {
+      data_bytesize += (sizeof(double) * 2 * size) * m_buffers[c].fqt.size();
+      data_bytesize += (sizeof(double) * 3) * m_buffers[c].qvectors.size();
+      data_bytesize += (sizeof(double) * 2) * m_buffers[c].fq.size();
+    }
 
     if (data_bytesize > Params::Inst()->limits.services.signal.memory.server) {
       flush();
@@ -358,17 +400,32 @@ void HDF5WriterService::flush() {
   m_lastflush = boost::posix_time::second_clock::universal_time();
 
   hid_t h5file = H5Fopen(m_filename.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
-  if (data_qvectors.size() > 0) {
-    size_t nq = data_qvectors.size();
+  flush(h5file, m_buffers[0]);
+
+  // init() made sure that every contrast has its group
+  std::vector<ScatteringContrastParameters>& contrasts =
+      Params::Inst()->scattering.contrasts;
+  for (size_t c = 0; c < contrasts.size(); ++c) {
+    hid_t group = H5Gopen(h5file, contrasts[c].name.c_str(), H5P_DEFAULT);
+    flush(group, m_buffers[c + 1]);
+    H5Gclose(group);
+  }
 
-    if (H5LTfind_dataset(h5file, "qvectors") == 1) {
+  H5Fclose(h5file);
+}
+
+void HDF5WriterService::flush(hid_t loc, HDF5DataBuffer& buffer) {
+  if (buffer.qvectors.size() > 0) {
+    size_t nq = buffer.qvectors.size();
+
+    if (H5LTfind_dataset(loc, "qvectors") == 1) {
       hsize_t dims[2];
       hsize_t start[2];
       hsize_t count[2];
-      H5LTget_dataset_info(h5file, "qvectors", dims, NULL, NULL);
+      H5LTget_dataset_info(loc, "qvectors", dims, NULL, NULL);
 
       dims[0] += nq;
-      hid_t ds = H5Dopen(h5file, "qvectors", H5P_DEFAULT);
+      hid_t ds = H5Dopen(loc, "qvectors", H5P_DEFAULT);
       H5Dset_extent(ds, dims);
       hid_t dspace = H5Dget_space(ds);
 
@@ -377,7 +434,7 @@ void HDF5WriterService::flush() {
       mdims[1] = 3;
       hid_t mspace = H5Screate_simple(2, mdims, NULL);
 
-      start[0] = dims[0] - data_qvectors.size();
+      start[0] = dims[0] - buffer.qvectors.size();
       start[1] = 0;
       count[0] = nq;
       count[1] = 3;
@@ -388,29 +445,29 @@ void HDF5WriterService::flush() {
       count[1] = 3;
       H5Sselect_hyperslab(mspace, H5S_SELECT_SET, start, NULL, count, NULL);
 
-      double* p_data = reinterpret_cast<double*>(&data_qvectors[0]);
+      double* p_data = reinterpret_cast<double*>(&buffer.qvectors[0]);
       H5Dwrite(ds, H5T_NATIVE_DOUBLE, mspace, dspace, H5P_DEFAULT, p_data);
     }
   }
-  data_qvectors.clear();
+  buffer.qvectors.clear();
 
-  if (data_fqt.size() > 0) {
-    size_t nq = data_fqt.size();
-    size_t nf = data_fqt[0]->size();
+  if (buffer.fqt.size() > 0) {
+    size_t nq = buffer.fqt.size();
+    size_t nf = buffer.fqt[0]->size();
 
-    if (H5LTfind_dataset(h5file, "fqt") == 1) {
+    if (H5LTfind_dataset(loc, "fqt") == 1) {
       double* p_fqtdata = (double*)malloc(sizeof(double) * 2 * nq * nf);
       for (size_t i = 0; i < nq; ++i) {
-        memcpy(&p_fqtdata[i * nf * 2], &((*data_fqt[i])[0]),
+        memcpy(&p_fqtdata[i * nf * 2], &((*buffer.fqt[i])[0]),
                sizeof(double) * 2 * nf);
       }
       hsize_t dims[3];
       hsize_t start[3];
       hsize_t count[3];
-      H5LTget_dataset_info(h5file, "fqt", dims, NULL, NULL);
+      H5LTget_dataset_info(loc, "fqt", dims, NULL, NULL);
 
       dims[0] += nq;
-      hid_t ds = H5Dopen(h5file, "fqt", H5P_DEFAULT);
+      hid_t ds = H5Dopen(loc, "fqt", H5P_DEFAULT);
       H5Dset_extent(ds, dims);
       hid_t dspace = H5Dget_space(ds);
 
@@ -440,20 +497,20 @@ void HDF5WriterService::flush() {
       free(p_fqtdata);
     }
   }
-  for (size_t i = 0; i < data_fqt.size(); ++i) delete data_fqt[i];
-  data_fqt.clear();
+  for (size_t i = 0; i < buffer.fqt.size(); ++i) delete buffer.fqt[i];
+  buffer.fqt.clear();
 
-  if (data_fq0.size() > 0) {
-    size_t nq = data_fq0.size();
+  if (buffer.fq0.size() > 0) {
+    size_t nq = buffer.fq0.size();
 
-    if (H5LTfind_dataset(h5file, "fq0") == 1) {
+    if (H5LTfind_dataset(loc, "fq0") == 1) {
       hsize_t dims[2];
       hsize_t start[2];
       hsize_t count[2];
-      H5LTget_dataset_info(h5file, "fq0", dims, NULL, NULL);
+      H5LTget_dataset_info(loc, "fq0", dims, NULL, NULL);
 
       dims[0] += nq;
-      hid_t ds = H5Dopen(h5file, "fq0", H5P_DEFAULT);
+      hid_t ds = H5Dopen(loc, "fq0", H5P_DEFAULT);
       H5Dset_extent(ds, dims);
 
       hid_t dspace = H5Dget_space(ds);
@@ -474,24 +531,24 @@ void HDF5WriterService::flush() {
       count[0] = nq;
       count[1] = 2;
       H5Sselect_hyperslab(mspace, H5S_SELECT_SET, start, NULL, count, NULL);
-      double* p_data = reinterpret_cast<double*>(&data_fq0[0]);
+      double* p_data = reinterpret_cast<double*>(&buffer.fq0[0]);
 
       H5Dwrite(ds, H5T_NATIVE_DOUBLE, mspace, dspace, H5P_DEFAULT, p_data);
     }
   }
-  data_fq0.clear();
+  buffer.fq0.clear();
 
-  if (data_fq.size() > 0) {
-    size_t nq = data_fq.size();
+  if (buffer.fq.size() > 0) {
+    size_t nq = buffer.fq.size();
 
-    if (H5LTfind_dataset(h5file, "fq") == 1) {
+    if (H5LTfind_dataset(loc, "fq") == 1) {
       hsize_t dims[2];
       hsize_t start[2];
       hsize_t count[2];
-      H5LTget_dataset_info(h5file, "fq", dims, NULL, NULL);
+      H5LTget_dataset_info(loc, "fq", dims, NULL, NULL);
 
       dims[0] += nq;
-      hid_t ds = H5Dopen(h5file, "fq", H5P_DEFAULT);
+      hid_t ds = H5Dopen(loc, "fq", H5P_DEFAULT);
       H5Dset_extent(ds, dims);
 
       hid_t dspace = H5Dget_space(ds);
@@ -512,24 +569,24 @@ void HDF5WriterService::flush() {
       count[0] = nq;
       count[1] = 2;
       H5Sselect_hyperslab(mspace, H5S_SELECT_SET, start, NULL, count, NULL);
-      double* p_data = reinterpret_cast<double*>(&data_fq[0]);
+      double* p_data = reinterpret_cast<double*>(&buffer.fq[0]);
 
       H5Dwrite(ds, H5T_NATIVE_DOUBLE, mspace, dspace, H5P_DEFAULT, p_data);
     }
   }
-  data_fq.clear();
+  buffer.fq.clear();
 
-  if (data_fq2.size() > 0) {
-    size_t nq = data_fq2.size();
+  if (buffer.fq2.size() > 0) {
+    size_t nq = buffer.fq2.size();
 
-    if (H5LTfind_dataset(h5file, "fq2") == 1) {
+    if (H5LTfind_dataset(loc, "fq2") == 1) {
       hsize_t dims[2];
       hsize_t start[2];
       hsize_t count[2];
-      H5LTget_dataset_info(h5file, "fq2", dims, NULL, NULL);
+      H5LTget_dataset_info(loc, "fq2", dims, NULL, NULL);
 
       dims[0] += nq;
-      hid_t ds = H5Dopen(h5file, "fq2", H5P_DEFAULT);
+      hid_t ds = H5Dopen(loc, "fq2", H5P_DEFAULT);
       H5Dset_extent(ds, dims);
 
       hid_t dspace = H5Dget_space(ds);
@@ -550,14 +607,13 @@ void HDF5WriterService::flush() {
       count[0] = nq;
       count[1] = 2;
       H5Sselect_hyperslab(mspace, H5S_SELECT_SET, start, NULL, count, NULL);
-      double* p_data = reinterpret_cast<double*>(&data_fq2[0]);
+      double* p_data = reinterpret_cast<double*>(&buffer.fq2[0]);
 
       H5Dwrite(ds, H5T_NATIVE_DOUBLE, mspace, dspace, H5P_DEFAULT, p_data);
     }
   }
-  data_fq2.clear();
+  buffer.fq2.clear();
 
-  H5Fclose(h5file);
 }
 
 void HDF5WriterService::hangup() {
@@ -577,7 +633,8 @@ void HDF5WriterService::hangup() {
 
 void HDF5WriterClient::write(CartesianCoor3D qvector, const fftw_complex* data,
                              size_t NF, const std::complex<double> data2,
-                             const std::complex<double> data3) {
+                             const std::complex<double> data3,
+                             size_t contrast) {
   if (!Params::Inst()->debug.iowrite.write) return;
 
   std::vector<std::complex<double> >* p_data =
@@ -587,6 +644,7 @@ void HDF5WriterClient::write(CartesianCoor3D qvector, const fftw_complex* data,
   }
   HDF5DataEntry de;
   de.qvector = qvector;
+  de.contrast = contrast;
   de.p_fqt = p_data;
   de.fq = data2;
   de.fq2 = data3;
@@ -615,7 +673,8 @@ void HDF5WriterClient::write(CartesianCoor3D qvector, const fftw_complex* data,
 void HDF5WriterClient::write(CartesianCoor3D qvector,
                              const std::vector<std::complex<double> >& data,
                              const std::complex<double> data2,
-                             const std::complex<double> data3) {
+                             const std::complex<double> data3,
+                             size_t contrast) {
   if (!Params::Inst()->debug.iowrite.write) return;
 
   std::vector<std::complex<double> >* p_data =
@@ -624,6 +683,7 @@ void HDF5WriterClient::write(CartesianCoor3D qvector,
 
   HDF5DataEntry de;
   de.qvector = qvector;
+  de.contrast = contrast;
   de.p_fqt = p_data;
   de.fq = data2;
   de.fq2 = data3;
@@ -672,6 +732,8 @@ void HDF5WriterClient::flush() {
 
         boost::asio::write(socket, boost::asio::buffer(
                                        &(de.qvector), sizeof(CartesianCoor3D)));
+        boost::asio::write(socket,
+                           boost::asio::buffer(&(de.contrast), sizeof(size_t)));
         if (Params::Inst()->scattering.signal.fqt) {
           boost::asio::write(socket,
                              boost::asio::buffer(&size, sizeof(size_t)));
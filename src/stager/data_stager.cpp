@@ -26,11 +26,84 @@ distributes the trajectory to any other partition.
 #include "control.hpp"
 #include "log.hpp"
 #include "math/coor3d.hpp"
+#include "mpi/wrapper.hpp"
 #include "sample.hpp"
 #include "stager/coordinate_writer.hpp"
 
 using namespace std;
 
+std::map<coor_t*, StagedMemory::Window>& StagedMemory::windows() {
+  static std::map<coor_t*, Window> windows;
+  return windows;
+}
+
+boost::mpi::communicator StagedMemory::share_communicator(
+    boost::mpi::communicator& allcomm,
+    boost::mpi::communicator& partitioncomm) {
+  if (!Params::Inst()->limits.stage.memory.shared) {
+    return boost::mpi::communicator(MPI_COMM_SELF,
+                                    boost::mpi::comm_duplicate);
+  }
+  MPI_Comm hostcomm;
+  MPI_Comm_split_type(allcomm, MPI_COMM_TYPE_SHARED, allcomm.rank(),
+                      MPI_INFO_NULL, &hostcomm);
+  boost::mpi::communicator host(hostcomm, boost::mpi::comm_take_ownership);
+  boost::mpi::communicator sharecomm =
+      host.split(partitioncomm.rank(), allcomm.rank());
+  if (allcomm.rank() == 0) {
+    Info::Inst()->write(string("Sharing staged coordinates among ") +
+                        boost::lexical_cast<string>(sharecomm.size()) +
+                        string(" nodes"));
+  }
+  return sharecomm;
+}
+
+coor_t* StagedMemory::allocate(boost::mpi::communicator& sharecomm,
+                               size_t bytesize) {
+  if (!Params::Inst()->limits.stage.memory.shared) {
+    return (coor_t*)malloc(bytesize);
+  }
+
+  Window w;
+  w.sharecomm = sharecomm;
+  w.owner = (sharecomm.rank() == 0);
+  coor_t* p = NULL;
+  MPI_Win_allocate_shared(w.owner ? bytesize : 0, sizeof(coor_t),
+                          MPI_INFO_NULL, sharecomm, &p, &(w.window));
+  if (!w.owner) {
+    MPI_Aint size;
+    int disp;
+    MPI_Win_shared_query(w.window, 0, &size, &disp, &p);
+  }
+  windows()[p] = w;
+  return p;
+}
+
+bool StagedMemory::owner(coor_t* p) {
+  std::map<coor_t*, Window>::iterator wi = windows().find(p);
+  return (wi == windows().end()) || wi->second.owner;
+}
+
+void StagedMemory::synchronize(coor_t* p) {
+  std::map<coor_t*, Window>::iterator wi = windows().find(p);
+  if (wi == windows().end()) return;
+  MPI_Win_lock_all(MPI_MODE_NOCHECK, wi->second.window);
+  MPI_Win_sync(wi->second.window);
+  wi->second.sharecomm.barrier();
+  MPI_Win_sync(wi->second.window);
+  MPI_Win_unlock_all(wi->second.window);
+}
+
+void StagedMemory::free(coor_t* p) {
+  std::map<coor_t*, Window>::iterator wi = windows().find(p);
+  if (wi == windows().end()) {
+    ::free(p);
+    return;
+  }
+  MPI_Win_free(&(wi->second.window));
+  windows().erase(wi);
+}
+
 /**
 Initializes a data staging object which decomposes the trajectory by frames
 using div logic (consecutive frames are assigned to the same node)
@@ -59,19 +132,23 @@ DataStagerByFrame::DataStagerByFrame(Sample& sample,
 
   DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
 
-  // check data size requirements & allocate memory
+  // check data size requirements & allocate memory, a shared copy is
+  // accounted to all nodes which share it
+  sharecomm_ = StagedMemory::share_communicator(allcomm_, partitioncomm_);
   size_t data_bytesize = assignment.max() * NA * 3 * sizeof(coor_t);
-  if (Params::Inst()->limits.stage.memory.data < data_bytesize) {
+  size_t data_bytesize_share =
+      (data_bytesize + sharecomm_.size() - 1) / sharecomm_.size();
+  if (Params::Inst()->limits.stage.memory.data < data_bytesize_share) {
     if (rank == 0) {
       Err::Inst()->write(
           "Insufficient Buffer size for coordinates (limits.memory.data)");
       Err::Inst()->write(string("Requested (bytes): ") +
-                         boost::lexical_cast<string>(data_bytesize));
+                         boost::lexical_cast<string>(data_bytesize_share));
     }
     throw;
   }
 
-  p_coordinates = (coor_t*)malloc(data_bytesize);
+  p_coordinates = StagedMemory::allocate(sharecomm_, data_bytesize);
 }
 
 /**
@@ -81,6 +158,27 @@ cloned to all other partitions.
 data, atoms x assigned frames)
 */
 coor_t* DataStagerByFrame::stage() {
+  stage_frames();
+  StagedMemory::synchronize(p_coordinates);
+  return p_coordinates;
+}
+
+/**
+Triggers the staging procedure and splits every staged frame into separate x,
+y and z planes, which allows consecutive atoms to be processed with vector
+instructions.
+\param[in] order Atom j of the planes is atom order[j] of the frame.
+\return Pointer to the local memory which contains the staged coordinates (3D
+data, assigned frames x planes x atoms)
+*/
+coor_t* DataStagerByFrame::stage_planes(const std::vector<size_t>& order) {
+  stage_frames();
+  if (StagedMemory::owner(p_coordinates)) arrange_planes(order);
+  StagedMemory::synchronize(p_coordinates);
+  return p_coordinates;
+}
+
+void DataStagerByFrame::stage_frames() {
   if (allcomm_.rank() == 0) Info::Inst()->write("Staging first partition.");
   if (allcomm_.rank() < partitioncomm_.size()) {
     timer_.start("st:first");
@@ -104,8 +202,21 @@ coor_t* DataStagerByFrame::stage() {
                         Params::Inst()->stager.filepath);
     write(Params::Inst()->stager.filepath, Params::Inst()->stager.format);
   }
+}
 
-  return p_coordinates;
+void DataStagerByFrame::arrange_planes(const std::vector<size_t>& order) {
+  DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
+
+  std::vector<coor_t> frame(3 * NA);
+  for (size_t f = 0; f < assignment.size(); ++f) {
+    coor_t* p_data = &(p_coordinates[f * NA * 3]);
+    memcpy(&(frame[0]), p_data, 3 * NA * sizeof(coor_t));
+    for (size_t j = 0; j < NA; ++j) {
+      p_data[j] = frame[3 * order[j]];
+      p_data[NA + j] = frame[3 * order[j] + 1];
+      p_data[2 * NA + j] = frame[3 * order[j] + 2];
+    }
+  }
 }
 
 /**
@@ -114,14 +225,33 @@ Loads trajectory data into the first partition.
 void DataStagerByFrame::stage_firstpartition() {
   DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
 
+  IAtomselection& selection = m_sample.coordinate_sets.get_selection();
+
   for (size_t f = 0; f < assignment.size(); f++) {
     timer_.start("st:load");
+    coor_t* p_frame = &(p_coordinates[f * 3 * NA]);
+
+    // convert directly from a memory mapped trajectory if possible
+    const float* x;
+    const float* y;
+    const float* z;
+    if (m_sample.coordinate_sets.map(assignment[f], x, y, z)) {
+      for (size_t n = 0; n < NA; n++) {
+        size_t atom = selection[n];
+        p_frame[3 * n] = x[atom];
+        p_frame[3 * n + 1] = y[atom];
+        p_frame[3 * n + 2] = z[atom];
+      }
+      timer_.stop("st:load");
+      continue;
+    }
+
     CoordinateSet* p_cset = m_sample.coordinate_sets.load(assignment[f]);
 
     for (size_t n = 0; n < NA; n++) {
-      p_coordinates[f * 3 * NA + 3 * n] = p_cset->c1[n];
-      p_coordinates[f * 3 * NA + 3 * n + 1] = p_cset->c2[n];
-      p_coordinates[f * 3 * NA + 3 * n + 2] = p_cset->c3[n];
+      p_frame[3 * n] = p_cset->c1[n];
+      p_frame[3 * n + 1] = p_cset->c2[n];
+      p_frame[3 * n + 2] = p_cset->c3[n];
     }
     timer_.stop("st:load");
     delete p_cset;
@@ -129,16 +259,21 @@ void DataStagerByFrame::stage_firstpartition() {
 }
 
 /**
-Clones coordinates from the first to all remaining partitions.
+Clones coordinates from the first to all remaining partitions in pipelined
+chunks of limits.stage.chunksize bytes. Nodes which share the memory of another
+node do not receive a copy.
 */
 void DataStagerByFrame::stage_fillpartitions() {
   DivAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NF);
 
   // create a communicator to broadcast between partitions.
+  bool owner = StagedMemory::owner(p_coordinates);
   boost::mpi::communicator interpartitioncomm_ =
-      allcomm_.split(partitioncomm_.rank());
-  boost::mpi::broadcast(interpartitioncomm_, p_coordinates,
-                        assignment.size() * NA * 3, 0);
+      allcomm_.split(owner ? partitioncomm_.rank() : MPI_UNDEFINED);
+  if (!owner) return;
+  mpi::wrapper::broadcast_chunked(
+      interpartitioncomm_, p_coordinates, assignment.size() * NA * 3,
+      Params::Inst()->limits.stage.chunksize / sizeof(coor_t), 0);
 }
 
 /**
@@ -209,10 +344,14 @@ DataStagerByAtom::DataStagerByAtom(Sample& sample,
   // assignment for atom decomposition is modulo
   ModAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NA);
 
-  // check data size requirements & allocate memory
+  // check data size requirements & allocate memory, a shared copy is
+  // accounted to all nodes which share it
+  sharecomm_ = StagedMemory::share_communicator(allcomm_, partitioncomm_);
   size_t data_bytesize = assignment.size() * NF * 3 * sizeof(coor_t);
+  size_t data_bytesize_share =
+      (data_bytesize + sharecomm_.size() - 1) / sharecomm_.size();
   size_t data_bytesize_indicator_max = 0;
-  boost::mpi::all_reduce(partitioncomm_, data_bytesize,
+  boost::mpi::all_reduce(partitioncomm_, data_bytesize_share,
                          data_bytesize_indicator_max,
                          boost::mpi::maximum<size_t>());
 
@@ -227,7 +366,7 @@ DataStagerByAtom::DataStagerByAtom(Sample& sample,
     throw;
   }
 
-  p_coordinates = (coor_t*)malloc(data_bytesize);
+  p_coordinates = StagedMemory::allocate(sharecomm_, data_bytesize);
 }
 
 /**
@@ -263,23 +402,87 @@ coor_t* DataStagerByAtom::stage() {
     write(Params::Inst()->stager.filepath, Params::Inst()->stager.format);
   }
 
-  ModAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NA);
-
+  StagedMemory::synchronize(p_coordinates);
   return p_coordinates;
 }
 
+/**
+Loads the frames of cycle c of this node into a read buffer. The buffer holds
+the frames of an atom consecutively and groups the atoms by the node they are
+assigned to, i.e. atom n = ec*NNPP + r is found at position r*NEC + ec. The
+atoms of a node thus form a single contiguous block per exchange.
+\param[in] p_request Exchange in flight, which is driven while loading
+*/
+void DataStagerByAtom::load_cycle(size_t c, size_t framebuffer_max,
+                                  size_t NEC, coor_t* p_buffer,
+                                  MPI_Request* p_request) {
+  DivAssignment frameassignment(partitioncomm_.size(), partitioncomm_.rank(),
+                                NF);
+
+  IAtomselection& selection = m_sample.coordinate_sets.get_selection();
+
+  for (size_t f = framebuffer_max * c;
+       f < std::min(framebuffer_max * (c + 1), frameassignment.size()); f++) {
+    timer_.start("st:load");
+    size_t framepos_buffer = f - framebuffer_max * c;
+
+    // convert directly from a memory mapped trajectory if possible
+    const float* x;
+    const float* y;
+    const float* z;
+    if (m_sample.coordinate_sets.map(frameassignment[f], x, y, z)) {
+      for (size_t n = 0; n < NA; n++) {
+        size_t pos = (n % NNPP) * NEC + n / NNPP;
+        coor_t* p_to =
+            &(p_buffer[(pos * framebuffer_max + framepos_buffer) * 3]);
+        size_t atom = selection[n];
+        p_to[0] = x[atom];
+        p_to[1] = y[atom];
+        p_to[2] = z[atom];
+      }
+    } else {
+      CoordinateSet* p_cset =
+          m_sample.coordinate_sets.load(frameassignment[f]);
+      for (size_t n = 0; n < NA; n++) {
+        size_t pos = (n % NNPP) * NEC + n / NNPP;
+        coor_t* p_to =
+            &(p_buffer[(pos * framebuffer_max + framepos_buffer) * 3]);
+        p_to[0] = p_cset->c1[n];
+        p_to[1] = p_cset->c2[n];
+        p_to[2] = p_cset->c3[n];
+      }
+      delete p_cset;
+    }
+    timer_.stop("st:load");
+
+    if (p_request != NULL) mpi::wrapper::test(*p_request);
+  }
+}
+
 /**
 Loads trajectory data into the first partition. Performs transposition of the
-data on the fly by making heavy use of buffers and MPI all to all communication.
+data on the fly by exchanging blocks of atoms through non-blocking MPI all to
+all communication. The next cycle of frames is loaded while the exchange of the
+current one is in flight.
 */
 void DataStagerByAtom::stage_firstpartition() {
   // determine frame assignment (for reading) for this node
   DivAssignment frameassignment(partitioncomm_.size(), partitioncomm_.rank(),
                                 NF);
 
-  // test buffer size, minimum allowed is 1 frame
+  // align the readbuffer with the partition size, makes sure that access to the
+  // memory is valid
+  size_t NA_aligned = NA;
+  if ((NA_aligned % NNPP) != 0) {
+    NA_aligned = ((NA / NNPP) + 1) * NNPP;
+  }
+  size_t NEC = NA_aligned / NNPP;
+
+  // test buffer size, minimum allowed is 1 frame. The read buffers and the
+  // exchange buffer share the limit, hence a frame also accounts for an
+  // exchange of a single atom per node.
   size_t buffer_bytesize = Params::Inst()->limits.stage.memory.buffer;
-  size_t frame_bytesize = NA * 3 * sizeof(coor_t);
+  size_t frame_bytesize = (NA_aligned + NNPP) * 3 * sizeof(coor_t);
   size_t framebuffer_max = buffer_bytesize / frame_bytesize;
 
   if (framebuffer_max == 0) {
@@ -294,6 +497,14 @@ void DataStagerByAtom::stage_firstpartition() {
     throw;
   }
 
+  // with multiple cycles the buffer is split into two slots, one is loaded
+  // while the other one is exchanged
+  size_t NSLOTS = 1;
+  if ((frameassignment.max() > framebuffer_max) && (framebuffer_max > 1)) {
+    NSLOTS = 2;
+    framebuffer_max /= 2;
+  }
+
   // determine whether maxframes_read_total fits into the buffer
   // if not: we need to perform multiple cycles
   size_t cycles = 1;
@@ -304,54 +515,67 @@ void DataStagerByAtom::stage_firstpartition() {
     // reduce the buffer size to the maximum required
     framebuffer_max = frameassignment.max();
   }
+  if (cycles == 1) NSLOTS = 1;
+
+  // atoms per node and exchange, the exchange buffer takes what the read
+  // buffers leave of the buffer size
+  size_t readbuffer_bytesize =
+      NSLOTS * framebuffer_max * NA_aligned * 3 * sizeof(coor_t);
+  size_t fragment = framebuffer_max * 3;
+  size_t NBLOCK = (buffer_bytesize - readbuffer_bytesize) /
+                  (NNPP * fragment * sizeof(coor_t));
+  NBLOCK = std::max<size_t>(1, std::min(NBLOCK, NEC));
+  size_t exchangebuffer_bytesize = NBLOCK * NNPP * fragment * sizeof(coor_t);
 
   // allocate buffer
   if (partitioncomm_.rank() == 0) {
     Info::Inst()->write(string("Initializing buffer size to: ") +
                         boost::lexical_cast<string>(framebuffer_max));
+    Info::Inst()->write(string("Exchanging blocks of ") +
+                        boost::lexical_cast<string>(NBLOCK) +
+                        string(" atoms per node"));
+    Info::Inst()->write(
+        string("Staging buffers use bytes: ") +
+        boost::lexical_cast<string>(readbuffer_bytesize +
+                                    exchangebuffer_bytesize));
   }
-  // align the readbuffer with the partition size, makes sure that access to the
-  // memory is valid
-  size_t NA_aligned = NA;
-  if ((NA_aligned % NNPP) != 0) {
-    NA_aligned = ((NA / NNPP) + 1) * NNPP;
+  std::vector<coor_t*> readbuffers(NSLOTS);
+  for (size_t s = 0; s < NSLOTS; ++s) {
+    readbuffers[s] =
+        (coor_t*)malloc(framebuffer_max * NA_aligned * 3 * sizeof(coor_t));
   }
-  coor_t* p_coordinates_readbuffer =
-      (coor_t*)malloc(framebuffer_max * NA_aligned * 3 * sizeof(coor_t));
   coor_t* p_coordinates_exchangebuffer =
-      (coor_t*)malloc(framebuffer_max * NNPP * 3 * sizeof(coor_t));
+      (coor_t*)malloc(exchangebuffer_bytesize);
 
+  load_cycle(0, framebuffer_max, NEC, readbuffers[0], NULL);
+
+  mpi::wrapper::BlockExchange exchange;
+  std::vector<size_t> offsets(NNPP);
   for (size_t c = 0; c < cycles; c++) {
-    // fill buffer
-    for (size_t f = framebuffer_max * c;
-         f < std::min(framebuffer_max * (c + 1), frameassignment.size()); f++) {
-      timer_.start("st:load");
-      CoordinateSet* p_cset = m_sample.coordinate_sets.load(frameassignment[f]);
-      size_t framepos_buffer = f - framebuffer_max * c;
-      for (size_t n = 0; n < NA; n++) {
-        // write it transposed, makes exchange through MPI easy!
-        p_coordinates_readbuffer[n * framebuffer_max * 3 +
-                                 framepos_buffer * 3] = p_cset->c1[n];
-        p_coordinates_readbuffer[n * framebuffer_max * 3 + framepos_buffer * 3 +
-                                 1] = p_cset->c2[n];
-        p_coordinates_readbuffer[n * framebuffer_max * 3 + framepos_buffer * 3 +
-                                 2] = p_cset->c3[n];
+    coor_t* p_coordinates_readbuffer = readbuffers[c % NSLOTS];
+
+    for (size_t ec0 = 0; ec0 < NEC; ec0 += NBLOCK) {
+      size_t nblock = std::min(NBLOCK, NEC - ec0);
+      for (size_t r = 0; r < NNPP; r++) offsets[r] = r * NEC + ec0;
+      mpi::wrapper::iall_to_all_blocks(
+          partitioncomm_, p_coordinates_readbuffer, offsets, nblock, fragment,
+          p_coordinates_exchangebuffer, exchange);
+
+      if ((ec0 == 0) && (c + 1 < cycles)) {
+        load_cycle(c + 1, framebuffer_max, NEC, readbuffers[(c + 1) % NSLOTS],
+                   &(exchange.request));
       }
-      delete p_cset;
-      timer_.stop("st:load");
-    }
-    // exchange data with other nodes
-    for (size_t ec = 0; ec < (NA_aligned / NNPP); ec++) {
-      // places atoms in modulo fashion on different nodes
-      boost::mpi::all_to_all(
-          partitioncomm_,
-          &(p_coordinates_readbuffer[ec * framebuffer_max * 3 * NNPP]),
-          framebuffer_max * 3, p_coordinates_exchangebuffer);
-      // data is now in exchangebuffer,
-      // organized as time sequence fragments for a particular atom
-      // (id=NNPP*ec+partitioncomm_.rank())
-      size_t atomid = NNPP * ec + partitioncomm_.rank();
-      if (atomid < NA) {
+
+      timer_.start("st:exchange");
+      mpi::wrapper::wait(exchange.request);
+      timer_.stop("st:exchange");
+
+      // data is now in exchangebuffer, organized by node and then by atom
+      // (id=NNPP*ec+partitioncomm_.rank()) as time sequence fragments
+      for (size_t k = 0; k < nblock; k++) {
+        size_t ec = ec0 + k;
+        size_t atomid = NNPP * ec + partitioncomm_.rank();
+        if (atomid >= NA) continue;
         // iterate over all time fragments
         for (size_t n = 0; n < NNPP; n++) {
           // get properties of the time fragment from associated assignment
@@ -365,28 +589,33 @@ void DataStagerByAtom::stage_firstpartition() {
 
           coor_t* p_to = &(p_coordinates[(ec * NF + pos) * 3]);
           coor_t* p_from =
-              &(p_coordinates_exchangebuffer[n * framebuffer_max * 3]);
+              &(p_coordinates_exchangebuffer[(n * nblock + k) * fragment]);
           memcpy(p_to, p_from, 3 * len * sizeof(coor_t));
         }
       }
     }
   }
 
-  free(p_coordinates_readbuffer);
+  for (size_t s = 0; s < NSLOTS; ++s) free(readbuffers[s]);
   free(p_coordinates_exchangebuffer);
 }
 
 /**
-Clones coordinates from the first to all remaining partitions.
+Clones coordinates from the first to all remaining partitions in pipelined
+chunks of limits.stage.chunksize bytes. Nodes which share the memory of another
+node do not receive a copy.
 */
 void DataStagerByAtom::stage_fillpartitions() {
   ModAssignment assignment(partitioncomm_.size(), partitioncomm_.rank(), NA);
 
   // create a communicator to broadcast between partitions.
+  bool owner = StagedMemory::owner(p_coordinates);
   boost::mpi::communicator interpartitioncomm_ =
-      allcomm_.split(partitioncomm_.rank());
-  boost::mpi::broadcast(interpartitioncomm_, p_coordinates,
-                        assignment.size() * NF * 3, 0);
+      allcomm_.split(owner ? partitioncomm_.rank() : MPI_UNDEFINED);
+  if (!owner) return;
+  mpi::wrapper::broadcast_chunked(
+      interpartitioncomm_, p_coordinates, assignment.size() * NF * 3,
+      Params::Inst()->limits.stage.chunksize / sizeof(coor_t), 0);
 }
 
 /**
@@ -0,0 +1,105 @@
+/** \file
+This executable unit test compares the recurrences of the multipole expansion,
+i.e. the spherical and cylindrical Bessel functions of all orders and the
+spherical harmonics, against the special functions of boost. It covers
+arguments at and near zero, arguments much smaller than the order, where the
+downward recurrence applies, and arguments beyond the highest order.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "common.hpp"
+
+// standard header
+#include <cmath>
+#include <algorithm>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+// special library headers
+#include <boost/math/special_functions/bessel.hpp>
+#include <boost/math/special_functions/spherical_harmonic.hpp>
+
+// other headers
+#include "math/multipole.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  const double tolerance = 1e-12;
+  bool failed = false;
+
+  long orders[] = {0, 1, 2, 5, 20, 60};
+  double args[] = {0.0, 1e-8, 1e-3, 0.1, 0.5, 1.0, 3.7, 9.42477796076938,
+                   19.5, 33.3, 59.9, 150.0};
+
+  for (size_t li = 0; li < sizeof(orders) / sizeof(long); ++li) {
+    long L = orders[li];
+    std::vector<double> j(L + 1), J(L + 1);
+    for (size_t xi = 0; xi < sizeof(args) / sizeof(double); ++xi) {
+      double x = args[xi];
+      smath::sph_bessel_all(L, x, &j[0]);
+      smath::cyl_bessel_j_all(L, x, &J[0]);
+
+      // the deviation is measured relative to the magnitude of an order, which
+      // is the envelope of the function for orders below x. values which
+      // underflow only have to be tiny.
+      for (long l = 0; l <= L; ++l) {
+        double jref = boost::math::sph_bessel(l, x);
+        double Jref = boost::math::cyl_bessel_j(l, x);
+        double jscale = std::max(fabs(jref), (x > l) ? 1.0 / x : 1e-280);
+        double Jscale = std::max(fabs(Jref), (x > l) ? 1.0 / sqrt(x) : 1e-280);
+        if (fabs(j[l] - jref) > tolerance * jscale) {
+          cout << "sph_bessel_all: L=" << L << " l=" << l << " x=" << x
+               << " value=" << j[l] << " reference=" << jref << endl;
+          failed = true;
+        }
+        if (fabs(J[l] - Jref) > tolerance * Jscale) {
+          cout << "cyl_bessel_j_all: L=" << L << " n=" << l << " x=" << x
+               << " value=" << J[l] << " reference=" << Jref << endl;
+          failed = true;
+        }
+      }
+    }
+  }
+
+  // include the poles and angles close to them
+  long degrees[] = {0, 1, 4, 20, 45};
+  double thetas[] = {0.0, 1e-9, 0.3, 1.0, M_PI / 2, 2.5, M_PI - 1e-9, M_PI};
+  double phis[] = {0.0, 0.7, -2.1, 3.9};
+  for (size_t li = 0; li < sizeof(degrees) / sizeof(long); ++li) {
+    long L = degrees[li];
+    smath::SphericalHarmonics harmonics(L);
+    std::vector<complex<double> > Y(harmonics.size());
+    for (size_t ti = 0; ti < sizeof(thetas) / sizeof(double); ++ti) {
+      for (size_t pi = 0; pi < sizeof(phis) / sizeof(double); ++pi) {
+        harmonics.evaluate(thetas[ti], phis[pi], &Y[0]);
+        for (long l = 0; l <= L; ++l) {
+          // the harmonics of degree l are bounded by sqrt((2l+1)/(4 pi))
+          double scale = sqrt((2 * l + 1) / (4 * M_PI));
+          for (long m = 0; m <= l; ++m) {
+            complex<double> ref =
+                boost::math::spherical_harmonic(l, m, thetas[ti], phis[pi]);
+            complex<double> value = Y[smath::SphericalHarmonics::index(l, m)];
+            if (abs(value - ref) > tolerance * scale) {
+              cout << "SphericalHarmonics: l=" << l << " m=" << m
+                   << " theta=" << thetas[ti] << " phi=" << phis[pi]
+                   << " value=" << value << " reference=" << ref << endl;
+              failed = true;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  if (failed) return 1;
+  cout << "all recurrences within tolerance" << endl;
+  return 0;
+}
+
+// end of file
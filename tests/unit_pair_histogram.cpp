@@ -0,0 +1,126 @@
+/** \file
+This executable unit test compares the pair distance histograms of a frame
+against a brute force count of the pairs within the cutoff, once for all pairs
+and once by cell lists. The histograms of all pairs have to reproduce the Debye
+sum up to the binning.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "common.hpp"
+
+// standard header
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// special library headers
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+// other headers
+#include "math/pair_histogram.hpp"
+#include "math/simd.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  boost::mt19937 rng;
+  boost::uniform_real<double> u(-1.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > gen(
+      rng, u);
+
+  bool failed = false;
+
+  // cover single atoms, a few cells and more cells than atoms
+  const size_t NS = 3;
+  double species_factors[NS] = {0.8, -0.3, 1.7};
+  size_t atoms[] = {1, 7, 100, 1500};
+  for (size_t ai = 0; ai < sizeof(atoms) / sizeof(size_t); ++ai) {
+    size_t N = atoms[ai];
+    std::vector<coor_t> x(N), y(N), z(N);
+    std::vector<size_t> species(N);
+    std::vector<double> f(N);
+    double fsum = 0;
+    for (size_t j = 0; j < N; ++j) {
+      x[j] = 30.0 * gen();
+      y[j] = 30.0 * gen();
+      z[j] = 30.0 * gen();
+      species[j] = j % NS;
+      f[j] = species_factors[species[j]];
+      fsum += fabs(f[j]);
+    }
+
+    const double binwidth = 0.01;
+    const size_t NBINS = 11000;  // beyond the diagonal of the box
+    const size_t NP = NS * (NS + 1) / 2;
+    std::vector<double> H(NP * NBINS, 0.0);
+    smath::pair_histogram(&x[0], &y[0], &z[0], &species[0], NS, N, binwidth,
+                          NBINS, 0, &H[0]);
+
+    // sum_i f_i^2 + 2 sum_(i<j) f_i f_j sinc(q r_ij) with the distances
+    // replaced by the bin centers. The sinc changes by at most q/2 per unit of
+    // distance, i.e. by q binwidth / 4 over half a bin.
+    double q = 2.0 + gen();
+    std::vector<double> S(NBINS);
+    smath::sinc_table(q, binwidth, NBINS, &S[0]);
+    double s = 0;
+    for (size_t j = 0; j < N; ++j) s += f[j] * f[j];
+    for (size_t a = 0; a < NS; ++a) {
+      for (size_t b = a; b < NS; ++b) {
+        const double* p_H = &(H[smath::species_pair(a, b) * NBINS]);
+        double hs = 0;
+        for (size_t k = 0; k < NBINS; ++k) hs += p_H[k] * S[k];
+        s += 2 * species_factors[a] * species_factors[b] * hs;
+      }
+    }
+    double ref = smath::debye_sum(smath::SIMD_SCALAR, &x[0], &y[0], &z[0],
+                                  &f[0], q, 0, N, 0, N);
+    double deviation = fabs(s - ref) / (fsum * fsum);
+    if (deviation > q * binwidth / 4) {
+      cout << "Debye sum: N=" << N << " deviation=" << deviation << endl;
+      failed = true;
+    }
+
+    // cutoffs which give a single cell, few cells and more cells than atoms
+    double cutoffs[] = {100.0, 20.0, 2.0};
+    for (size_t ci = 0; ci < sizeof(cutoffs) / sizeof(double); ++ci) {
+      double cutoff = cutoffs[ci];
+      std::vector<double> Hc(NP * NBINS, 0.0);
+      smath::pair_histogram(&x[0], &y[0], &z[0], &species[0], NS, N,
+                            binwidth, NBINS, cutoff, &Hc[0]);
+
+      // brute force count of the pairs within the cutoff per species pair
+      std::vector<double> count(NP, 0.0);
+      for (size_t i = 0; i < N; ++i) {
+        for (size_t j = i + 1; j < N; ++j) {
+          double dx = double(x[j]) - x[i];
+          double dy = double(y[j]) - y[i];
+          double dz = double(z[j]) - z[i];
+          if (dx * dx + dy * dy + dz * dz < cutoff * cutoff) {
+            count[smath::species_pair(species[i], species[j])] += 1;
+          }
+        }
+      }
+      for (size_t p = 0; p < NP; ++p) {
+        double total = 0;
+        for (size_t k = 0; k < NBINS; ++k) total += Hc[p * NBINS + k];
+        if (total != count[p]) {
+          cout << "pair_histogram: N=" << N << " cutoff=" << cutoff
+               << " pairs=" << total << " expected=" << count[p] << endl;
+          failed = true;
+        }
+      }
+    }
+  }
+
+  if (failed) return 1;
+  cout << "all histograms within tolerance" << endl;
+  return 0;
+}
+
+// end of file
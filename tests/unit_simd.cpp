@@ -0,0 +1,265 @@
+/** \file
+This executable unit test compares the vectorized scatter kernels against the
+scalar reference kernel and fails if they deviate by more than the documented
+tolerance. Mixed precision kernels have to stay within the single precision
+rounding of the phases. It also verifies that the blocked kernels reproduce the
+single vector kernels and that the blocked direct correlator and the Debye
+sum reproduce the textbook double loops. Phase factors advanced by the
+recurrence must not drift from the exact phases before they are reseeded.
+
+\author Benjamin Lindner <ben@benlabs.net>
+\version 1.3.0
+\copyright GNU General Public License
+*/
+
+// direct header
+#include "common.hpp"
+
+// standard header
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// special library headers
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
+
+// other headers
+#include "math/simd.hpp"
+
+using namespace std;
+
+int main(int argc, char** argv) {
+  boost::mt19937 rng;
+  boost::uniform_real<double> u(-1.0, 1.0);
+  boost::variate_generator<boost::mt19937&, boost::uniform_real<double> > gen(
+      rng, u);
+
+  const double tolerance = 1e-12;
+  smath::SimdLevel available = smath::simd_detect();
+  cout << "detected instruction set: " << smath::simd_name(available) << endl;
+
+  // cover remainder handling and phases up to |q*r| ~ 1e5
+  size_t sizes[] = {1, 3, 7, 8, 13, 64, 1001};
+  double extents[] = {1.0, 50.0, 1000.0};
+  bool failed = false;
+
+  for (size_t si = 0; si < sizeof(sizes) / sizeof(size_t); ++si) {
+    for (size_t ei = 0; ei < sizeof(extents) / sizeof(double); ++ei) {
+      size_t N = sizes[si];
+      std::vector<coor_t> x(N), y(N), z(N);
+      std::vector<double> f(N);
+      double fsum = 0;
+      for (size_t j = 0; j < N; ++j) {
+        x[j] = extents[ei] * gen();
+        y[j] = extents[ei] * gen();
+        z[j] = extents[ei] * gen();
+        f[j] = gen();
+        fsum += fabs(f[j]);
+      }
+      double qx = 30.0 * gen(), qy = 30.0 * gen(), qz = 30.0 * gen();
+
+      double Rr, Ri;
+      smath::phase_sum(smath::SIMD_SCALAR, smath::PRECISION_DOUBLE, &x[0],
+                       &y[0], &z[0], &f[0], N, qx, qy, qz, Rr, Ri);
+
+      // a block of q vectors has to reproduce the individual sums exactly
+      const size_t K = 7;
+      std::vector<double> bqx(K), bqy(K), bqz(K), bAr(K), bAi(K);
+      for (size_t k = 0; k < K; ++k) {
+        bqx[k] = 30.0 * gen();
+        bqy[k] = 30.0 * gen();
+        bqz[k] = 30.0 * gen();
+      }
+      for (int level = smath::SIMD_SCALAR; level <= available; ++level) {
+        for (int pr = smath::PRECISION_DOUBLE; pr <= smath::PRECISION_MIXED;
+             ++pr) {
+          smath::SimdLevel sl = smath::SimdLevel(level);
+          smath::Precision sp = smath::Precision(pr);
+          smath::phase_sum_block(sl, sp, &x[0], &y[0], &z[0], &f[0], N,
+                                 &bqx[0], &bqy[0], &bqz[0], K, &bAr[0],
+                                 &bAi[0]);
+          for (size_t k = 0; k < K; ++k) {
+            double Ar, Ai;
+            smath::phase_sum(sl, sp, &x[0], &y[0], &z[0], &f[0], N, bqx[k],
+                             bqy[k], bqz[k], Ar, Ai);
+            if ((Ar != bAr[k]) || (Ai != bAi[k])) {
+              cout << smath::simd_name(sl) << " "
+                   << smath::precision_name(sp)
+                   << ": block of q vectors differs, N=" << N << " k=" << k
+                   << endl;
+              failed = true;
+            }
+          }
+        }
+      }
+
+      for (int level = smath::SIMD_AVX2; level <= available; ++level) {
+        double Ar, Ai;
+        smath::phase_sum(smath::SimdLevel(level), smath::PRECISION_DOUBLE,
+                         &x[0], &y[0], &z[0], &f[0], N, qx, qy, qz, Ar, Ai);
+        double deviation = sqrt(pow(Ar - Rr, 2) + pow(Ai - Ri, 2)) / fsum;
+        if (deviation > tolerance) {
+          cout << smath::simd_name(smath::SimdLevel(level)) << ": N=" << N
+               << " extent=" << extents[ei] << " deviation=" << deviation
+               << endl;
+          failed = true;
+        }
+      }
+
+      // single precision phases are accurate to a few ulp of |q*r|
+      double pmax = sqrt(3.0 * (qx * qx + qy * qy + qz * qz)) * extents[ei];
+      double mixed_tolerance = 1e-6 * (1.0 + pmax);
+      for (int level = smath::SIMD_SCALAR; level <= available; ++level) {
+        double Ar, Ai;
+        smath::phase_sum(smath::SimdLevel(level), smath::PRECISION_MIXED,
+                         &x[0], &y[0], &z[0], &f[0], N, qx, qy, qz, Ar, Ai);
+        double deviation = sqrt(pow(Ar - Rr, 2) + pow(Ai - Ri, 2)) / fsum;
+        if (deviation > mixed_tolerance) {
+          cout << smath::simd_name(smath::SimdLevel(level))
+               << " mixed: N=" << N << " extent=" << extents[ei]
+               << " deviation=" << deviation << endl;
+          failed = true;
+        }
+      }
+    }
+  }
+
+  // the phase factors of a linear q scan advance by a recurrence for as many
+  // steps as limits.computation.phases.reseed allows by default. The rounding
+  // of every step accumulates, but has to stay close to the exact phases.
+  const size_t reseed = 32;
+  for (size_t si = 0; si < sizeof(sizes) / sizeof(size_t); ++si) {
+    for (size_t ei = 0; ei < sizeof(extents) / sizeof(double); ++ei) {
+      size_t N = sizes[si];
+      std::vector<coor_t> x(N), y(N), z(N);
+      std::vector<double> f(N);
+      double fsum = 0;
+      for (size_t j = 0; j < N; ++j) {
+        x[j] = extents[ei] * gen();
+        y[j] = extents[ei] * gen();
+        z[j] = extents[ei] * gen();
+        f[j] = gen();
+        fsum += fabs(f[j]);
+      }
+      double qx = 10.0 * gen(), qy = 10.0 * gen(), qz = 10.0 * gen();
+      double dqx = 0.1 * gen(), dqy = 0.1 * gen(), dqz = 0.1 * gen();
+      double qsx = qx + reseed * dqx;
+      double qsy = qy + reseed * dqy;
+      double qsz = qz + reseed * dqz;
+
+      double Rr, Ri;
+      smath::phase_sum(smath::SIMD_SCALAR, smath::PRECISION_DOUBLE, &x[0],
+                       &y[0], &z[0], &f[0], N, qsx, qsy, qsz, Rr, Ri);
+
+      double pmax = sqrt(3.0 * (qsx * qsx + qsy * qsy + qsz * qsz)) *
+                    extents[ei];
+      double drift_tolerance = reseed * tolerance * (1.0 + pmax);
+      for (int level = smath::SIMD_SCALAR; level <= available; ++level) {
+        smath::SimdLevel sl = smath::SimdLevel(level);
+        std::vector<double> re(N), im(N), sre(N), sim(N);
+        smath::phase_factors(sl, &x[0], &y[0], &z[0], N, qx, qy, qz, &re[0],
+                             &im[0]);
+        smath::phase_factors(sl, &x[0], &y[0], &z[0], N, dqx, dqy, dqz,
+                             &sre[0], &sim[0]);
+        double Ar = 0, Ai = 0;
+        for (size_t step = 0; step < reseed; ++step) {
+          smath::phase_advance(sl, &re[0], &im[0], &sre[0], &sim[0], &f[0], N,
+                               Ar, Ai);
+        }
+        double deviation = sqrt(pow(Ar - Rr, 2) + pow(Ai - Ri, 2)) / fsum;
+        if (deviation > drift_tolerance) {
+          cout << smath::simd_name(sl) << ": recurrence N=" << N
+               << " extent=" << extents[ei] << " deviation=" << deviation
+               << endl;
+          failed = true;
+        }
+      }
+    }
+  }
+
+  // cover partial tiles of lags and frames, and blocks of frames
+  size_t frames[] = {1, 5, 9, 100, 2500};
+  for (size_t fi = 0; fi < sizeof(frames) / sizeof(size_t); ++fi) {
+    size_t N = frames[fi];
+    std::vector<double> re(N), im(N);
+    double asum = 0;
+    for (size_t k = 0; k < N; ++k) {
+      re[k] = gen();
+      im[k] = gen();
+      asum += re[k] * re[k] + im[k] * im[k];
+    }
+    size_t lags[] = {N, (N + 1) / 2, 3};
+    for (size_t li = 0; li < sizeof(lags) / sizeof(size_t); ++li) {
+      size_t L = std::min(lags[li], N);
+      std::vector<double> ref(2 * L, 0.0);
+      for (size_t tau = 0; tau < L; ++tau) {
+        for (size_t k = 0; k + tau < N; ++k) {
+          ref[2 * tau] += re[k] * re[k + tau] + im[k] * im[k + tau];
+          ref[2 * tau + 1] += im[k] * re[k + tau] - re[k] * im[k + tau];
+        }
+      }
+      for (int level = smath::SIMD_SCALAR; level <= available; ++level) {
+        std::vector<double> c(2 * L);
+        smath::correlate_direct(smath::SimdLevel(level), &re[0], &im[0], N, L,
+                                &c[0]);
+        double deviation = 0;
+        for (size_t i = 0; i < 2 * L; ++i) {
+          deviation = std::max(deviation, fabs(c[i] - ref[i]) / asum);
+        }
+        if (deviation > tolerance) {
+          cout << smath::simd_name(smath::SimdLevel(level))
+               << ": correlation N=" << N << " L=" << L
+               << " deviation=" << deviation << endl;
+          failed = true;
+        }
+      }
+    }
+  }
+
+  // cover remainders of the partner atoms, blocks of partners and pairs at
+  // zero distance
+  size_t atoms[] = {1, 7, 100, 1500};
+  for (size_t ai = 0; ai < sizeof(atoms) / sizeof(size_t); ++ai) {
+    size_t N = atoms[ai];
+    std::vector<coor_t> x(N), y(N), z(N);
+    std::vector<double> f(N);
+    double fsum = 0;
+    for (size_t j = 0; j < N; ++j) {
+      x[j] = 30.0 * gen();
+      y[j] = 30.0 * gen();
+      z[j] = 30.0 * gen();
+      f[j] = gen();
+      fsum += fabs(f[j]);
+    }
+    double q = 2.0 + gen();
+    double ref = 0;
+    for (size_t i = 0; i < N; ++i) {
+      for (size_t j = 0; j < N; ++j) {
+        double r = sqrt(pow(double(x[i]) - x[j], 2) +
+                        pow(double(y[i]) - y[j], 2) +
+                        pow(double(z[i]) - z[j], 2));
+        ref += f[i] * f[j] * ((r > 0) ? sin(q * r) / (q * r) : 1.0);
+      }
+    }
+    for (int level = smath::SIMD_SCALAR; level <= available; ++level) {
+      double s = smath::debye_sum(smath::SimdLevel(level), &x[0], &y[0], &z[0],
+                                  &f[0], q, 0, N, 0, N);
+      double deviation = fabs(s - ref) / (fsum * fsum);
+      if (deviation > tolerance) {
+        cout << smath::simd_name(smath::SimdLevel(level))
+             << ": Debye sum N=" << N << " deviation=" << deviation << endl;
+        failed = true;
+      }
+    }
+  }
+
+  if (failed) return 1;
+  cout << "all kernels within tolerance" << endl;
+  return 0;
+}
+
+// end of file